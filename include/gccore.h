@@ -40,6 +40,7 @@ distribution.
 #include "ogc/aram.h"
 #include "ogc/arqueue.h"
 #include "ogc/arqmgr.h"
+#include "ogc/arcache.h"
 #include "ogc/audio.h"
 #include "ogc/cache.h"
 #include "ogc/card.h"
@@ -50,6 +51,7 @@ distribution.
 #include "ogc/exi.h"
 #include "ogc/gu.h"
 #include "ogc/gx.h"
+#include "ogc/gxdecode.h"
 #include "ogc/si.h"
 #include "ogc/gx_struct.h"
 #include "ogc/irq.h"
@@ -60,6 +62,7 @@ distribution.
 #include "ogc/pad.h"
 #include "ogc/tpl.h"
 #include "ogc/system.h"
+#include "ogc/szp.h"
 #include "ogc/video.h"
 #include "ogc/usbgecko.h"
 #include "ogc/video_types.h"
@@ -118,6 +121,7 @@ distribution.
  *
  * - \ref aram.h "ARAM subsystem"
  * - \ref arqmgr.h "ARAM queue management subsystem"
+ * - \ref arcache.h "ARAM heap and asset cache"
  * - \ref audio.h "AUDIO subsystem"
  * - \ref asndlib.h "ASND library"
  * - \ref exi.h "EXI subsystem"
@@ -125,6 +129,7 @@ distribution.
  * - \ref dsp.h "DSP subsystem"
  * - \ref dvd.h "DVD subsystem"
  * - \ref gx.h "GX subsystem"
+ * - \ref gxdecode.h "GX command stream decoder"
  * - \ref gu.h "gu/Matrix subsystem"
  * - \ref video.h "VIDEO subsystem"
  * - \ref cache.h "Cache subsystem"
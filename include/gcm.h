@@ -0,0 +1,27 @@
+/****************************************************************************
+ * GameCube disc (GCM) FST devoptab
+ *
+ * Copyright (C) 2008-2025
+ * tipoloski, clava, shagkur, Tantric, joedj, Extrems
+ ****************************************************************************/
+
+#ifndef __GCM_H__
+#define __GCM_H__
+
+#include <gctypes.h>
+
+#define GCM_MAXPATHLEN		256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool GCM_Mount(const char *name, DISC_INTERFACE *disc_interface);
+bool GCM_Unmount(const char *name);
+const char *GCM_GetGameName(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,6 +17,7 @@ extern "C" {
 #endif
 
 bool ISO9660_Mount(const char *name, DISC_INTERFACE *disc_interface);
+bool ISO9660_MountEx(const char *name, DISC_INTERFACE *disc_interface, u32 cachePages, u32 sectorsPerPage);
 bool ISO9660_Unmount(const char *name);
 const char *ISO9660_GetVolumeLabel(const char *name);
 
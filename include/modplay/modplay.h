@@ -33,6 +33,12 @@ THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #define MAX_VOICES  32
 
+#define MOD_MIX_BLOCK_SIZE  512   /* Samples mixed per pass into the 32bit accumulators */
+
+#define MOD_INTERP_NONE     0
+#define MOD_INTERP_LINEAR   1
+#define MOD_INTERP_CUBIC    2
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -123,6 +129,9 @@ typedef struct _mod
     BOOL set;
     BOOL *notify;
 
+    s32 interpolation;
+    s32 mixaccum[MOD_MIX_BLOCK_SIZE];
+
   } MOD;
 
 s32 MOD_SetMOD ( MOD *, u8 * );
@@ -132,6 +141,7 @@ void MOD_Start ( MOD * );
 u32 MOD_Player ( MOD * );
 s32 MOD_TriggerNote ( MOD *, s32, u8, u16, u8 );
 s32 MOD_AllocSFXChannels ( MOD *, s32 );
+s32 MOD_SetInterpolation ( MOD *, s32 );
 
 u16 getNote ( MOD *, s32, s32 );
 u8 getInstr ( MOD *, s32, s32 );
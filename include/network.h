@@ -263,6 +263,16 @@ struct pollsd {
 	u32 revents;
 };
 
+#define NET_EVSET_ADD		1
+#define NET_EVSET_MOD		2
+#define NET_EVSET_DEL		3
+
+struct netevent {
+	s32 socket;
+	u32 events;
+	void *usrdata;
+};
+
 u32 inet_addr(const char *cp);
 int inet_aton(const char *cp, struct in_addr *addr);
 char *inet_ntoa(struct in_addr addr); /* returns ptr to static buffer; not reentrant! */
@@ -295,6 +305,25 @@ s32 net_sendto(s32 s,const void *data,size_t len,u32 flags,struct sockaddr *to,s
 s32 net_recv(s32 s,void *mem,size_t len,u32 flags);
 s32 net_recvfrom(s32 s,void *mem,size_t len,u32 flags,struct sockaddr *from,socklen_t *fromlen);
 s32 net_read(s32 s,void *mem,size_t len);
+
+/* Zero-copy I/O.
+   net_sendzc() queues data without copying it. The memory must stay untouched until
+   cb is called with 0 (acknowledged by the peer) or a negative errno (connection lost),
+   exactly once, also when net_sendzc() fails. If nothing was queued that happens before
+   net_sendzc() returns; otherwise cb runs on the network thread and must not block or
+   call back into net_*. Closing the socket before every send is acknowledged resets the
+   connection and completes the rest with -ECONNABORTED.
+   net_recvzc() loans the next received buffer to the caller. Walk its contiguous chunks
+   with net_zcbuf_next() and hand it back with net_zcbuf_release(); for TCP the receive
+   window only reopens once the loan is returned. */
+struct netzcbuf;
+typedef void (*netzc_sentcb)(s32 result,void *usrdata);
+
+s32 net_sendzc(s32 s,const void *data,size_t len,u32 flags,netzc_sentcb cb,void *usrdata);
+s32 net_recvzc(s32 s,struct netzcbuf **zbuf,u32 flags);
+void* net_zcbuf_next(struct netzcbuf *zbuf,u32 *len);
+void net_zcbuf_release(s32 s,struct netzcbuf *zbuf);
+
 s32 net_close(s32 s);
 s32 net_select(s32 maxfdp1,fd_set *readset,fd_set *writeset,fd_set *exceptset,struct timeval *timeout);
 s32 net_getpeername(s32 s,struct sockaddr *name,socklen_t *namelen);
@@ -304,6 +333,16 @@ s32 net_setsockopt(s32 s,u32 level,u32 optname,const void *optval,socklen_t optl
 s32 net_ioctl(s32 s, u32 cmd, void *argp);
 s32 net_fcntl(s32 s, u32 cmd, u32 flags);
 s32 net_poll(struct pollsd *sds,s32 nsds,s32 timeout);
+
+/* Event sets.
+   Register interest in a socket once with net_evset_ctl() (POLLIN/POLLOUT, POLLERR and
+   POLLHUP are always reported); net_evset_wait() then returns only the sockets that are
+   ready, in time proportional to their number. Reporting is level triggered. timeout is
+   in milliseconds, negative waits forever. */
+s32 net_evset_create(void);
+s32 net_evset_ctl(s32 evs,u32 op,s32 s,u32 events,void *usrdata);
+s32 net_evset_wait(s32 evs,struct netevent *evts,s32 maxevents,s32 timeout);
+s32 net_evset_destroy(s32 evs);
 s32 net_shutdown(s32 s, u32 how);
 
 struct hostent * net_gethostbyname(const char *addrString);
@@ -0,0 +1,269 @@
+/*-------------------------------------------------------------
+
+arcache.h -- ARAM heap and asset cache
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#ifndef __OGC_ARCACHE_H__
+#define __OGC_ARCACHE_H__
+
+/*!
+ * \file arcache.h
+ * \brief ARAM heap and asset cache
+ *
+ * The heap hands out 32 byte aligned ARAM blocks of arbitrary lifetime. The cache sits on top of it and keeps
+ * assets, identified by a caller chosen key, in ARAM and pages them into main memory through the ARQ.
+ * Least recently used assets are evicted when the heap runs out of space.
+ *
+ * AR_Init() and ARQ_Init() have to be called before using either of them.
+ */
+
+#include <gctypes.h>
+#include <ogc/arqueue.h>
+
+#define ARC_OK					0
+#define ARC_ENOENT				-1
+#define ARC_ENOMEM				-2
+#define ARC_EINVAL				-3
+#define ARC_EIO					-4
+#define ARC_EBUSY				-5
+
+#ifdef __cplusplus
+   extern "C" {
+#endif /* __cplusplus */
+
+typedef struct _arc_request ARCRequest;
+
+/*!
+ * \typedef void (*ARCCallback)(ARCRequest *req,s32 result)
+ * \brief function pointer typedef for the user's callback when an asynchronous fetch has completed.
+ *        Called from the ARAM DMA interrupt.
+ * \param[in] req the request passed to ARC_FetchAsync().
+ * \param[in] result number of bytes transferred.
+ */
+typedef void (*ARCCallback)(ARCRequest *req,s32 result);
+
+/*!
+ * \typedef s32 (*ARCLoader)(u32 key,void *buffer,u32 len,void *usrdata)
+ * \brief function pointer typedef for the user's loader used by ARC_Load() on a cache miss.
+ * \param[in] key key of the asset to load.
+ * \param[in] buffer 32 byte aligned buffer to read the asset into.
+ * \param[in] len length of the asset.
+ * \param[in] usrdata user data passed to ARC_Load().
+ *
+ * \return number of bytes read or a negative value on error.
+ */
+typedef s32 (*ARCLoader)(u32 key,void *buffer,u32 len,void *usrdata);
+
+struct _arc_request {
+	ARQRequest arq;
+	ARCCallback callback;
+	void *entry;
+	void *usrdata;
+};
+
+typedef struct _arc_stats {
+	u32 hits;
+	u32 misses;
+	u32 inserts;
+	u32 evictions;
+	u32 entries;
+	u32 used_bytes;
+	u32 free_bytes;
+} arc_stats;
+
+/*!
+ * \fn s32 ARH_Init(u32 aram_base,u32 len,u32 max_blocks)
+ * \brief Initialize the ARAM heap. Any cached assets are dropped.
+ *
+ * \param[in] aram_base ARAM start address of the heap, e.g. as returned by AR_Alloc().
+ * \param[in] len size of the heap in bytes.
+ * \param[in] max_blocks maximum number of free and allocated blocks the heap can track.
+ *
+ * \return ARC_OK on success, ARC_EBUSY if fetches are in flight, ARC_EINVAL or ARC_ENOMEM on failure.
+ */
+s32 ARH_Init(u32 aram_base,u32 len,u32 max_blocks);
+
+/*!
+ * \fn u32 ARH_Alloc(u32 len)
+ * \brief Allocate a block from the ARAM heap.
+ *
+ * \param[in] len size of the block. Rounded up to a multiple of 32 bytes.
+ *
+ * \return ARAM address of the block or 0 if there is no room.
+ */
+u32 ARH_Alloc(u32 len);
+
+/*!
+ * \fn void ARH_Free(u32 aram_addr)
+ * \brief Return a block to the ARAM heap.
+ *
+ * \param[in] aram_addr address returned by ARH_Alloc().
+ *
+ * \return none
+ */
+void ARH_Free(u32 aram_addr);
+
+/*!
+ * \fn u32 ARH_GetFreeSize(void)
+ * \brief Return the number of free bytes in the ARAM heap.
+ *
+ * \return See description
+ */
+u32 ARH_GetFreeSize(void);
+
+/*!
+ * \fn u32 ARH_GetLargestFree(void)
+ * \brief Return the size of the largest free block in the ARAM heap.
+ *
+ * \return See description
+ */
+u32 ARH_GetLargestFree(void);
+
+/*!
+ * \fn s32 ARC_Init(u32 max_entries)
+ * \brief Initialize the asset cache on top of the ARAM heap. Any cached assets are dropped.
+ *
+ * \param[in] max_entries maximum number of assets held at once.
+ *
+ * \return ARC_OK on success, ARC_EBUSY if fetches are in flight, ARC_EINVAL or ARC_ENOMEM on failure.
+ */
+s32 ARC_Init(u32 max_entries);
+
+/*!
+ * \fn s32 ARC_Insert(u32 key,void *buffer,u32 len)
+ * \brief Copy an asset from main memory into the cache, evicting older assets as needed.
+ *
+ * An asset already cached under key is replaced.
+ *
+ * \param[in] key key identifying the asset.
+ * \param[in] buffer 32 byte aligned buffer holding the asset.
+ * \param[in] len length of the asset.
+ *
+ * \return ARC_OK on success, ARC_EBUSY if the cache was re-initialized meanwhile, ARC_EINVAL or ARC_ENOMEM on failure.
+ */
+s32 ARC_Insert(u32 key,void *buffer,u32 len);
+
+/*!
+ * \fn s32 ARC_Fetch(u32 key,void *dest,u32 offset,u32 len)
+ * \brief Page part of a cached asset into main memory and wait for it.
+ *
+ * \param[in] key key identifying the asset.
+ * \param[in] dest 32 byte aligned destination buffer.
+ * \param[in] offset offset into the asset. Must be a multiple of 32.
+ * \param[in] len number of bytes to transfer. Rounded up to a multiple of 32.
+ *
+ * \return number of bytes transferred, ARC_ENOENT if the asset is not cached or ARC_EINVAL.
+ */
+s32 ARC_Fetch(u32 key,void *dest,u32 offset,u32 len);
+
+/*!
+ * \fn s32 ARC_FetchAsync(ARCRequest *req,u32 key,void *dest,u32 offset,u32 len,ARCCallback cb)
+ * \brief Page part of a cached asset into main memory in the background.
+ *
+ * The asset cannot be evicted until cb has been called.
+ *
+ * \param[in] req request structure. Must stay valid until cb has been called.
+ * \param[in] key key identifying the asset.
+ * \param[in] dest 32 byte aligned destination buffer.
+ * \param[in] offset offset into the asset. Must be a multiple of 32.
+ * \param[in] len number of bytes to transfer. Rounded up to a multiple of 32.
+ * \param[in] cb callback to call when the transfer has finished.
+ *
+ * \return ARC_OK if the transfer was queued, ARC_ENOENT if the asset is not cached or ARC_EINVAL.
+ */
+s32 ARC_FetchAsync(ARCRequest *req,u32 key,void *dest,u32 offset,u32 len,ARCCallback cb);
+
+/*!
+ * \fn s32 ARC_Load(u32 key,void *dest,u32 len,ARCLoader loader,void *usrdata)
+ * \brief Read an asset through the cache.
+ *
+ * On a hit the asset is paged in from ARAM. On a miss loader reads it into dest, e.g. from DVD or SD, and
+ * the result is inserted into the cache for next time. If the loader read less than len, later hits return
+ * that shorter length.
+ *
+ * \param[in] key key identifying the asset.
+ * \param[in] dest 32 byte aligned destination buffer, large enough for len rounded up to 32 bytes.
+ * \param[in] len length of the asset.
+ * \param[in] loader function used to read the asset on a miss.
+ * \param[in] usrdata user data passed to loader.
+ *
+ * \return number of bytes read, ARC_EINVAL or ARC_EIO if loader failed.
+ */
+s32 ARC_Load(u32 key,void *dest,u32 len,ARCLoader loader,void *usrdata);
+
+/*!
+ * \fn BOOL ARC_Contains(u32 key)
+ * \brief Check whether an asset is cached.
+ *
+ * \param[in] key key identifying the asset.
+ *
+ * \return TRUE if the asset is cached, FALSE otherwise.
+ */
+BOOL ARC_Contains(u32 key);
+
+/*!
+ * \fn void ARC_Evict(u32 key)
+ * \brief Drop an asset from the cache. Storage of an asset with fetches in flight is released once they finish.
+ *
+ * \param[in] key key identifying the asset.
+ *
+ * \return none
+ */
+void ARC_Evict(u32 key);
+
+/*!
+ * \fn void ARC_Flush(void)
+ * \brief Drop all assets from the cache.
+ *
+ * \return none
+ */
+void ARC_Flush(void);
+
+/*!
+ * \fn void ARC_GetStats(arc_stats *stats)
+ * \brief Return hit/miss counters and ARAM usage of the cache.
+ *
+ * \param[out] stats structure receiving the statistics.
+ *
+ * \return none
+ */
+void ARC_GetStats(arc_stats *stats);
+
+/*!
+ * \fn void ARC_ResetStats(void)
+ * \brief Reset the hit/miss counters of the cache.
+ *
+ * \return none
+ */
+void ARC_ResetStats(void);
+
+#ifdef __cplusplus
+   }
+#endif /* __cplusplus */
+
+#endif
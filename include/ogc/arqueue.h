@@ -56,11 +56,17 @@ enum {
 typedef struct _arq_request ARQRequest;
 typedef void (*ARQCallback)(ARQRequest *);
 
+typedef struct _arq_segment {
+	u32 aram_addr,mram_addr,len;
+} ARQSegment;
+
 struct _arq_request {
 	lwp_node node;
 	u32 owner,dir,prio,state;
 	u32 aram_addr,mram_addr,len;
 	ARQCallback callback;
+	const ARQSegment *segs;
+	u32 nsegs;
 };
 
 void ARQ_Init(void);
@@ -102,9 +108,56 @@ void ARQ_PostRequest(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u3
  * \return none
  */
 void ARQ_PostRequestAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u32 mram_addr,u32 len,ARQCallback cb);
+/*!
+ * \fn void ARQ_PostRequestSG(ARQRequest *req,u32 owner,u32 dir,u32 prio,const ARQSegment *segs,u32 nsegs)
+ * \brief Enqueue a scatter-gather ARAM DMA transfer request and wait for it to finish.
+ *
+ * \param[in] req structure to hold ARAM DMA request informations.
+ * \param[in] owner unique owner id.
+ * \param[in] dir direction of ARAM DMA transfer.
+ * \param[in] prio priority of request.
+ * \param[in] segs array of segments to transfer. Addresses and lengths must be 32-byte aligned.
+ * \param[in] nsegs number of segments.
+ *
+ * \return none
+ */
+void ARQ_PostRequestSG(ARQRequest *req,u32 owner,u32 dir,u32 prio,const ARQSegment *segs,u32 nsegs);
+
+/*!
+ * \fn void ARQ_PostRequestSGAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,const ARQSegment *segs,u32 nsegs,ARQCallback cb)
+ * \brief Enqueue a scatter-gather ARAM DMA transfer request.
+ *
+ * The segments are transferred back to back from the DMA interrupt and cb is called once after the last one.
+ * The segment array must stay valid until then.
+ *
+ * \param[in] req structure to hold ARAM DMA request informations.
+ * \param[in] owner unique owner id.
+ * \param[in] dir direction of ARAM DMA transfer.
+ * \param[in] prio priority of request.
+ * \param[in] segs array of segments to transfer. Addresses and lengths must be 32-byte aligned.
+ * \param[in] nsegs number of segments.
+ * \param[in] cb callback to call when the whole request has finished.
+ *
+ * \return none
+ */
+void ARQ_PostRequestSGAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,const ARQSegment *segs,u32 nsegs,ARQCallback cb);
+
 void ARQ_RemoveRequest(ARQRequest *req);
 void ARQ_SetChunkSize(u32 size);
 u32 ARQ_GetChunkSize(void);
+
+/*!
+ * \fn void ARQ_SetMaxLatency(u32 usecs)
+ * \brief Bounds how long a high priority request may wait behind a low priority transfer.
+ *
+ * Low priority requests are split into chunks sized from the measured DMA throughput so that
+ * each chunk finishes within usecs. Pass 0 to go back to the fixed chunk size set with ARQ_SetChunkSize().
+ *
+ * \param[in] usecs latency bound in microseconds.
+ *
+ * \return none
+ */
+void ARQ_SetMaxLatency(u32 usecs);
 void ARQ_FlushQueue(void);
 u32 ARQ_RemoveOwnerRequest(u32 owner);
 
@@ -63,6 +63,19 @@ void CON_GetMetrics(int *cols, int *rows);
  */
 void CON_GetPosition(int *cols, int *rows);
 
+/*!
+ * \fn CON_EnableDirtyCopy(bool enable)
+ * \brief Copy only the rows printed to since the last retrace from the CON_InitEx() console to the external framebuffer.
+ *
+ * By default the whole console is copied on every retrace. Only enable this if nothing else draws over the console's
+ * part of the framebuffer; switching framebuffers is detected and still copies every row.
+ *
+ * \param[in] enable true to copy changed rows only, false to copy the whole console
+ *
+ * \return none
+ */
+void CON_EnableDirtyCopy(bool enable);
+
 /*!
  * \fn CON_EnableGecko(s32 chan,bool safe)
  * \brief Enable or disable the USB Gecko console.
@@ -100,6 +100,19 @@ distribution.
  */
 
 
+/*! 
+ * \addtogroup dvd_schedmode DVD scheduling modes
+ * @{
+ */
+
+#define DVD_SCHED_FIFO					0			/*!< Service requests of a priority level in arrival order */
+#define DVD_SCHED_CSCAN					1			/*!< Order reads of a priority level by disc offset and merge adjacent ones */
+
+/*!
+ * @}
+ */
+
+
 #ifdef __cplusplus
    extern "C" {
 #endif /* __cplusplus */
@@ -184,6 +197,7 @@ struct _dvdcmdblk {
 	dvddiskid *id;
 	dvdcbcallback cb;
 	void *usrdata;
+	u32 deadline;
 };
 
 
@@ -424,6 +438,22 @@ s32 DVD_GetStreamLength(dvdcmdblk *block);
 s32 DVD_GetStreamLengthAsync(dvdcmdblk *block,dvdcbcallback cb);
 s32 DVD_ReadDiskID(dvdcmdblk *block,dvddiskid *id,dvdcbcallback cb);
 u32 DVD_SetAutoInvalidation(u32 auto_inv);
+
+/*!
+ * \fn void DVD_SetScheduler(u32 mode,u32 deadline)
+ * \brief Select how queued requests of the same priority are ordered.
+ *
+ *        With DVD_SCHED_CSCAN, reads waiting ahead of any other command are serviced in ascending disc offset from
+ *        the current pickup position, wrapping around to the lowest offset. Reads that continue each other both on
+ *        disc and in memory are merged into one drive command. The oldest request is serviced first once it has
+ *        waited longer than deadline.
+ *
+ * \param[in] mode \ref dvd_schedmode "scheduling mode" to use
+ * \param[in] deadline maximum time in milliseconds a read may be passed over, 0 for no limit
+ *
+ * \return none
+ */
+void DVD_SetScheduler(u32 mode,u32 deadline);
 dvddiskid* DVD_GetCurrentDiskID(void);
 dvddrvinfo* DVD_GetDriveInfo(void);
 
@@ -353,6 +353,9 @@ void c_guVecCross(const guVector *a,const guVector *b,guVector *axb);
 void c_guVecMultiply(const Mtx mt,const guVector *src,guVector *dst);
 void c_guVecMultiplySR(const Mtx mt,const guVector *src,guVector *dst);
 f32 c_guVecDotProduct(const guVector *a,const guVector *b);
+void c_guVecMultiplyArray(const Mtx mt,const guVector *srcBase,guVector *dstBase,u32 count);
+void c_guVecMultiplySRArray(const Mtx mt,const guVector *srcBase,guVector *dstBase,u32 count);
+void c_guVecNormalizeArray(const guVector *srcBase,guVector *dstBase,u32 count);
 
 #ifdef GEKKO
 void ps_guVecAdd(const guVector *a,const guVector *b,guVector *ab);
@@ -363,6 +366,9 @@ void ps_guVecCross(const guVector *a,const guVector *b,guVector *axb);
 void ps_guVecMultiply(const Mtx mt,const guVector *src,guVector *dst);
 void ps_guVecMultiplySR(const Mtx mt,const guVector *src,guVector *dst);
 f32 ps_guVecDotProduct(const guVector *a,const guVector *b);
+void ps_guVecMultiplyArray(const Mtx mt,const guVector *srcBase,guVector *dstBase,u32 count);
+void ps_guVecMultiplySRArray(const Mtx mt,const guVector *srcBase,guVector *dstBase,u32 count);
+void ps_guVecNormalizeArray(const guVector *srcBase,guVector *dstBase,u32 count);
 #endif	//GEKKO
 
 void c_guQuatAdd(const guQuaternion *a,const guQuaternion *b,guQuaternion *ab);
@@ -383,6 +389,7 @@ void ps_guQuatInverse(const guQuaternion *a,guQuaternion *d);
 void c_guMtxIdentity(Mtx mt);
 void c_guMtxCopy(const Mtx src,Mtx dst);
 void c_guMtxConcat(const Mtx a,const Mtx b,Mtx ab);
+void c_guMtxConcatArray(const Mtx a,const Mtx *srcBase,Mtx *dstBase,u32 count);
 void c_guMtxScale(Mtx mt,f32 xS,f32 yS,f32 zS);
 void c_guMtxScaleApply(const Mtx src,Mtx dst,f32 xS,f32 yS,f32 zS);
 void c_guMtxApplyScale(const Mtx src,Mtx dst,f32 xS,f32 yS,f32 zS);
@@ -402,6 +409,7 @@ void c_guMtxQuat(Mtx m,const guQuaternion *a);
 void ps_guMtxIdentity(Mtx mt);
 void ps_guMtxCopy(const Mtx src,Mtx dst);
 void ps_guMtxConcat(const Mtx a,const Mtx b,Mtx ab);
+void ps_guMtxConcatArray(const Mtx a,const Mtx *srcBase,Mtx *dstBase,u32 count);
 void ps_guMtxTranspose(const Mtx src,Mtx xPose);
 u32 ps_guMtxInverse(const Mtx src,Mtx inv);
 u32 ps_guMtxInvXpose(const Mtx src,Mtx xPose);
@@ -440,6 +448,9 @@ void guMtx44RotAxisRad(Mtx44 mt,const guVector *axis,f32 rad);
 #define guVecCross				c_guVecCross
 #define guVecMultiplySR			c_guVecMultiplySR
 #define guVecDotProduct			c_guVecDotProduct
+#define guVecMultiplyArray		c_guVecMultiplyArray
+#define guVecMultiplySRArray	c_guVecMultiplySRArray
+#define guVecNormalizeArray		c_guVecNormalizeArray
 
 #define guQuatAdd				c_guQuatAdd
 #define guQuatSub				c_guQuatSub
@@ -451,6 +462,7 @@ void guMtx44RotAxisRad(Mtx44 mt,const guVector *axis,f32 rad);
 #define guMtxIdentity			c_guMtxIdentity
 #define guMtxCopy				c_guMtxCopy
 #define guMtxConcat				c_guMtxConcat
+#define guMtxConcatArray		c_guMtxConcatArray
 #define guMtxScale				c_guMtxScale
 #define guMtxScaleApply			c_guMtxScaleApply
 #define guMtxApplyScale			c_guMtxApplyScale
@@ -476,6 +488,9 @@ void guMtx44RotAxisRad(Mtx44 mt,const guVector *axis,f32 rad);
 #define guVecCross				ps_guVecCross
 #define guVecMultiplySR			ps_guVecMultiplySR
 #define guVecDotProduct			ps_guVecDotProduct
+#define guVecMultiplyArray		ps_guVecMultiplyArray
+#define guVecMultiplySRArray	ps_guVecMultiplySRArray
+#define guVecNormalizeArray		ps_guVecNormalizeArray
 
 #define guQuatAdd				ps_guQuatAdd
 #define guQuatSub				ps_guQuatSub
@@ -487,6 +502,7 @@ void guMtx44RotAxisRad(Mtx44 mt,const guVector *axis,f32 rad);
 #define guMtxIdentity			ps_guMtxIdentity
 #define guMtxCopy				ps_guMtxCopy
 #define guMtxConcat				ps_guMtxConcat
+#define guMtxConcatArray		ps_guMtxConcatArray
 #define guMtxScale				ps_guMtxScale
 #define guMtxScaleApply			ps_guMtxScaleApply
 #define guMtxApplyScale			ps_guMtxApplyScale
@@ -29,6 +29,14 @@
 #define GX_FIFO_HIWATERMARK	(16*1024)			/*!< Default hi watermark for FIFO buffer control. */
 #define GX_FIFO_OBJSIZE		128
 
+/*! \addtogroup capturerecord FIFO capture record types
+ * @{
+ */
+#define GX_CAPTURE_FIFO			1			/*!< Commands written to the CPU FIFO. */
+#define GX_CAPTURE_DISPLIST		2			/*!< A display list finished with GX_EndDispList(). */
+#define GX_CAPTURE_VTXSTATE		3			/*!< The vertex descriptor and the 8 vertex formats, as 26 words: VCD lo and hi, then 8 VAT A, 8 VAT B and 8 VAT C. */
+/*! @} */
+
 #define GX_PERSPECTIVE		0
 #define GX_ORTHOGRAPHIC		1
 
@@ -1306,6 +1314,18 @@ typedef struct _gx_litobj {
 	u32 val[16];
 } GXLightObj;
 
+/*! \typedef struct _gx_writestats GXWriteStats
+ * \brief Counters of the register loads sent and dropped by the redundant write filter, see GX_SetWriteFilter().
+ */
+typedef struct _gx_writestats {
+	u32 bpEmitted;		/*!< BP register loads sent to the GP. */
+	u32 bpSuppressed;	/*!< BP register loads dropped because the register already held the value. */
+	u32 cpEmitted;		/*!< CP register loads sent to the GP. */
+	u32 cpSuppressed;	/*!< CP register loads dropped because the register already held the value. */
+	u32 xfEmitted;		/*!< XF register loads sent to the GP. */
+	u32 xfSuppressed;	/*!< XF register loads dropped because the register already held the value. */
+} GXWriteStats;
+
 typedef struct _vtx {
 	f32 x,y,z;
 	u16 s,t;
@@ -5312,6 +5332,96 @@ void GX_ReadBoundingBox(u16 *top,u16 *bottom,u16 *left,u16 *right);
  */
 volatile void* GX_RedirectWriteGatherPipe(void *ptr);
 
+/*!
+ * \fn void GX_SetWriteFilter(u8 enable)
+ * \brief Enables or disables dropping of redundant register loads.
+ *
+ * \details While enabled, GX remembers the last value loaded into each BP, CP and XF register and drops a load that would write the value
+ * the register already holds, e.g. when the same material state is set again for every object. Loads with side effects, such as EFB copies,
+ * texture and TLUT loads, draw sync tokens and performance counters, are always sent. Loads into display lists (see GX_BeginDispList()) or
+ * into a redirected write gather pipe are never dropped.
+ *
+ * \note The remembered state is cleared by this function, GX_CallDispList(), GX_AbortFrame(), GX_SetCPUFifo() and GX_SetGPFifo(). If the
+ * application loads registers itself through the WGPipe union, it must call GX_InvalidateWriteFilter() afterwards.
+ *
+ * \param[in] enable <tt>GX_ENABLE</tt> to drop redundant loads, <tt>GX_DISABLE</tt> to send all loads (the default)
+ *
+ * \return none
+ */
+void GX_SetWriteFilter(u8 enable);
+
+/*!
+ * \fn void GX_InvalidateWriteFilter(void)
+ * \brief Forgets the register state remembered by the redundant write filter, so the next load of each register is sent.
+ *
+ * \return none
+ */
+void GX_InvalidateWriteFilter(void);
+
+/*!
+ * \fn void GX_GetWriteStats(GXWriteStats *stats)
+ * \brief Returns the number of register loads sent and dropped per register class while the redundant write filter was enabled.
+ *
+ * \param[out] stats structure receiving the counters
+ *
+ * \return none
+ */
+void GX_GetWriteStats(GXWriteStats *stats);
+
+/*!
+ * \fn void GX_ClearWriteStats(void)
+ * \brief Resets the counters returned by GX_GetWriteStats() to zero.
+ *
+ * \return none
+ */
+void GX_ClearWriteStats(void);
+
+/*!
+ * \fn void GX_StartCapture(void *buf,u32 size)
+ * \brief Starts copying the commands sent to the GP into a ring buffer, for inspection with the GXD_* decoder.
+ *
+ * \details The commands written to the CPU FIFO are collected at every GX_Flush() (and so also at GX_DrawDone(), GX_SetDrawDone() and
+ * GX_SetDrawSync()); display lists are collected when they are finished with GX_EndDispList(). Each piece is stored as a record made of a
+ * word holding the \ref capturerecord "record type" in the upper 8 bits and the length of the data in the lower 24 bits, followed by the
+ * data padded to a multiple of 4 bytes. Records that don't fit into the free part of the ring are dropped, see GX_GetCaptureLost().
+ *
+ * \note Commands must reach the CPU FIFO at least once per FIFO size through GX_Flush(), or older ones are overwritten before they are
+ * collected. Flush before switching FIFOs with GX_SetCPUFifo().
+ *
+ * \param[in] buf 4 byte aligned ring buffer, or NULL to drop the current capture
+ * \param[in] size size of the ring buffer in bytes
+ *
+ * \return none
+ */
+void GX_StartCapture(void *buf,u32 size);
+
+/*!
+ * \fn void GX_StopCapture(void)
+ * \brief Collects the outstanding commands and stops the capture. Records not read yet remain available to GX_ReadCapture().
+ *
+ * \return none
+ */
+void GX_StopCapture(void);
+
+/*!
+ * \fn u32 GX_ReadCapture(void *buf,u32 len)
+ * \brief Moves the oldest complete records out of the capture ring buffer.
+ *
+ * \param[out] buf destination buffer; a buffer as large as the ring buffer always takes at least one record
+ * \param[in] len size of the destination buffer in bytes
+ *
+ * \return number of bytes copied
+ */
+u32 GX_ReadCapture(void *buf,u32 len);
+
+/*!
+ * \fn u32 GX_GetCaptureLost(void)
+ * \brief Returns the number of command bytes dropped since GX_StartCapture() because the ring buffer was full.
+ *
+ * \return number of bytes
+ */
+u32 GX_GetCaptureLost(void);
+
 /*!
  * \def GX_InitLightPosv(lo,vec)
  * \brief Sets the position of the light in the light object using a vector structure.
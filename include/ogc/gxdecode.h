@@ -0,0 +1,184 @@
+/*-------------------------------------------------------------
+
+gxdecode.h -- GX command stream decoder
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#ifndef __OGC_GXDECODE_H__
+#define __OGC_GXDECODE_H__
+
+/*!
+ * \file gxdecode.h
+ * \brief GX command stream decoder
+ *
+ * Parses the commands sent to the GP, as collected by GX_StartCapture() or found in a display list, into BP/CP/XF register loads and
+ * primitive draws. Each command can be printed as a line of text, and statistics are gathered per frame, a frame ending with each copy to
+ * the external frame buffer.
+ *
+ * The decoder only depends on the C library and reads the big endian stream byte by byte, so it can also be built on a host together with a
+ * dump of GX_ReadCapture(), e.g. <tt>cc -Iinclude -Iinclude/ogc libogc/gxdecode.c tool.c</tt>.
+ */
+
+#include <gctypes.h>
+
+/*! \addtogroup gxdcmd Command classes
+ * @{
+ */
+#define GXD_CMD_NOP				0			/*!< No operation, also the padding written by GX_Flush(). */
+#define GXD_CMD_BP				1			/*!< BP register load. */
+#define GXD_CMD_CP				2			/*!< CP register load. */
+#define GXD_CMD_XF				3			/*!< XF register or memory load. */
+#define GXD_CMD_XFINDEX			4			/*!< Indexed XF memory load. */
+#define GXD_CMD_CALLDL			5			/*!< Display list call. */
+#define GXD_CMD_INVVC			6			/*!< Vertex cache invalidation. */
+#define GXD_CMD_DRAW			7			/*!< Primitive draw, including its vertex data. */
+#define GXD_CMD_UNKNOWN			8			/*!< Unknown opcode. */
+#define GXD_CMD_MAX				9
+/*! @} */
+
+#ifdef __cplusplus
+   extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ * \typedef struct _gxd_stats GXDStats
+ * \brief Statistics of one frame.
+ */
+typedef struct _gxd_stats {
+	u32 frame;					/*!< Number of the frame, counting from 0. */
+	u32 cmdBytes[GXD_CMD_MAX];	/*!< Bytes per \ref gxdcmd "command class". */
+	u32 cmdCount[GXD_CMD_MAX];	/*!< Commands per \ref gxdcmd "command class". */
+	u32 draws;					/*!< Primitive draws. */
+	u32 vertices;				/*!< Vertices over all draws. */
+	u32 loads;					/*!< Register loads; a multi-register XF load counts once per register. */
+	u32 redundantLoads;			/*!< Loads of state registers with the value they already held. */
+	u32 stateChanges;			/*!< Loads changing state registers or XF memory; divided by draws, the state changes per draw. */
+	u32 maxStateChanges;		/*!< Most state changes ahead of a single draw. */
+	u32 dlCalls;				/*!< Display list calls. */
+	u32 dlBytes;				/*!< Size of the display lists called. */
+} GXDStats;
+
+/*!
+ * \typedef void (*GXDOutputCallback)(void *usrdata,const char *line)
+ * \brief function pointer typedef for the receiver of the decoded commands, one line of text each, without line break.
+ */
+typedef void (*GXDOutputCallback)(void *usrdata,const char *line);
+
+/*!
+ * \typedef void (*GXDFrameCallback)(void *usrdata,const GXDStats *stats)
+ * \brief function pointer typedef for the receiver of the statistics at the end of each frame.
+ */
+typedef void (*GXDFrameCallback)(void *usrdata,const GXDStats *stats);
+
+typedef struct _gxd_parser {
+	u32 have;
+	u32 skip;
+	u32 xfaddr;
+	u32 xfleft;
+	u32 nops;
+	u8 cmd[12];
+} GXDParser;
+
+/*!
+ * \typedef struct _gxd_decoder GXDecoder
+ *
+ *        State of a decoder. The fields are private except stats, which holds the statistics of the current frame.
+ */
+typedef struct _gxd_decoder {
+	u32 bp[256];
+	u32 cp[256];
+	u32 xf[256];
+	u32 bpvalid[8];
+	u32 cpvalid[8];
+	u32 xfvalid[8];
+	u32 bpmask;
+	u32 lastbp;
+	u32 changes;
+	u32 indl;
+	GXDParser parser;
+	GXDStats stats;
+	GXDOutputCallback output;
+	GXDFrameCallback framecb;
+	void *usrdata;
+} GXDecoder;
+
+/*!
+ * \fn void GXD_Init(GXDecoder *dec,GXDOutputCallback output,GXDFrameCallback framecb,void *usrdata)
+ * \brief Set up a decoder with no register state known.
+ *
+ * \param[in] dec decoder state.
+ * \param[in] output receiver of the decoded commands, or NULL to only gather statistics.
+ * \param[in] framecb receiver of the per frame statistics, or NULL.
+ * \param[in] usrdata user data passed to both callbacks.
+ *
+ * \return none
+ */
+void GXD_Init(GXDecoder *dec,GXDOutputCallback output,GXDFrameCallback framecb,void *usrdata);
+
+/*!
+ * \fn void GXD_Decode(GXDecoder *dec,const void *data,u32 len)
+ * \brief Decode a piece of a raw command stream, such as the contents of a display list.
+ *
+ * A command cut off at the end of data is completed by the next call.
+ *
+ * \param[in] dec decoder state.
+ * \param[in] data commands.
+ * \param[in] len length of data in bytes.
+ *
+ * \return none
+ */
+void GXD_Decode(GXDecoder *dec,const void *data,u32 len);
+
+/*!
+ * \fn u32 GXD_DecodeCapture(GXDecoder *dec,const void *data,u32 len)
+ * \brief Decode records returned by GX_ReadCapture().
+ *
+ * Display list records are decoded apart from the FIFO stream and don't count towards the frame statistics.
+ *
+ * \param[in] dec decoder state.
+ * \param[in] data records.
+ * \param[in] len length of data in bytes.
+ *
+ * \return number of bytes taken, less than len if data ends with an incomplete record.
+ */
+u32 GXD_DecodeCapture(GXDecoder *dec,const void *data,u32 len);
+
+/*!
+ * \fn void GXD_EndFrame(GXDecoder *dec)
+ * \brief Hand the statistics gathered since the last frame ended to the frame callback and start a new frame.
+ *
+ * \param[in] dec decoder state.
+ *
+ * \return none
+ */
+void GXD_EndFrame(GXDecoder *dec);
+
+#ifdef __cplusplus
+   }
+#endif /* __cplusplus */
+
+#endif
@@ -78,6 +78,20 @@ distribution.
 #define LWP_THREAD_NULL				0xffffffff
 #define LWP_TQUEUE_NULL				0xffffffff
 
+#define LWP_OBJCLASS_THREAD			0
+#define LWP_OBJCLASS_TQUEUE			1
+#define LWP_OBJCLASS_MUTEX			2
+#define LWP_OBJCLASS_SEMAPHORE		3
+#define LWP_OBJCLASS_CONDVAR		4
+#define LWP_OBJCLASS_MQUEUE			5
+#define LWP_OBJCLASS_ALARM			6
+
+#define LWP_TRACE_DISPATCH			1
+#define LWP_TRACE_BLOCK				2
+#define LWP_TRACE_UNBLOCK			3
+#define LWP_TRACE_IRQENTER			4
+#define LWP_TRACE_IRQEXIT			5
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -94,6 +108,58 @@ typedef u32 lwp_t;
 */
 typedef u32 lwpq_t;
 
+
+/*! \typedef struct _lwp_objstats lwp_objstats
+\brief usage of one kernel object pool
+\param inuse objects currently allocated
+\param allocated objects backed by memory, in use or free
+\param limit maximum number of objects the pool may grow to
+\param highwater largest number of objects in use at the same time
+*/
+typedef struct _lwp_objstats {
+	u32 inuse;
+	u32 allocated;
+	u32 limit;
+	u32 highwater;
+} lwp_objstats;
+
+
+/*! \typedef struct _lwp_threadstats lwp_threadstats
+\brief CPU accounting of one thread
+\param cpu_ticks timebase ticks the thread has been running
+\param switches number of times the thread was dispatched
+*/
+typedef struct _lwp_threadstats {
+	u64 cpu_ticks;
+	u32 switches;
+} lwp_threadstats;
+
+
+/*! \typedef struct _lwp_traceevt lwp_traceevt
+\brief one scheduler trace record
+\param time timebase value the event was recorded at
+\param type one of the LWP_TRACE_* values
+\param arg0 thread index (for LWP_TRACE_DISPATCH the thread switched out), or the IRQ number
+\param arg1 thread index switched in for LWP_TRACE_DISPATCH, the new thread state for LWP_TRACE_BLOCK
+*/
+typedef struct _lwp_traceevt {
+	u64 time;
+	u32 type;
+	u32 arg0;
+	u32 arg1;
+} lwp_traceevt;
+
+
+/*! \typedef s32 (*lwp_tracewrite)(const char *data,u32 len,void *usrdata)
+\brief function receiving the exported trace text
+\param[in] data pointer to the next piece of text
+\param[in] len length of the text
+\param[in] usrdata user data passed to LWP_TraceExport()
+
+\return number of bytes written, negative to abort the export
+*/
+typedef s32 (*lwp_tracewrite)(const char *data,u32 len,void *usrdata);
+
 /*! \fn s32 LWP_CreateThread(lwp_t *thethread,void* (*entry)(void *),void *arg,void *stackbase,u32 stack_size,u8 prio)
 \brief Spawn a new thread with the given parameters
 \param[out] thethread pointer to a lwp_t handle
@@ -282,6 +348,74 @@ s32 LWP_ThreadSignal(lwpq_t thequeue);
 */
 s32 LWP_ThreadBroadcast(lwpq_t thequeue);
 
+
+/*! \fn s32 LWP_GetObjectStats(u32 objclass,lwp_objstats *stats)
+\brief Reports the usage of a kernel object pool.
+\param[in] objclass one of the LWP_OBJCLASS_* values
+\param[out] stats pointer to a lwp_objstats structure to fill
+
+\return 0 on success, non-zero on error
+*/
+s32 LWP_GetObjectStats(u32 objclass,lwp_objstats *stats);
+
+
+/*! \fn s32 LWP_GetThreadStats(lwp_t thethread,lwp_threadstats *stats)
+\brief Reports how long a thread has been running and how often it was dispatched.
+\param[in] thethread handle to the thread
+\param[out] stats pointer to a lwp_threadstats structure to fill
+
+\return 0 on success, non-zero on error
+*/
+s32 LWP_GetThreadStats(lwp_t thethread,lwp_threadstats *stats);
+
+
+/*! \fn s32 LWP_TraceStart(lwp_traceevt *buffer,u32 count)
+\brief Starts recording scheduler and interrupt events into a ring buffer.
+
+Once the buffer is full the oldest events are overwritten.
+\param[in] buffer pointer to the ring buffer, it must stay valid until LWP_TraceStop() is called
+\param[in] count number of events the buffer holds, must be a power of two
+
+\return 0 on success, non-zero on error
+*/
+s32 LWP_TraceStart(lwp_traceevt *buffer,u32 count);
+
+
+/*! \fn void LWP_TraceStop(void)
+\brief Stops recording trace events. The recorded events stay in the buffer.
+
+\return none
+*/
+void LWP_TraceStop(void);
+
+
+/*! \fn s32 LWP_TraceExport(lwp_tracewrite writefn,void *usrdata)
+\brief Stops recording and writes the recorded events in Chrome trace event JSON format.
+\param[in] writefn function receiving the text
+\param[in] usrdata user data passed to writefn
+
+\return 0 on success, non-zero on error
+*/
+s32 LWP_TraceExport(lwp_tracewrite writefn,void *usrdata);
+
+
+/*! \fn s32 LWP_TraceExportFile(const char *filename)
+\brief Stops recording and saves the recorded events to a file in Chrome trace event JSON format.
+\param[in] filename path of the file to create
+
+\return 0 on success, non-zero on error
+*/
+s32 LWP_TraceExportFile(const char *filename);
+
+
+/*! \fn s32 LWP_TraceExportUSBGecko(s32 chn)
+\brief Stops recording and sends the recorded events over a USB Gecko in Chrome trace event JSON format.
+\param[in] chn EXI channel the USB Gecko is plugged into
+
+\return 0 on success, non-zero on error
+*/
+s32 LWP_TraceExportUSBGecko(s32 chn);
+
 #ifdef __cplusplus
 	}
 #endif
@@ -68,4 +68,16 @@ distribution.
 
 #define LWP_MAX_WATCHDOGS			64
 
+/* The LWP_MAX_* objects are allocated at startup; a pool grows on demand up
+ * to its LWP_LIMIT_* value. An application can set its own limit at link
+ * time by defining the matching __lwp_limit_* variable, e.g.
+ * u32 __lwp_limit_threads = 128; */
+#define LWP_LIMIT_MQUEUES			256
+#define LWP_LIMIT_MUTEXES			256
+#define LWP_LIMIT_THREADS			64
+#define LWP_LIMIT_SEMAS				256
+#define LWP_LIMIT_CONDVARS			256
+#define LWP_LIMIT_TQUEUES			256
+#define LWP_LIMIT_WATCHDOGS			256
+
 #endif
@@ -56,6 +56,7 @@ distribution.
 
 #include <gctypes.h>
 #include "machine/asm.h"
+#include "machine/processor.h"
 
 #define HEAP_BLOCK_USED					1
 #define HEAP_BLOCK_FREE					0
@@ -66,6 +67,15 @@ distribution.
 #define HEAP_BLOCK_USED_OVERHEAD		(sizeof(void*)*2)
 #define HEAP_MIN_SIZE					(HEAP_OVERHEAD+sizeof(heap_block))
 
+#define HEAP_MODE_FIRSTFIT				0
+#define HEAP_MODE_TLSF					1
+
+#define HEAP_TLSF_SL_INDEX_LOG2			4
+#define HEAP_TLSF_SL_INDEX_COUNT		(1<<HEAP_TLSF_SL_INDEX_LOG2)
+#define HEAP_TLSF_FL_INDEX_SHIFT		(HEAP_TLSF_SL_INDEX_LOG2+3)
+#define HEAP_TLSF_FL_INDEX_COUNT		(32-HEAP_TLSF_FL_INDEX_SHIFT+1)
+#define HEAP_TLSF_SMALL_BLOCK_SIZE		(1<<HEAP_TLSF_FL_INDEX_SHIFT)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -85,6 +95,12 @@ typedef struct _heap_iblock_st {
 	u32 used_size;
 } heap_iblock;
 
+typedef struct _heap_tlsf_st {
+	u32 fl_bitmap;
+	u32 sl_bitmap[HEAP_TLSF_FL_INDEX_COUNT];
+	heap_block *blocks[HEAP_TLSF_FL_INDEX_COUNT][HEAP_TLSF_SL_INDEX_COUNT];
+} heap_tlsf;
+
 typedef struct _heap_cntrl_st {
 	heap_block *start;
 	heap_block *final;
@@ -94,9 +110,11 @@ typedef struct _heap_cntrl_st {
 	heap_block *last;
 	u32 pg_size;
 	u32 reserved;
+	heap_tlsf *tlsf;
 } heap_cntrl;
 
 u32 __lwp_heap_init(heap_cntrl *theheap,void *start_addr,u32 size,u32 pg_size);
+u32 __lwp_heap_init_mode(heap_cntrl *theheap,void *start_addr,u32 size,u32 pg_size,u32 mode);
 void* __lwp_heap_allocate(heap_cntrl *theheap,u32 size);
 BOOL __lwp_heap_free(heap_cntrl *theheap,void *ptr);
 u32 __lwp_heap_getinfo(heap_cntrl *theheap,heap_iblock *theinfo);
@@ -57,9 +57,14 @@ distribution.
 #include <gctypes.h>
 #include "lwp_queue.h"
 
-#define LWP_OBJMASKTYPE(type)		((type)<<16)
-#define LWP_OBJMASKID(id)			((id)&0xffff)
-#define LWP_OBJTYPE(id)				((id)>>16)
+/* handle layout: type[31:24] generation[23:16] index[15:0]
+ * object ids carry generation and index, so a handle to a freed and
+ * reused object no longer matches */
+#define LWP_OBJMASKTYPE(type)		((type)<<24)
+#define LWP_OBJMASKID(id)			((id)&0x00ffffff)
+#define LWP_OBJTYPE(id)				(((id)>>24)&0xff)
+#define LWP_OBJINDEX(id)			((id)&0xffff)
+#define LWP_OBJGEN(id)				(((id)>>16)&0xff)
 
 #ifdef __cplusplus
 extern "C" {
@@ -82,9 +87,14 @@ struct _lwp_objinfo {
 	void *obj_blocks;
 	lwp_queue inactives;
 	u32 inactives_cnt;
+	u32 alloc_nodes;
+	u32 grow_nodes;
+	u32 hwm;
+	u32 extending;
 };
 
 void __lwp_objmgr_initinfo(lwp_objinfo *info,u32 max_nodes,u32 node_size);
+void __lwp_objmgr_initinfoex(lwp_objinfo *info,u32 init_nodes,u32 max_nodes,u32 node_size);
 void __lwp_objmgr_free(lwp_objinfo *info,lwp_obj *object);
 lwp_obj* __lwp_objmgr_allocate(lwp_objinfo *info);
 lwp_obj* __lwp_objmgr_get(lwp_objinfo *info,u32 id);
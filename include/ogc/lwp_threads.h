@@ -61,6 +61,7 @@ distribution.
 #include "lwp_watchdog.h"
 #include "lwp_objmgr.h"
 #include "context.h"
+#include "lwp.h"
 
 //#define _LWPTHREADS_DEBUG
 #define LWP_TIMESLICE_TIMER_ID			0x00070040
@@ -115,6 +116,10 @@ typedef struct _lwpcntrl {
 	lwp_thrqueue join_list;
 	frame_context context;		//16
 	void *libc_reent;
+
+	u64 cpu_ticks;
+	u64 switch_time;
+	u32 switch_cnt;
 } lwp_cntrl, *lwp_cntrl_t;
 
 extern lwp_cntrl *_thr_main;
@@ -130,6 +135,10 @@ extern u32 _lwp_ticks_per_timeslice;
 extern void **__lwp_thr_libc_reent;
 extern lwp_queue _lwp_thr_ready[];
 
+extern lwp_traceevt *_lwp_trace_buf;
+extern u32 _lwp_trace_mask;
+extern u32 _lwp_trace_head;
+
 void __thread_dispatch();
 void __lwp_thread_yield();
 void __lwp_thread_closeall();
@@ -74,16 +74,15 @@ distribution.
 extern "C" {
 #endif
 
-extern vu32 _wd_sync_level;
-extern vu32 _wd_sync_count;
-extern u32 _wd_ticks_since_boot;
-
-extern lwp_queue _wd_ticks_queue;
-
 typedef void (*wd_service_routine)(void *);
 
+/* Watchdogs are kept in a pairing heap ordered by fire time: insert is O(1),
+ * removal O(log n) amortized. prev points to the left sibling, or to the
+ * parent for a first child. */
 typedef struct _wdcntrl {
-	lwp_node node;
+	struct _wdcntrl *child;
+	struct _wdcntrl *sibling;
+	struct _wdcntrl *prev;
 	u64 start;
 	u32 id;
 	u32 state;
@@ -92,12 +91,19 @@ typedef struct _wdcntrl {
 	void *usr_data;
 } wd_cntrl;
 
+typedef struct _wdqueue {
+	wd_cntrl *root;
+} wd_queue;
+
+extern u32 _wd_ticks_since_boot;
+
+extern wd_queue _wd_ticks_queue;
+
 void __lwp_watchdog_init();
-void __lwp_watchdog_settimer(wd_cntrl *wd);
-void __lwp_wd_insert(lwp_queue *header,wd_cntrl *wd);
-u32 __lwp_wd_remove(lwp_queue *header,wd_cntrl *wd);
-void __lwp_wd_tickle(lwp_queue *queue);
-void __lwp_wd_adjust(lwp_queue *queue,u32 dir,s64 interval);
+void __lwp_wd_insert(wd_queue *header,wd_cntrl *wd);
+u32 __lwp_wd_remove(wd_queue *header,wd_cntrl *wd);
+void __lwp_wd_tickle(wd_queue *queue);
+void __lwp_wd_adjust(wd_queue *queue,u32 dir,s64 interval);
 
 #ifdef LIBOGC_INTERNAL
 #include <libogc/lwp_watchdog.inl>
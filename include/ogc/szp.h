@@ -0,0 +1,164 @@
+/*-------------------------------------------------------------
+
+szp.h -- Yay0/Yaz0 decompression
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#ifndef __OGC_SZP_H__
+#define __OGC_SZP_H__
+
+/*!
+ * \file szp.h
+ * \brief Yay0/Yaz0 decompression
+ *
+ * Decompresses data in the Yay0 (SZP) and Yaz0 (SZS) formats, either in one go from memory or incrementally,
+ * pulling compressed input through a reader callback and producing output in chunks of the caller's choosing.
+ */
+
+#include <gctypes.h>
+
+#define SZP_FORMAT_YAY0			0
+#define SZP_FORMAT_YAZ0			1
+
+#define SZP_ERROR_FORMAT		-1
+#define SZP_ERROR_READ			-2
+#define SZP_ERROR_DATA			-3
+
+#define SZP_WINDOWSIZE			4096
+#define SZP_STREAMBUFSIZE		512
+
+#ifdef __cplusplus
+   extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ * \typedef s32 (*szpreadcb)(void *usrdata,u32 offset,void *buf,u32 len)
+ * \brief function pointer typedef for the reader supplying compressed data to an incremental decoder.
+ * \param[in] usrdata user data passed to SZP_Init().
+ * \param[in] offset offset into the compressed data, counted from its header.
+ * \param[out] buf 32 byte aligned buffer to fill.
+ * \param[in] len maximum number of bytes to read.
+ *
+ * \return number of bytes read, 0 at the end of the data or a negative value on error.
+ */
+typedef s32 (*szpreadcb)(void *usrdata,u32 offset,void *buf,u32 len);
+
+typedef struct _szpstream {
+	u8 buf[SZP_STREAMBUFSIZE] __attribute__((aligned(32)));
+	u32 offset;
+	u32 pos;
+	u32 len;
+} szpstream;
+
+/*!
+ * \typedef struct _szpdecoder szpdecoder
+ *
+ *        State of an incremental decoder. The fields are private except dec_size and out_pos.
+ */
+typedef struct _szpdecoder {
+	szpstream code;
+	szpstream links;
+	szpstream chunks;
+	u8 window[SZP_WINDOWSIZE];
+	szpreadcb reader;
+	void *usrdata;
+	u32 format;
+	u32 dec_size;
+	u32 out_pos;
+	u32 mask;
+	u32 mask_bits;
+	u32 copy_len;
+	u32 copy_dist;
+} szpdecoder;
+
+/*!
+ * \fn s32 SZP_GetDecodedSize(const void *src)
+ * \brief Return the decompressed size of Yay0 or Yaz0 data.
+ *
+ * \param[in] src compressed data, at least its 16 byte header.
+ *
+ * \return decompressed size in bytes or SZP_ERROR_FORMAT.
+ */
+s32 SZP_GetDecodedSize(const void *src);
+
+/*!
+ * \fn s32 SZP_Decompress(const void *src,void *dest)
+ * \brief Decompress Yay0 or Yaz0 data held entirely in memory.
+ *
+ * \param[in] src compressed data.
+ * \param[out] dest destination buffer, large enough for the decompressed size.
+ *
+ * \return decompressed size in bytes, SZP_ERROR_FORMAT or SZP_ERROR_DATA.
+ */
+s32 SZP_Decompress(const void *src,void *dest);
+
+/*!
+ * \fn s32 SZP_Init(szpdecoder *dec,szpreadcb reader,void *usrdata)
+ * \brief Set up an incremental decoder and read the header of the compressed data.
+ *
+ * \param[in] dec decoder state.
+ * \param[in] reader function supplying the compressed data.
+ * \param[in] usrdata user data passed to reader.
+ *
+ * \return decompressed size in bytes, SZP_ERROR_FORMAT or SZP_ERROR_READ.
+ */
+s32 SZP_Init(szpdecoder *dec,szpreadcb reader,void *usrdata);
+
+/*!
+ * \fn s32 SZP_Decode(szpdecoder *dec,void *dest,u32 len)
+ * \brief Produce the next chunk of decompressed data.
+ *
+ * Larger chunks are faster; back-references within a chunk are copied straight out of dest.
+ *
+ * \param[in] dec decoder state.
+ * \param[out] dest destination buffer.
+ * \param[in] len maximum number of bytes to produce.
+ *
+ * \return number of bytes produced, 0 once all data has been produced, SZP_ERROR_READ or SZP_ERROR_DATA.
+ */
+s32 SZP_Decode(szpdecoder *dec,void *dest,u32 len);
+
+/*!
+ * \fn s32 SZP_DecodeToARAM(szpdecoder *dec,u32 aram_addr,void *staging,u32 staging_len)
+ * \brief Decompress the remaining data into ARAM through a staging buffer in main memory.
+ *
+ *        ARQ_Init() has to be called beforehand.
+ *
+ * \param[in] dec decoder state.
+ * \param[in] aram_addr 32 byte aligned ARAM destination, with room for the size rounded up to 32 bytes.
+ * \param[in] staging 32 byte aligned staging buffer.
+ * \param[in] staging_len size of the staging buffer, a multiple of 32 bytes.
+ *
+ * \return number of bytes produced, SZP_ERROR_READ or SZP_ERROR_DATA.
+ */
+s32 SZP_DecodeToARAM(szpdecoder *dec,u32 aram_addr,void *staging,u32 staging_len);
+
+#ifdef __cplusplus
+   }
+#endif /* __cplusplus */
+
+#endif
@@ -39,12 +39,92 @@ distribution.
 
 #include <gctypes.h>
 
+/*! \addtogroup cmprquality CMPR compression quality
+ * @{
+ */
+
+#define TEXCONV_CMPR_FAST		0			/*!< Inset bounding box endpoints only */
+#define TEXCONV_CMPR_HIGH		1			/*!< Principal axis endpoints with least-squares refinement */
+
+/*! @} */
+
 #ifdef __cplusplus
    extern "C" {
 #endif /* __cplusplus */
 
 void MakeTexture565(const void *src,void *dst,s32 width,s32 height);
 
+/*! \fn s32 TexConv_Encode(const void *src,void *dst,u16 width,u16 height,u8 fmt,u8 quality)
+\brief Converts a linear RGBA8 image into the tiled layout of a GX texture format.
+
+Edge tiles are padded by replicating the last row and column. Intensity formats use the Rec. 601 luma of the source.
+
+\param[in] src linear image, 4 bytes per texel in R,G,B,A order
+\param[out] dst destination buffer of at least GX_GetTexBufferSize() bytes
+\param[in] width width of the image in texels
+\param[in] height height of the image in texels
+\param[in] fmt one of GX_TF_I4, GX_TF_I8, GX_TF_IA4, GX_TF_IA8, GX_TF_RGB565, GX_TF_RGB5A3, GX_TF_RGBA8 or GX_TF_CMPR
+\param[in] quality \ref cmprquality "CMPR compression quality", ignored for the other formats
+
+\return number of bytes written, <0 on error
+*/
+s32 TexConv_Encode(const void *src,void *dst,u16 width,u16 height,u8 fmt,u8 quality);
+
+/*! \fn s32 TexConv_EncodeCI(const void *src,void *dst,u16 width,u16 height,u8 fmt)
+\brief Converts a linear color index image into the tiled layout of a GX color index format.
+
+\param[in] src linear image of u8 indices for GX_TF_CI4 and GX_TF_CI8, or u16 indices for GX_TF_CI14
+\param[out] dst destination buffer of at least GX_GetTexBufferSize() bytes
+\param[in] width width of the image in texels
+\param[in] height height of the image in texels
+\param[in] fmt one of GX_TF_CI4, GX_TF_CI8 or GX_TF_CI14
+
+\return number of bytes written, <0 on error
+*/
+s32 TexConv_EncodeCI(const void *src,void *dst,u16 width,u16 height,u8 fmt);
+
+/*! \fn s32 TexConv_EncodeTlut(const void *src,void *dst,u16 entries,u8 fmt)
+\brief Converts an RGBA8 palette into a TLUT for use with GX_InitTlutObj().
+
+\param[in] src palette, 4 bytes per entry in R,G,B,A order
+\param[out] dst destination buffer of at least \a entries * 2 bytes
+\param[in] entries number of palette entries
+\param[in] fmt one of GX_TL_IA8, GX_TL_RGB565 or GX_TL_RGB5A3
+
+\return number of bytes written, <0 on error
+*/
+s32 TexConv_EncodeTlut(const void *src,void *dst,u16 entries,u8 fmt);
+
+/*! \fn void TexConv_Downsample(const void *src,void *dst,u16 width,u16 height)
+\brief Box filters a linear RGBA8 image down to the next mipmap level.
+
+\a dst may equal \a src to reduce the image in place.
+
+\param[in] src linear image, 4 bytes per texel
+\param[out] dst destination image of max(width/2,1) x max(height/2,1) texels
+\param[in] width width of the source image in texels
+\param[in] height height of the source image in texels
+
+\return none
+*/
+void TexConv_Downsample(const void *src,void *dst,u16 width,u16 height);
+
+/*! \fn s32 TexConv_EncodeMipmaps(const void *src,void *dst,u16 width,u16 height,u8 fmt,u8 quality,u8 maxlod,void *scratch)
+\brief Generates and encodes a mipmap chain, laid out as expected by GX_InitTexObjLOD().
+
+\param[in] src linear image of the base level, 4 bytes per texel in R,G,B,A order
+\param[out] dst destination buffer of at least GX_GetTexBufferSize(width,height,fmt,GX_TRUE,maxlod+1) bytes
+\param[in] width width of the base level in texels
+\param[in] height height of the base level in texels
+\param[in] fmt texture format, as for TexConv_Encode()
+\param[in] quality \ref cmprquality "CMPR compression quality"
+\param[in] maxlod last level of detail to generate; the chain also stops at 1x1
+\param[in] scratch work buffer of max(width/2,1) * max(height/2,1) * 4 bytes
+
+\return number of bytes written, <0 on error
+*/
+s32 TexConv_EncodeMipmaps(const void *src,void *dst,u16 width,u16 height,u8 fmt,u8 quality,u8 maxlod,void *scratch);
+
 #ifdef __cplusplus
    }
 #endif /* __cplusplus */
@@ -14,6 +14,10 @@ typedef struct _tplfile {
 	int ntextures;
 	void *texdesc;
 	FILE *tpl_file;
+	u32 budget;
+	u32 resident;
+	u32 ticks;
+	void *residency;
 } TPLFile;
 
 s32 TPL_OpenTPLFromFile(TPLFile* tdf, const char* file_name);
@@ -24,6 +28,19 @@ s32 TPL_GetTextureCI(TPLFile *tdf,s32 id,GXTexObj *texObj,GXTlutObj *tlutObj,u8
 s32 TPL_GetTextureInfo(TPLFile *tdf,s32 id,u32 *fmt,u16 *width,u16 *height);
 void TPL_CloseTPLFile(TPLFile *tdf);
 
+// residency budget, in bytes, for texture data paged in by TPL_GetTexture/TPL_GetTextureCI
+// from a file. Least recently used textures beyond the budget are freed and paged in again
+// on their next use, so texture objects obtained earlier must no longer be in use by GX.
+// A budget of 0 disables eviction.
+void TPL_SetResidencyBudget(TPLFile *tdf,u32 budget);
+u32 TPL_GetResidentSize(TPLFile *tdf);
+
+// load mip levels [firstlod,firstlod+nlods) into a caller supplied 32-byte aligned buffer,
+// bypassing the residency cache. nlods of 0 loads every remaining level.
+s32 TPL_GetTextureLoadSize(TPLFile *tdf,s32 id,u8 firstlod,u8 nlods);
+s32 TPL_LoadTexture(TPLFile *tdf,s32 id,u8 firstlod,u8 nlods,void *buffer,u32 len,GXTexObj *texObj);
+s32 TPL_LoadTextureCI(TPLFile *tdf,s32 id,u8 firstlod,u8 nlods,void *buffer,u32 len,void *tlutbuf,GXTexObj *texObj,GXTlutObj *tlutObj,u8 tluts);
+
 #ifdef __cplusplus
    }
 #endif /* __cplusplus */
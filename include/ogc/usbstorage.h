@@ -57,6 +57,17 @@ distribution.
 #define	USBSTORAGE_EINIT		-10009
 #define USBSTORAGE_PROCESSING	-10010
 
+typedef struct
+{
+	u32 requests;			/* completed USBStorage_Read/USBStorage_Write calls */
+	u32 errors;
+	u64 bytes;
+	u64 bounced;			/* bytes copied through the bounce buffer */
+	u64 total_ticks;		/* summed request latency */
+	u64 max_ticks;
+	u64 last_ticks;
+} usbstorage_stats;
+
 typedef struct
 {
 	u8 configuration;
@@ -81,6 +92,8 @@ typedef struct
 	u8 suspended;
 
 	u8 *buffer;
+
+	usbstorage_stats stats;
 } usbstorage_handle;
 
 #define B_RAW_DEVICE_DATA_IN 0x01
@@ -112,6 +125,8 @@ s32 USBStorage_ReadCapacity(usbstorage_handle *dev, u8 lun, u32 *sector_size, u6
 s32 USBStorage_Read(usbstorage_handle *dev, u8 lun, u64 sector, u32 n_sectors, u8 *buffer);
 s32 USBStorage_Write(usbstorage_handle *dev, u8 lun, u64 sector, u32 n_sectors, const u8 *buffer);
 s32 USBStorage_StartStop(usbstorage_handle *dev, u8 lun, u8 lo_ej, u8 start, u8 imm);
+void USBStorage_GetStats(usbstorage_handle *dev, usbstorage_stats *stats);
+void USBStorage_ResetStats(usbstorage_handle *dev);
 
 #define DEVICE_TYPE_WII_USB (('W'<<24)|('U'<<16)|('S'<<8)|'B')
 
@@ -32,6 +32,7 @@ static u32 mp3_volume = 256;
 #define STACKSIZE				(32768)
 
 #define DATABUFFER_SIZE			(32768)
+#define OUTPUT_SLOTS			(8)
 
 typedef struct _eqstate_s
 {
@@ -56,20 +57,24 @@ typedef struct _eqstate_s
 	f32 hg;
 } EQState;
 
-struct _outbuffer_s
+// single producer/single consumer ring of DMA-ready slots. The decoder
+// thread only advances put, the audio callback only advances get.
+struct _outring_s
 {
-	void *bs;
-	u32 *put,*get;
-	s32 buf_filled;
-	u8 buffer[DATABUFFER_SIZE];
+	vu32 put,get;
+	u32 *wptr,*wend;
+	BOOL started;
 };
 
 static u8 InputBuffer[DATABUFFER_SIZE+MAD_BUFFER_GUARD];
-static u8 OutputBuffer[3][ADMA_BUFFERSIZE] ATTRIBUTE_ALIGN(32);
-static struct _outbuffer_s OutputRingBuffer;
+static u8 OutputSlot[OUTPUT_SLOTS][ADMA_BUFFERSIZE] ATTRIBUTE_ALIGN(32);
+static u8 SilenceBuffer[ADMA_BUFFERSIZE] ATTRIBUTE_ALIGN(32);
+static struct _outring_s OutputRing;
 	
 static u32 init_done = 0;
-static u32 CurrentBuffer = 0;
+#ifdef __SNDLIB_H__
+static void *PendingBuffer = NULL;
+#endif
 static f32 VSA = (1.0/4294967295.0);
 static BOOL thr_running = FALSE;
 static BOOL MP3Playing = FALSE;
@@ -106,97 +111,82 @@ static __inline__ s16 FixedToShort(mad_fixed_t Fixed)
 	return((s16)Fixed);
 }
 
-static __inline__ void buf_init(struct _outbuffer_s *buf)
+static __inline__ void ring_init(struct _outring_s *ring)
 {
-	buf->buf_filled = 0;
-	buf->bs = buf->buffer;
-	buf->put = buf->get = buf->bs;
+	ring->put = ring->get = 0;
+	ring->wptr = ring->wend = NULL;
+	ring->started = FALSE;
 }
 
-static __inline__ s32 buf_used(struct _outbuffer_s *buf)
+// a slot may be rewritten once the slot handed off after it has started
+// playing, i.e. two handoffs later
+static __inline__ BOOL ring_full(struct _outring_s *ring)
 {
-	return ((DATABUFFER_SIZE + ((u32)buf->put - (u32)buf->get)) % DATABUFFER_SIZE);
+	u32 get = ring->get;
+	u32 released = (get>2) ? get-2 : 0;
+
+	return ((ring->put - released)>=OUTPUT_SLOTS);
 }
 
-static __inline__ s32 buf_space(struct _outbuffer_s *buf)
+static void ring_start(struct _outring_s *ring)
 {
-	return ((DATABUFFER_SIZE - ((u32)buf->put - (u32)buf->get) - 1) % DATABUFFER_SIZE);
+	ring->started = TRUE;
+#ifndef __SNDLIB_H__
+	AUDIO_InitDMA((u32)SilenceBuffer,ADMA_BUFFERSIZE);
+	AUDIO_StartDMA();
+#else
+	have_samples = 0;
+	SND_SetVoice(0,VOICE_STEREO_16BIT,48000,0,(void*)SilenceBuffer,ADMA_BUFFERSIZE,mp3_volume,mp3_volume,DataTransferCallback);
+#endif
 }
 
-static __inline__ s32 buf_get(struct _outbuffer_s *buf,void *data,s32 len)
+static __inline__ u32* ring_acquire(struct _outring_s *ring)
 {
-	u32 *p;
-	s32 cnt,i;
+	u8 *slot;
 
-	if(len>buf_used(buf))
-		len = buf_used(buf);
+	if(ring->wptr) return ring->wptr;
 
-	if(len==0) {
-		LWP_ThreadSignal(thQueue);
-		return 0;
-	}
-	
-	p = data;
-	cnt = ((u32)buf->bs + DATABUFFER_SIZE - (u32)buf->get);
-	if(len>cnt) {
-		for(i=0;i<(cnt>>2);i++)
-			*p++ = *buf->get++;
-		buf->get = buf->bs;
-		for(i=0;i<((len-cnt)>>2);i++)
-			*p++ = *buf->get++;
-	} else {
-		for(i=0;i<(len>>2);i++)
-			*p++ = *buf->get++;
+	while(ring_full(ring)) {
+		if(thr_running!=TRUE) return NULL;
+		LWP_ThreadSleep(thQueue);
 	}
 
-#ifndef __SNDLIB_H__
-	DCFlushRangeNoSync(data,len);
-#endif
-	LWP_ThreadSignal(thQueue);
-#ifndef __SNDLIB_H__
-	_sync();
-#endif
-	return len;
+	slot = OutputSlot[ring->put%OUTPUT_SLOTS];
+	ring->wptr = (u32*)slot;
+	ring->wend = (u32*)(slot + ADMA_BUFFERSIZE);
+	return ring->wptr;
 }
 
-static __inline__ s32 buf_put(struct _outbuffer_s *buf,void *data,s32 len)
+static __inline__ void ring_publish(struct _outring_s *ring)
 {
-	u32 *p;
-	s32 cnt,i;
-
-	while(len>buf_space(buf))
-		LWP_ThreadSleep(thQueue);
+	u8 *slot = OutputSlot[ring->put%OUTPUT_SLOTS];
 
-	p = data;
-	cnt = ((u32)buf->bs + DATABUFFER_SIZE - (u32)buf->put);
-	if(len>cnt) {
-		for(i=0;i<(cnt>>2);i++)
-			*buf->put++ = *p++;
-		buf->put = buf->bs;
-		for(i=0;i<((len-cnt)>>2);i++)
-			*buf->put++ = *p++;
-	} else {
-		for(i=0;i<(len>>2);i++)
-			*buf->put++ = *p++;
-	}
+	if(ring->wptr<ring->wend)
+		memset(ring->wptr,0,(u32)ring->wend - (u32)ring->wptr);
 
-	if(buf->buf_filled==0 && buf_used(buf)>=(DATABUFFER_SIZE>>1)) {
-		buf->buf_filled = 1;
-		memset(OutputBuffer[CurrentBuffer],0,ADMA_BUFFERSIZE);
+	DCFlushRange(slot,ADMA_BUFFERSIZE);
+	ring->wptr = ring->wend = NULL;
+	ring->put++;
 
-#ifndef __SNDLIB_H__
-		DCFlushRange(OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE);
-		AUDIO_InitDMA((u32)OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE);
-		AUDIO_StartDMA();
-#else
-		have_samples = 0;
-		SND_SetVoice(0,VOICE_STEREO_16BIT,48000,0,(void*)OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE,mp3_volume,mp3_volume,DataTransferCallback);
-#endif
+	if(ring->started==FALSE && ring->put>=(OUTPUT_SLOTS>>1))
+		ring_start(ring);
+}
 
-		CurrentBuffer = (CurrentBuffer+1)%3;
+static __inline__ void* ring_peek(struct _outring_s *ring)
+{
+	if(thr_running==TRUE && ring->get!=ring->put) {
+		MP3Playing = TRUE;
+		return OutputSlot[ring->get%OUTPUT_SLOTS];
 	}
 
-	return len;
+	MP3Playing = FALSE;
+	return SilenceBuffer;
+}
+
+static __inline__ void ring_consume(struct _outring_s *ring,void *buffer)
+{
+	if(buffer!=SilenceBuffer) ring->get++;
+	LWP_ThreadSignal(thQueue);
 }
 
 static s32 _mp3ramcopy(void *usr_data,void *buffer,s32 len)
@@ -284,12 +274,10 @@ static void *StreamPlay(void *arg)
 
 	thr_running = TRUE;
 
-	CurrentBuffer = 0;
-	memset(OutputBuffer[0],0,ADMA_BUFFERSIZE);
-	memset(OutputBuffer[1],0,ADMA_BUFFERSIZE);
-	memset(OutputBuffer[2],0,ADMA_BUFFERSIZE);
+	memset(SilenceBuffer,0,ADMA_BUFFERSIZE);
+	DCFlushRange(SilenceBuffer,ADMA_BUFFERSIZE);
 
-	buf_init(&OutputRingBuffer);
+	ring_init(&OutputRing);
 	LWP_InitQueue(&thQueue);
 	Init3BandState(&eqs[0],880,5000,48000);
 	Init3BandState(&eqs[1],880,5000,48000);
@@ -357,7 +345,12 @@ static void *StreamPlay(void *arg)
 	mad_frame_finish(&Frame);
 	mad_stream_finish(&Stream);
 
-	while(MP3Playing==TRUE)
+	if(thr_running==TRUE) {
+		if(OutputRing.wptr) ring_publish(&OutputRing);
+		if(OutputRing.started==FALSE && OutputRing.put>0) ring_start(&OutputRing);
+	}
+
+	while(MP3Playing==TRUE || (thr_running==TRUE && OutputRing.get!=OutputRing.put))
 		LWP_ThreadSleep(thQueue);
 
 #ifndef __SNDLIB_H__
@@ -388,6 +381,11 @@ static void Resample(struct mad_pcm *Pcm,EQState eqs[2],u32 stereo,u32 src_sampl
 	u32 val32;
 	dword pos;
 	s32 incr;
+	u32 *dst,*end;
+
+	dst = ring_acquire(&OutputRing);
+	if(!dst) return;
+	end = OutputRing.wend;
 
 	pos.adword = 0;
 	incr = (u32)(((f32)src_samplerate/48000.0F)*65536.0F);
@@ -397,10 +395,20 @@ static void Resample(struct mad_pcm *Pcm,EQState eqs[2],u32 stereo,u32 src_sampl
 
 		if(stereo) val16 = Do3Band(&eqs[1],FixedToShort(Pcm->samples[1][pos.aword.hi]));
 		val32 |= val16;
-		
-		buf_put(&OutputRingBuffer,&val32,sizeof(u32));
+
+		// decode straight into the DMA slot, publishing it once full
+		*dst++ = val32;
+		if(dst==end) {
+			OutputRing.wptr = dst;
+			ring_publish(&OutputRing);
+
+			dst = ring_acquire(&OutputRing);
+			if(!dst) return;
+			end = OutputRing.wend;
+		}
 		pos.adword += incr;
 	}
+	OutputRing.wptr = dst;
 }
 
 static void Init3BandState(EQState *es,s32 lowfreq,s32 highfreq,s32 mixfreq)
@@ -447,26 +455,25 @@ static s16 Do3Band(EQState *es,s16 sample)
 static void DataTransferCallback(s32 voice)
 {
 #ifndef __SNDLIB_H__
-	AUDIO_InitDMA((u32)OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE);
+	void *buffer = ring_peek(&OutputRing);
 
-	CurrentBuffer = (CurrentBuffer+1)%3;
-	MP3Playing = (buf_get(&OutputRingBuffer,OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)>0);
+	AUDIO_InitDMA((u32)buffer,ADMA_BUFFERSIZE);
+	ring_consume(&OutputRing,buffer);
 #else
 	if(thr_running!=TRUE) {
-		MP3Playing = (buf_get(&OutputRingBuffer,OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)>0);
+		MP3Playing = FALSE;
+		LWP_ThreadSignal(thQueue);
 		return;
 	}
 	if(have_samples==1) {
-		if(SND_AddVoice(0,(void*)OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)==SND_OK) {
+		if(SND_AddVoice(0,PendingBuffer,ADMA_BUFFERSIZE)==SND_OK) {
 			have_samples = 0;
-			CurrentBuffer = (CurrentBuffer+1)%3;
+			ring_consume(&OutputRing,PendingBuffer);
 		}
 	}
-	if(!(SND_TestPointer(0,(void*)OutputBuffer[CurrentBuffer]) && SND_StatusVoice(0)!=SND_UNUSED)) {
-		if(have_samples==0) {
-			MP3Playing = (buf_get(&OutputRingBuffer,OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)>0);
-			have_samples = 1;
-		}
+	if(have_samples==0) {
+		PendingBuffer = ring_peek(&OutputRing);
+		have_samples = 1;
 	}
 #endif
 }
@@ -278,6 +278,7 @@ s32 gdbstub_idtoindex(s32 objid)
 	first_id = 1;
 	min_id = _lwp_thr_objects.min_id;
 	max_id = _lwp_thr_objects.max_id;
+	objid = LWP_OBJINDEX(objid);
 	if(objid>=min_id && objid<max_id) return first_id + (objid - min_id);
 
 	return 1;
@@ -0,0 +1,919 @@
+/****************************************************************************
+ * GameCube disc (GCM) FST devoptab
+ *
+ * Copyright (C) 2008-2025
+ * tipoloski, clava, shagkur, Tantric, joedj, Extrems
+ ****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <ogcsys.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <malloc.h>
+#include <sys/dir.h>
+#include <sys/iosupport.h>
+
+#include "gcm.h"
+
+#define OFFSET_GAMENAME		0x20
+#define OFFSET_MAGIC		0x1C
+#define OFFSET_FSTOFFSET	0x424
+#define OFFSET_FSTSIZE		0x428
+#define HEADER_SIZE			0x440
+
+#define GCM_MAGIC			0xC2339F3D
+#define GCM_NAMELEN			64
+
+#define FST_ENTRYSIZE		12
+#define FST_FLAG_DIR		1
+
+#define SECTOR_SIZE			0x800
+#define BUFFER_SIZE			0x8000
+#define BUFFER_SECTORS		(BUFFER_SIZE / SECTOR_SIZE)
+
+#define DIR_SEPARATOR		'/'
+#define NO_ENTRY			0xFFFFFFFF
+
+#define FNV_BASIS			0x811C9DC5
+#define FNV_PRIME			0x01000193
+
+typedef struct
+{
+	u32 hash;
+	u32 parent;
+	u32 chain;
+} INDEX_ENTRY;
+
+typedef struct gcmmount_s
+{
+	DISC_INTERFACE *disc_interface;
+	u8 cluster_buffer[BUFFER_SIZE] __attribute__((aligned(32)));
+	u32 buffer_sector;
+	u8 *fst;
+	const char *names;
+	u32 names_size;
+	u32 entry_count;
+	INDEX_ENTRY *index;
+	u32 *buckets;
+	u32 hash_mask;
+	u32 cwd;
+	char game_name[GCM_NAMELEN + 1];
+} MOUNT_DESCR;
+
+typedef struct filestruct_s
+{
+	u32 entry;
+	u64 disc_offset;
+	u32 size;
+	off_t offset;
+	bool inUse;
+	MOUNT_DESCR *mdescr;
+} FILE_STRUCT;
+
+typedef struct dstate_s
+{
+	u32 entry;
+	u32 next;
+	bool inUse;
+	MOUNT_DESCR *mdescr;
+} DIR_STATE_STRUCT;
+
+static MOUNT_DESCR* _GCM_getMountDescrFromPath(const char *path, devoptab_t **pdevops);
+
+// FST and disc header are big endian, read them bytewise so this also works on a host
+static __inline__ u32 read_be32(const u8 *p)
+{
+	return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+static __inline__ const u8* fst_entry(MOUNT_DESCR *mdescr, u32 entry)
+{
+	return mdescr->fst + entry * FST_ENTRYSIZE;
+}
+
+static __inline__ bool is_dir(MOUNT_DESCR *mdescr, u32 entry)
+{
+	return fst_entry(mdescr, entry)[0] & FST_FLAG_DIR;
+}
+
+static __inline__ const char* entry_name(MOUNT_DESCR *mdescr, u32 entry)
+{
+	return mdescr->names + (read_be32(fst_entry(mdescr, entry)) & 0x00FFFFFF);
+}
+
+// file: byte offset on disc, directory: index of the parent
+static __inline__ u32 entry_offset(MOUNT_DESCR *mdescr, u32 entry)
+{
+	return read_be32(fst_entry(mdescr, entry) + 4);
+}
+
+// file: length in bytes, directory: index of the first entry past its contents
+static __inline__ u32 entry_length(MOUNT_DESCR *mdescr, u32 entry)
+{
+	return read_be32(fst_entry(mdescr, entry) + 8);
+}
+
+static __inline__ u32 hash_char(u32 hash, char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		c += 'a' - 'A';
+	return (hash ^ (u8)c) * FNV_PRIME;
+}
+
+static u32 hash_path(const char *path, size_t len)
+{
+	u32 hash = FNV_BASIS;
+
+	while (len--)
+		hash = hash_char(hash, *path++);
+	return hash;
+}
+
+static bool read_bytes(MOUNT_DESCR *mdescr, void *ptr, u64 offset, size_t len)
+{
+	u32 sector, sector_offset, chunk, first;
+	u8 *cptr = ptr;
+	DISC_INTERFACE *disc = mdescr->disc_interface;
+
+	while (len > 0)
+	{
+		sector = offset / SECTOR_SIZE;
+		sector_offset = offset % SECTOR_SIZE;
+
+		// Whole sectors go straight into the caller's buffer
+		if (!sector_offset && len >= SECTOR_SIZE && SYS_IsDMAAddress(cptr, 32))
+		{
+			chunk = len / SECTOR_SIZE;
+			if (!disc->readSectors(disc, sector, chunk, cptr))
+				return false;
+			chunk *= SECTOR_SIZE;
+		}
+		else
+		{
+			if (mdescr->buffer_sector == NO_ENTRY || sector < mdescr->buffer_sector || sector >= mdescr->buffer_sector + BUFFER_SECTORS)
+			{
+				// Don't let the buffer reach past the end of the disc
+				first = sector;
+				if (disc->numberOfSectors >= BUFFER_SECTORS && first > disc->numberOfSectors - BUFFER_SECTORS)
+					first = disc->numberOfSectors - BUFFER_SECTORS;
+
+				mdescr->buffer_sector = NO_ENTRY;
+				if (!disc->readSectors(disc, first, BUFFER_SECTORS, mdescr->cluster_buffer))
+					return false;
+				mdescr->buffer_sector = first;
+			}
+			if (sector >= mdescr->buffer_sector + BUFFER_SECTORS)
+				return false;
+
+			sector_offset += (sector - mdescr->buffer_sector) * SECTOR_SIZE;
+			chunk = MIN(BUFFER_SIZE - sector_offset, len);
+			memcpy(cptr, mdescr->cluster_buffer + sector_offset, chunk);
+		}
+
+		cptr += chunk;
+		offset += chunk;
+		len -= chunk;
+	}
+	return true;
+}
+
+// Checks the candidate's name and those of its parents against path, last component first
+static bool entry_matches(MOUNT_DESCR *mdescr, u32 entry, const char *path, size_t len)
+{
+	size_t start;
+	const char *name;
+
+	while (entry != 0)
+	{
+		start = len;
+		while (start > 0 && path[start - 1] != DIR_SEPARATOR)
+			start--;
+
+		name = entry_name(mdescr, entry);
+		if (strlen(name) != len - start || strncasecmp(name, path + start, len - start))
+			return false;
+
+		len = start ? start - 1 : 0;
+		if (!start && mdescr->index[entry].parent != 0)
+			return false;
+		entry = mdescr->index[entry].parent;
+	}
+	return len == 0;
+}
+
+// Writes the path of entry relative to the root, without leading separator
+static size_t build_path(MOUNT_DESCR *mdescr, u32 entry, char *path)
+{
+	u32 stack[GCM_MAXPATHLEN / 2];
+	u32 depth = 0;
+	size_t len = 0, namelen;
+	const char *name;
+
+	for (; entry != 0 && depth < GCM_MAXPATHLEN / 2; entry = mdescr->index[entry].parent)
+		stack[depth++] = entry;
+
+	while (depth--)
+	{
+		name = entry_name(mdescr, stack[depth]);
+		namelen = strlen(name);
+		if (len + namelen + 2 > GCM_MAXPATHLEN)
+			break;
+		if (len)
+			path[len++] = DIR_SEPARATOR;
+		memcpy(path + len, name, namelen);
+		len += namelen;
+	}
+	path[len] = '\0';
+	return len;
+}
+
+static bool entry_from_path(MOUNT_DESCR *mdescr, u32 *pentry, const char *path)
+{
+	char npath[GCM_MAXPATHLEN];
+	const char *comp;
+	size_t len, complen;
+	u32 entry, hash;
+
+	if (strchr(path, ':'))
+		path = strchr(path, ':') + 1;
+
+	len = 0;
+	if (*path != DIR_SEPARATOR)
+		len = build_path(mdescr, mdescr->cwd, npath);
+
+	// Normalize to "a/b/c", resolving "." and ".."
+	while (*path)
+	{
+		while (*path == DIR_SEPARATOR)
+			path++;
+		comp = path;
+		while (*path && *path != DIR_SEPARATOR)
+			path++;
+		complen = path - comp;
+
+		if (complen == 0 || (complen == 1 && comp[0] == '.'))
+			continue;
+		if (complen == 2 && comp[0] == '.' && comp[1] == '.')
+		{
+			while (len > 0 && npath[len - 1] != DIR_SEPARATOR)
+				len--;
+			if (len > 0)
+				len--;
+			continue;
+		}
+
+		if (len + complen + 2 > GCM_MAXPATHLEN)
+			return false;
+		if (len)
+			npath[len++] = DIR_SEPARATOR;
+		memcpy(npath + len, comp, complen);
+		len += complen;
+	}
+
+	if (len == 0)
+	{
+		*pentry = 0;
+		return true;
+	}
+
+	hash = hash_path(npath, len);
+	for (entry = mdescr->buckets[hash & mdescr->hash_mask]; entry != NO_ENTRY; entry = mdescr->index[entry].chain)
+	{
+		if (mdescr->index[entry].hash == hash && entry_matches(mdescr, entry, npath, len))
+		{
+			*pentry = entry;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void stat_entry(MOUNT_DESCR *mdescr, u32 entry, struct stat *st)
+{
+	st->st_dev = mdescr->disc_interface->ioType;
+	st->st_ino = entry;
+	st->st_mode = (is_dir(mdescr, entry) ? S_IFDIR : S_IFREG) | (S_IRUSR | S_IRGRP | S_IROTH);
+	st->st_nlink = 1;
+	st->st_uid = 1;
+	st->st_gid = 2;
+	st->st_rdev = st->st_dev;
+	st->st_size = is_dir(mdescr, entry) ? 0 : entry_length(mdescr, entry);
+	st->st_atime = 0;
+	st->st_mtime = 0;
+	st->st_ctime = 0;
+	st->st_blksize = SECTOR_SIZE;
+	st->st_blocks = ((st->st_size + st->st_blksize - 1) & ~(st->st_blksize - 1)) / S_BLKSIZE;
+}
+
+static bool check_dev_name(const char* name, char *devname, size_t devname_size)
+{
+	size_t len;
+
+	if (!name)
+		return false;
+
+	len = strlen(name);
+	if (len == 0 || len > devname_size-2)
+		return false;
+
+	// append ':' if missing
+	strcpy(devname, name);
+	if (devname[len-1] != ':')
+		strcat(devname, ":");
+
+	return true;
+}
+
+static int _GCM_open_r(struct _reent *r, void *fileStruct, const char *path, int flags, int mode)
+{
+	u32 entry;
+	FILE_STRUCT *file = (FILE_STRUCT *) fileStruct;
+	MOUNT_DESCR *mdescr;
+
+	mdescr = _GCM_getMountDescrFromPath(path, NULL);
+	if (mdescr == NULL)
+	{
+		r->_errno = ENODEV;
+		return -1;
+	}
+
+	if ((flags & O_ACCMODE) != O_RDONLY)
+	{
+		r->_errno = EROFS;
+		return -1;
+	}
+
+	if (!entry_from_path(mdescr, &entry, path))
+	{
+		r->_errno = ENOENT;
+		return -1;
+	}
+	else if (is_dir(mdescr, entry))
+	{
+		r->_errno = EISDIR;
+		return -1;
+	}
+
+	file->entry = entry;
+	file->disc_offset = entry_offset(mdescr, entry);
+	file->size = entry_length(mdescr, entry);
+	file->offset = 0;
+	file->inUse = true;
+	file->mdescr = mdescr;
+
+	return (int) file;
+}
+
+static int _GCM_close_r(struct _reent *r, void *fd)
+{
+	FILE_STRUCT *file = (FILE_STRUCT*) fd;
+
+	if (!file->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	file->inUse = false;
+	return 0;
+}
+
+static ssize_t _GCM_read_r(struct _reent *r, void *fd, char *ptr, size_t len)
+{
+	FILE_STRUCT *file = (FILE_STRUCT*) fd;
+
+	if (!file->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	if (file->offset >= file->size)
+	{
+		r->_errno = EOVERFLOW;
+		return 0;
+	}
+
+	if (len + file->offset > file->size)
+	{
+		r->_errno = EOVERFLOW;
+		len = file->size - file->offset;
+	}
+
+	if (len == 0)
+		return 0;
+
+	if (!read_bytes(file->mdescr, ptr, file->disc_offset + file->offset, len))
+	{
+		r->_errno = EIO;
+		return -1;
+	}
+
+	file->offset += len;
+	return len;
+}
+
+static off_t _GCM_seek_r(struct _reent *r, void *fd, off_t pos, int dir)
+{
+	off_t position;
+	FILE_STRUCT *file = (FILE_STRUCT*) fd;
+
+	if (!file->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	switch (dir)
+	{
+		case SEEK_SET:
+			position = pos;
+			break;
+		case SEEK_CUR:
+			position = file->offset + pos;
+			break;
+		case SEEK_END:
+			position = file->size + pos;
+			break;
+		default:
+			r->_errno = EINVAL;
+			return -1;
+	}
+
+	if (pos > 0 && position < 0)
+	{
+		r->_errno = EOVERFLOW;
+		return -1;
+	}
+
+	if (position < 0 || position > file->size)
+	{
+		r->_errno = EINVAL;
+		return -1;
+	}
+
+	file->offset = position;
+	return position;
+}
+
+static int _GCM_fstat_r(struct _reent *r, void *fd, struct stat *st)
+{
+	FILE_STRUCT *file = (FILE_STRUCT*) fd;
+
+	if (!file->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	stat_entry(file->mdescr, file->entry, st);
+	return 0;
+}
+
+static int _GCM_stat_r(struct _reent *r, const char *path, struct stat *st)
+{
+	u32 entry;
+	MOUNT_DESCR *mdescr;
+
+	mdescr = _GCM_getMountDescrFromPath(path, NULL);
+	if (mdescr == NULL)
+	{
+		r->_errno = ENODEV;
+		return -1;
+	}
+
+	if (!entry_from_path(mdescr, &entry, path))
+	{
+		r->_errno = ENOENT;
+		return -1;
+	}
+
+	stat_entry(mdescr, entry, st);
+	return 0;
+}
+
+static int _GCM_chdir_r(struct _reent *r, const char *path)
+{
+	u32 entry;
+	MOUNT_DESCR *mdescr;
+
+	mdescr = _GCM_getMountDescrFromPath(path, NULL);
+	if (mdescr == NULL)
+	{
+		r->_errno = ENODEV;
+		return -1;
+	}
+
+	if (!entry_from_path(mdescr, &entry, path))
+	{
+		r->_errno = ENOENT;
+		return -1;
+	}
+	else if (!is_dir(mdescr, entry))
+	{
+		r->_errno = ENOTDIR;
+		return -1;
+	}
+
+	mdescr->cwd = entry;
+	return 0;
+}
+
+static DIR_ITER* _GCM_diropen_r(struct _reent *r, DIR_ITER *dirState, const char *path)
+{
+	DIR_STATE_STRUCT *state = (DIR_STATE_STRUCT*) (dirState->dirStruct);
+	MOUNT_DESCR *mdescr;
+
+	mdescr = _GCM_getMountDescrFromPath(path, NULL);
+	if (mdescr == NULL)
+	{
+		r->_errno = ENODEV;
+		return NULL;
+	}
+
+	if (!entry_from_path(mdescr, &state->entry, path))
+	{
+		r->_errno = ENOENT;
+		return NULL;
+	}
+	else if (!is_dir(mdescr, state->entry))
+	{
+		r->_errno = ENOTDIR;
+		return NULL;
+	}
+
+	state->next = state->entry + 1;
+	state->inUse = true;
+	state->mdescr = mdescr;
+	return dirState;
+}
+
+static int _GCM_dirreset_r(struct _reent *r, DIR_ITER *dirState)
+{
+	DIR_STATE_STRUCT *state = (DIR_STATE_STRUCT*) (dirState->dirStruct);
+
+	if (!state->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	state->next = state->entry + 1;
+	return 0;
+}
+
+static int _GCM_dirnext_r(struct _reent *r, DIR_ITER *dirState, char *filename, struct stat *st)
+{
+	u32 entry;
+	DIR_STATE_STRUCT *state = (DIR_STATE_STRUCT*) (dirState->dirStruct);
+	MOUNT_DESCR *mdescr = state->mdescr;
+
+	if (!state->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	if (state->next >= entry_length(mdescr, state->entry))
+	{
+		r->_errno = ENOENT;
+		return -1;
+	}
+
+	// Subdirectories are skipped as a whole to reach the next sibling
+	entry = state->next;
+	state->next = is_dir(mdescr, entry) ? entry_length(mdescr, entry) : entry + 1;
+
+	strncpy(filename, entry_name(mdescr, entry), NAME_MAX);
+	filename[NAME_MAX] = '\0';
+	stat_entry(mdescr, entry, st);
+	return 0;
+}
+
+static int _GCM_dirclose_r(struct _reent *r, DIR_ITER *dirState)
+{
+	DIR_STATE_STRUCT *state = (DIR_STATE_STRUCT*) (dirState->dirStruct);
+
+	if (!state->inUse)
+	{
+		r->_errno = EBADF;
+		return -1;
+	}
+
+	state->inUse = false;
+	return 0;
+}
+
+static int _GCM_statvfs_r(struct _reent *r, const char *path, struct statvfs *buf)
+{
+	MOUNT_DESCR *mdescr;
+
+	mdescr = _GCM_getMountDescrFromPath(path, NULL);
+	if (mdescr == NULL)
+	{
+		r->_errno = ENODEV;
+		return -1;
+	}
+
+	buf->f_bsize = SECTOR_SIZE;
+	buf->f_frsize = SECTOR_SIZE;
+
+	buf->f_blocks = mdescr->disc_interface->numberOfSectors;
+	buf->f_bfree = 0;
+	buf->f_bavail = 0;
+
+	buf->f_files = mdescr->entry_count;
+	buf->f_ffree = 0;
+	buf->f_favail = 0;
+
+	buf->f_fsid = mdescr->disc_interface->ioType;
+
+	buf->f_flag = ST_NOSUID | ST_RDONLY;
+	buf->f_namemax = NAME_MAX;
+	return 0;
+}
+
+static const devoptab_t dotab_gcm =
+{
+	NULL,
+	sizeof(FILE_STRUCT),
+	_GCM_open_r,
+	_GCM_close_r,
+	NULL,
+	_GCM_read_r,
+	_GCM_seek_r,
+	_GCM_fstat_r,
+	_GCM_stat_r,
+	NULL,
+	NULL,
+	_GCM_chdir_r,
+	NULL,
+	NULL,
+	sizeof(DIR_STATE_STRUCT),
+	_GCM_diropen_r,
+	_GCM_dirreset_r,
+	_GCM_dirnext_r,
+	_GCM_dirclose_r,
+	_GCM_statvfs_r,
+	NULL, // device ftruncate_r
+	NULL, // device fsync_r
+	NULL, // device data
+	NULL, // device chmod_r
+	NULL, // device fchmod_r
+	NULL, // device rmdir_r
+	_GCM_stat_r,
+	NULL, // device utimes_r
+	NULL, // device fpathconf_r
+	NULL, // device pathconf_r
+	NULL, // device symlink_r
+	NULL, // device readlink_r
+};
+
+static MOUNT_DESCR* _GCM_getMountDescrFromPath(const char *path, devoptab_t **pdevops)
+{
+	devoptab_t *devops;
+
+	if (!path)
+		return NULL;
+
+	devops = (devoptab_t *) GetDeviceOpTab(path);
+	if (!devops)
+		return NULL;
+
+	// Perform a quick check to make sure we're dealing with a GCM controlled device
+	if (devops->open_r != dotab_gcm.open_r)
+		return NULL;
+
+	if (pdevops)
+		*pdevops = devops;
+
+	return (MOUNT_DESCR*) devops->deviceData;
+}
+
+// Assigns parents and path hashes in one pass. Parents always precede their children in the FST.
+static bool build_index(MOUNT_DESCR *mdescr)
+{
+	u32 dir, entry, end, hash, bucket;
+	const char *name;
+
+	while (mdescr->hash_mask + 1 < mdescr->entry_count)
+		mdescr->hash_mask = (mdescr->hash_mask << 1) | 1;
+
+	mdescr->index = malloc(mdescr->entry_count * sizeof(INDEX_ENTRY));
+	mdescr->buckets = malloc((mdescr->hash_mask + 1) * sizeof(u32));
+	if (!mdescr->index || !mdescr->buckets)
+		return false;
+
+	memset(mdescr->buckets, 0xFF, (mdescr->hash_mask + 1) * sizeof(u32));
+	mdescr->index[0].hash = FNV_BASIS;
+	mdescr->index[0].parent = 0;
+	mdescr->index[0].chain = NO_ENTRY;
+
+	for (dir = 0; dir < mdescr->entry_count; dir++)
+	{
+		if (!is_dir(mdescr, dir))
+			continue;
+
+		end = entry_length(mdescr, dir);
+		if (end <= dir || end > mdescr->entry_count)
+			return false;
+
+		for (entry = dir + 1; entry < end; )
+		{
+			if ((read_be32(fst_entry(mdescr, entry)) & 0x00FFFFFF) >= mdescr->names_size)
+				return false;
+
+			hash = mdescr->index[dir].hash;
+			if (dir != 0)
+				hash = hash_char(hash, DIR_SEPARATOR);
+			for (name = entry_name(mdescr, entry); *name; name++)
+				hash = hash_char(hash, *name);
+
+			bucket = hash & mdescr->hash_mask;
+			mdescr->index[entry].hash = hash;
+			mdescr->index[entry].parent = dir;
+			mdescr->index[entry].chain = mdescr->buckets[bucket];
+			mdescr->buckets[bucket] = entry;
+
+			if (is_dir(mdescr, entry))
+			{
+				if (entry_length(mdescr, entry) <= entry || entry_length(mdescr, entry) > end)
+					return false;
+				entry = entry_length(mdescr, entry);
+			}
+			else
+				entry++;
+		}
+	}
+	return true;
+}
+
+static bool read_fst(MOUNT_DESCR *mdescr)
+{
+	u8 *header = mdescr->cluster_buffer;
+	u32 fst_offset, fst_size, first_sector, sectors;
+
+	if (!mdescr->disc_interface->readSectors(mdescr->disc_interface, 0, HEADER_SIZE / SECTOR_SIZE + 1, header))
+		return false;
+
+	if (read_be32(header + OFFSET_MAGIC) != GCM_MAGIC)
+		return false;
+
+	memcpy(mdescr->game_name, header + OFFSET_GAMENAME, GCM_NAMELEN);
+	mdescr->game_name[GCM_NAMELEN] = '\0';
+
+	fst_offset = read_be32(header + OFFSET_FSTOFFSET);
+	fst_size = read_be32(header + OFFSET_FSTSIZE);
+	if (fst_size < FST_ENTRYSIZE)
+		return false;
+
+	first_sector = fst_offset / SECTOR_SIZE;
+	sectors = (fst_offset % SECTOR_SIZE + fst_size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	mdescr->fst = memalign(32, sectors * SECTOR_SIZE);
+	if (!mdescr->fst)
+		return false;
+
+	if (!mdescr->disc_interface->readSectors(mdescr->disc_interface, first_sector, sectors, mdescr->fst))
+		return false;
+	memmove(mdescr->fst, mdescr->fst + fst_offset % SECTOR_SIZE, fst_size);
+
+	// The root entry's length is the total number of entries, the name table follows them
+	mdescr->entry_count = entry_length(mdescr, 0);
+	if (!is_dir(mdescr, 0) || !mdescr->entry_count || mdescr->entry_count > fst_size / FST_ENTRYSIZE)
+		return false;
+
+	mdescr->names = (const char*) (mdescr->fst + mdescr->entry_count * FST_ENTRYSIZE);
+	mdescr->names_size = fst_size - mdescr->entry_count * FST_ENTRYSIZE;
+	if (!mdescr->names_size || mdescr->names[mdescr->names_size - 1] != '\0')
+		return false;
+
+	return build_index(mdescr);
+}
+
+static void _GCM_mdescr_destructor(MOUNT_DESCR *mdescr)
+{
+	free(mdescr->fst);
+	free(mdescr->index);
+	free(mdescr->buckets);
+	free(mdescr);
+}
+
+static MOUNT_DESCR *_GCM_mdescr_constructor(DISC_INTERFACE *disc_interface)
+{
+	MOUNT_DESCR *mdescr = NULL;
+
+	mdescr = memalign(32, sizeof(MOUNT_DESCR));
+	if (!mdescr)
+		return NULL;
+
+	mdescr->disc_interface = disc_interface;
+	mdescr->buffer_sector = NO_ENTRY;
+	mdescr->fst = NULL;
+	mdescr->names = NULL;
+	mdescr->names_size = 0;
+	mdescr->entry_count = 0;
+	mdescr->index = NULL;
+	mdescr->buckets = NULL;
+	mdescr->hash_mask = 0;
+	mdescr->cwd = 0;
+
+	if (!read_fst(mdescr))
+	{
+		_GCM_mdescr_destructor(mdescr);
+		return NULL;
+	}
+	return mdescr;
+}
+
+bool GCM_Mount(const char *name, DISC_INTERFACE *disc_interface)
+{
+	char *nameCopy;
+	devoptab_t *devops = NULL;
+	MOUNT_DESCR *mdescr = NULL;
+	char devname[10];
+
+	if (!name || strlen(name) > 8 || !disc_interface)
+		return false;
+
+	if (!disc_interface->startup(disc_interface))
+		return false;
+
+	if (!disc_interface->isInserted(disc_interface))
+		return false;
+
+	if (disc_interface->bytesPerSector != SECTOR_SIZE)
+		return false;
+
+	sprintf(devname, "%s:", name);
+	if (FindDevice(devname) >= 0)
+		return false;
+
+	devops = malloc(sizeof(dotab_gcm) + strlen(name) + 1);
+	if (!devops)
+		return false;
+
+	// Use the space allocated at the end of the devoptab struct for storing the name
+	nameCopy = (char*) (devops + 1);
+
+	// Load the FST and index it
+	mdescr = _GCM_mdescr_constructor(disc_interface);
+	if (!mdescr)
+	{
+		free(devops);
+		return false;
+	}
+
+	// Add an entry for this device to the devoptab table
+	memcpy(devops, &dotab_gcm, sizeof(dotab_gcm));
+	strcpy(nameCopy, name);
+	devops->name = nameCopy;
+	devops->deviceData = mdescr;
+
+	if (AddDevice(devops) < 0)
+	{
+		_GCM_mdescr_destructor(mdescr);
+		free(devops);
+		return false;
+	}
+	return true;
+}
+
+bool GCM_Unmount(const char *name)
+{
+	devoptab_t *devops;
+	MOUNT_DESCR *mdescr;
+	char devname[11];
+
+	if (!check_dev_name(name, devname, sizeof(devname)))
+		return false;
+
+	mdescr = _GCM_getMountDescrFromPath(devname, &devops);
+	if (!mdescr)
+		return false;
+
+	if (RemoveDevice(devname) == -1)
+		return false;
+
+	_GCM_mdescr_destructor(mdescr);
+	free(devops);
+	return true;
+}
+
+const char *GCM_GetGameName(const char *name)
+{
+	MOUNT_DESCR *mdescr;
+	char devname[11];
+
+	if (!check_dev_name(name, devname, sizeof(devname)))
+		return NULL;
+
+	mdescr = _GCM_getMountDescrFromPath(devname, NULL);
+	if (!mdescr)
+		return NULL;
+
+	return mdescr->game_name;
+}
@@ -27,6 +27,9 @@
 #define SECTOR_SIZE			0x800
 #define BUFFER_SIZE			0x8000
 
+#define DEFAULT_CACHE_PAGES		4
+#define DEFAULT_SECTORS_PAGE	(BUFFER_SIZE / SECTOR_SIZE)
+
 #define DIR_SEPARATOR		'/'
 
 #define FLAG_DIR 2
@@ -77,13 +80,25 @@ typedef struct dentry_s
 	struct dentry_s *children;
 } DIR_ENTRY;
 
+typedef struct
+{
+	u32 sector;
+	u32 count;
+	u32 last_access;
+	u8 *buffer;
+} CACHE_ENTRY;
+
 typedef struct iso9660mount_s
 {
 	DISC_INTERFACE *disc_interface;
-	u8 read_buffer[BUFFER_SIZE] __attribute__((aligned(32)));
 	u8 cluster_buffer[BUFFER_SIZE] __attribute__((aligned(32)));
-	u32 cache_start;
-	u32 cache_sectors;
+	CACHE_ENTRY *cache_entries;
+	u8 *cache_buffer;
+	u32 cache_pages;
+	u32 sectors_per_page;
+	u32 cache_access;
+	u32 cache_next;
+	u32 readahead_pages;
 	bool iso_unicode;
 	PATH_ENTRY *iso_rootentry;
 	PATH_ENTRY *iso_currententry;
@@ -113,30 +128,86 @@ static __inline__ bool is_dir(DIR_ENTRY *entry)
 	return entry->flags & FLAG_DIR;
 }
 
-static int __read(MOUNT_DESCR *mdescr, void *ptr, u64 offset, size_t len)
+static CACHE_ENTRY* cache_load(MOUNT_DESCR *mdescr, u32 sector)
 {
-	u32 sector = offset / SECTOR_SIZE;
-	u32 end_sector = (offset + len - 1) / SECTOR_SIZE;
-	u32 sectors = MIN(BUFFER_SIZE / SECTOR_SIZE, end_sector - sector + 1);
-	u32 sector_offset = offset % SECTOR_SIZE;
+	u32 i;
+	CACHE_ENTRY *entry = &mdescr->cache_entries[0];
 	DISC_INTERFACE *disc = mdescr->disc_interface;
 
-	len = MIN(BUFFER_SIZE - sector_offset, len);
-	if (mdescr->cache_sectors && sector >= mdescr->cache_start && (sector + sectors) <= (mdescr->cache_start + mdescr->cache_sectors))
+	for (i = 1; i < mdescr->cache_pages; i++)
+	{
+		if (!entry->count)
+			break;
+		if (!mdescr->cache_entries[i].count || mdescr->cache_entries[i].last_access < entry->last_access)
+			entry = &mdescr->cache_entries[i];
+	}
+
+	if (!disc->readSectors(disc, sector, mdescr->sectors_per_page, entry->buffer))
 	{
-		memcpy(ptr, mdescr->read_buffer + (sector - mdescr->cache_start) * SECTOR_SIZE + sector_offset, len);
-		return len;
+		entry->count = 0;
+		return NULL;
 	}
 
-	if (!disc->readSectors(disc, sector, BUFFER_SIZE / SECTOR_SIZE, mdescr->read_buffer))
+	entry->sector = sector;
+	entry->count = mdescr->sectors_per_page;
+	entry->last_access = ++mdescr->cache_access;
+	return entry;
+}
+
+static CACHE_ENTRY* cache_find(MOUNT_DESCR *mdescr, u32 sector)
+{
+	u32 i;
+
+	for (i = 0; i < mdescr->cache_pages; i++)
 	{
-		mdescr->cache_sectors = 0;
-		return -1;
+		if (mdescr->cache_entries[i].count && mdescr->cache_entries[i].sector == sector)
+			return &mdescr->cache_entries[i];
 	}
+	return NULL;
+}
+
+static CACHE_ENTRY* cache_lookup(MOUNT_DESCR *mdescr, u32 sector)
+{
+	u32 i, page_sector, readahead;
+	CACHE_ENTRY *entry;
+
+	page_sector = sector - (sector % mdescr->sectors_per_page);
+	if ((entry = cache_find(mdescr, page_sector)))
+	{
+		entry->last_access = ++mdescr->cache_access;
+		return entry;
+	}
+
+	readahead = (page_sector == mdescr->cache_next) ? mdescr->readahead_pages : 0;
+	if (!(entry = cache_load(mdescr, page_sector)))
+		return NULL;
+
+	// Sequential miss - pull in the pages that follow so the stream keeps hitting
+	for (i = 1; i <= readahead; i++)
+	{
+		if (!cache_find(mdescr, page_sector + i * mdescr->sectors_per_page) && !cache_load(mdescr, page_sector + i * mdescr->sectors_per_page))
+			break;
+	}
+	mdescr->cache_next = page_sector + i * mdescr->sectors_per_page;
+
+	// Keep the requested page the most recently used one
+	entry->last_access = ++mdescr->cache_access;
+	return entry;
+}
+
+// Copies from one cache page only, so it may return less than len - use _read for a range that can cross pages
+static int __read(MOUNT_DESCR *mdescr, void *ptr, u64 offset, size_t len)
+{
+	u32 sector = offset / SECTOR_SIZE;
+	u32 sector_offset = offset % SECTOR_SIZE;
+	CACHE_ENTRY *entry;
 
-	mdescr->cache_start = sector;
-	mdescr->cache_sectors = BUFFER_SIZE / SECTOR_SIZE;
-	memcpy(ptr, mdescr->read_buffer + sector_offset, len);
+	if (!(entry = cache_lookup(mdescr, sector)))
+		return -1;
+
+	sector_offset += (sector - entry->sector) * SECTOR_SIZE;
+	len = MIN(entry->count * SECTOR_SIZE - sector_offset, len);
+	memcpy(ptr, entry->buffer + sector_offset, len);
 
 	return len;
 }
@@ -145,8 +216,21 @@ static int _read(MOUNT_DESCR *mdescr, void *ptr, u64 offset, size_t len)
 {
 	int ret, read = 0;
 	char *cptr = ptr;
+	u32 sectors;
+	DISC_INTERFACE *disc = mdescr->disc_interface;
+
 	while (read < len)
 	{
+		// Large aligned reads go straight into the caller's buffer
+		sectors = (len - read) / SECTOR_SIZE;
+		if (sectors >= mdescr->sectors_per_page && !((offset + read) % SECTOR_SIZE) && SYS_IsDMAAddress(cptr + read, 32))
+		{
+			if (!disc->readSectors(disc, (offset + read) / SECTOR_SIZE, sectors, cptr + read))
+				return -1;
+			read += sectors * SECTOR_SIZE;
+			continue;
+		}
+
 		ret = __read(mdescr, cptr + read, offset + read, len - read);
 		if (ret > 0)
 			read += ret;
@@ -273,7 +357,7 @@ static bool read_directory(MOUNT_DESCR *mdescr, DIR_ENTRY *dir_entry, PATH_ENTRY
 
 	do
 	{
-		if (__read(mdescr, mdescr->cluster_buffer, (u64) sector * SECTOR_SIZE + sector_offset, (SECTOR_SIZE - sector_offset)) != (SECTOR_SIZE - sector_offset))
+		if (_read(mdescr, mdescr->cluster_buffer, (u64) sector * SECTOR_SIZE + sector_offset, (SECTOR_SIZE - sector_offset)) != (SECTOR_SIZE - sector_offset))
 			return false;
 		int offset = read_direntry(mdescr, dir_entry, mdescr->cluster_buffer);
 		if (offset == -1)
@@ -862,13 +946,13 @@ static struct pvd_s* read_volume_descriptor(MOUNT_DESCR *mdescr, u8 descriptor)
 
 	for (sector = 16; sector < 32; sector++)
 	{
-		if (!disc->readSectors(disc, sector, 1, mdescr->read_buffer))
+		if (!disc->readSectors(disc, sector, 1, mdescr->cluster_buffer))
 			return NULL;
-		if (!memcmp(mdescr->read_buffer + 1, "CD001\1", 6))
+		if (!memcmp(mdescr->cluster_buffer + 1, "CD001\1", 6))
 		{
-			if (*mdescr->read_buffer == descriptor)
-				return (struct pvd_s*) mdescr->read_buffer;
-			else if (*mdescr->read_buffer == 0xff)
+			if (*mdescr->cluster_buffer == descriptor)
+				return (struct pvd_s*) mdescr->cluster_buffer;
+			else if (*mdescr->cluster_buffer == 0xff)
 				return NULL;
 		}
 	}
@@ -906,7 +990,7 @@ static bool read_directories(MOUNT_DESCR *mdescr)
 	while (i < 0xffff && offset < path_table_len)
 	{
 		PATHTABLE_ENTRY entry;
-		if (__read(mdescr, &entry, (u64) path_table * SECTOR_SIZE + offset, sizeof(PATHTABLE_ENTRY)) != sizeof(PATHTABLE_ENTRY))
+		if (_read(mdescr, &entry, (u64) path_table * SECTOR_SIZE + offset, sizeof(PATHTABLE_ENTRY)) != sizeof(PATHTABLE_ENTRY))
 			return false; // kinda dodgy - could be reading too far
 		if (parent->index != entry.parent)
 			parent = entry_from_index(mdescr->iso_rootentry, entry.parent);
@@ -939,8 +1023,22 @@ static bool read_directories(MOUNT_DESCR *mdescr)
 	return true;
 }
 
-static MOUNT_DESCR *_ISO9660_mdescr_constructor(DISC_INTERFACE *disc_interface)
+static void _ISO9660_mdescr_destructor(MOUNT_DESCR *mdescr)
+{
+	if (mdescr->iso_rootentry)
+	{
+		cleanup_recursive(mdescr->iso_rootentry);
+		free(mdescr->iso_rootentry);
+	}
+
+	free(mdescr->cache_entries);
+	free(mdescr->cache_buffer);
+	free(mdescr);
+}
+
+static MOUNT_DESCR *_ISO9660_mdescr_constructor(DISC_INTERFACE *disc_interface, u32 cachePages, u32 sectorsPerPage)
 {
+	u32 i;
 	MOUNT_DESCR *mdescr = NULL;
 
 	mdescr = memalign(32, sizeof(MOUNT_DESCR));
@@ -948,21 +1046,35 @@ static MOUNT_DESCR *_ISO9660_mdescr_constructor(DISC_INTERFACE *disc_interface)
 		return NULL;
 
 	mdescr->disc_interface = disc_interface;
-	mdescr->cache_start = 0;
-	mdescr->cache_sectors = 0;
+	mdescr->cache_pages = cachePages;
+	mdescr->sectors_per_page = sectorsPerPage;
+	mdescr->cache_access = 0;
+	mdescr->cache_next = ~0;
+	mdescr->readahead_pages = cachePages / 2;
 	mdescr->iso_unicode = false;
 	mdescr->iso_rootentry = NULL;
 	mdescr->iso_currententry = NULL;
 
+	mdescr->cache_entries = calloc(cachePages, sizeof(CACHE_ENTRY));
+	mdescr->cache_buffer = memalign(32, cachePages * sectorsPerPage * SECTOR_SIZE);
+	if (!mdescr->cache_entries || !mdescr->cache_buffer)
+	{
+		_ISO9660_mdescr_destructor(mdescr);
+		return NULL;
+	}
+
+	for (i = 0; i < cachePages; i++)
+		mdescr->cache_entries[i].buffer = mdescr->cache_buffer + i * sectorsPerPage * SECTOR_SIZE;
+
 	if (!read_directories(mdescr))
 	{
-		free(mdescr);
+		_ISO9660_mdescr_destructor(mdescr);
 		return NULL;
 	}
 	return mdescr;
 }
 
-bool ISO9660_Mount(const char *name, DISC_INTERFACE *disc_interface)
+bool ISO9660_MountEx(const char *name, DISC_INTERFACE *disc_interface, u32 cachePages, u32 sectorsPerPage)
 {
 	char *nameCopy;
 	devoptab_t *devops = NULL;
@@ -972,6 +1084,9 @@ bool ISO9660_Mount(const char *name, DISC_INTERFACE *disc_interface)
 	if (!name || strlen(name) > 8 || !disc_interface)
 		return false;
 
+	if (!cachePages || !sectorsPerPage)
+		return false;
+
 	if (!disc_interface->startup(disc_interface))
 		return false;
 
@@ -993,7 +1108,7 @@ bool ISO9660_Mount(const char *name, DISC_INTERFACE *disc_interface)
 	nameCopy = (char*) (devops + 1);
 
 	// Initialize the file system
-	mdescr = _ISO9660_mdescr_constructor(disc_interface);
+	mdescr = _ISO9660_mdescr_constructor(disc_interface, cachePages, sectorsPerPage);
 	if (!mdescr)
 	{
 		free(devops);
@@ -1008,13 +1123,18 @@ bool ISO9660_Mount(const char *name, DISC_INTERFACE *disc_interface)
 
 	if (AddDevice(devops) < 0)
 	{
-		free(mdescr);
+		_ISO9660_mdescr_destructor(mdescr);
 		free(devops);
 		return false;
 	}
 	return true;
 }
 
+bool ISO9660_Mount(const char *name, DISC_INTERFACE *disc_interface)
+{
+	return ISO9660_MountEx(name, disc_interface, DEFAULT_CACHE_PAGES, DEFAULT_SECTORS_PAGE);
+}
+
 
 bool ISO9660_Unmount(const char *name)
 {
@@ -1032,13 +1152,7 @@ bool ISO9660_Unmount(const char *name)
 	if (RemoveDevice(devname) == -1)
 		return false;
 
-	if (mdescr->iso_rootentry)
-	{
-		cleanup_recursive(mdescr->iso_rootentry);
-		free(mdescr->iso_rootentry);
-	}
-
-	free(mdescr);
+	_ISO9660_mdescr_destructor(mdescr);
 	free(devops);
 	return true;
 }
@@ -286,6 +286,7 @@ s32 MODPlay_SetMOD(MODPlay *mod,const void *mem)
 
 	if(MOD_SetMOD(&mod->mod,(u8*)mem)==0) {
 		MODPlay_AllocSFXChannels(mod,mod->numSFXChans);
+		MOD_SetInterpolation(&mod->mod,mod->interpolation);
 		return 0;
 	}
 	return -1;
@@ -361,6 +362,14 @@ void MODPlay_SetVolume(MODPlay *mod, s32 musicvolume, s32 sfxvolume)
 	mod->mod.sfxvolume = sfxvolume;
 }
 
+s32 MODPlay_SetInterpolation(MODPlay *mod,u32 mode)
+{
+	if(MOD_SetInterpolation(&mod->mod,mode)<0) return -1;
+
+	mod->interpolation = mode;
+	return 0;
+}
+
 #ifdef _GCMOD_DEBUG
 u32 MODPlay_MixingTime()
 {
@@ -28,6 +28,7 @@ THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 /* mixer.c */
 
+#include <string.h>
 #include "defines.h"
 #include "modplay.h"
 
@@ -46,178 +47,254 @@ THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 
-#define MIX_SAMPLES \
-                accum = (s32)b[i] + (s32)((((s32)data[playpos.aword.high]*volume)>>6) << shiftval); \
-                if (accum<-32768) accum = -32768; else if (accum>32767) accum = 32767; \
-                b[i] = accum; \
-                playpos.adword+=incval; \
-                if ( playpos.adword>=loop_end ) \
-                  { \
-                    if (mod->instrument[mod->instnum[voice]].looped) \
-                      playpos.adword -= mod->instrument[mod->instnum[voice]].loop_length<<16; \
-                    else \
-                      { \
-                        playpos.adword = (mod->instrument[mod->instnum[voice]].loop_end-1)<<16; \
-                        mod->channel_active[voice] = FALSE; \
-                        break; \
-                      } \
-                  }
+#define MIX_BLOCK_SIZE    MOD_MIX_BLOCK_SIZE
 
-s32 mix_mono_16bit ( MOD * mod, s16 * buf, s32 numSamples )
+/* Fixed point layout of the accumulators: samples are interpolated to
+   8.8, multiplied by the 0..64 channel volume and summed as 32 bit. The
+   single saturate pass at the end scales them back to 16 bit. */
+#define MIX_FRAC_BITS     14
+
+typedef struct _mixvoice
   {
-    s32 accum;
-    s32 voice, i, j;
-    s16 * b = buf;
-    s32 shiftval = mod->shiftval;
-    s32 numIterations;
-    s32 numIterationsRest;
-    
-    numIterations = numSamples>>4;
-    numIterationsRest = numSamples&((1<<4)-1);
-
-
-    for (i=j=0;j<numIterations;j++)
+    const s8 * data;
+    u32 pos;
+    u32 inc;
+    u32 loop_end;
+    u32 loop_length;
+    BOOL looped;
+    s32 volume;
+  } MIX_VOICE;
+
+static inline s32 fetch_sample ( const MIX_VOICE * v, s32 idx )
+  {
+    s32 end = v->loop_end>>16;
+
+    if (idx<0)
+      idx = 0;
+    if (idx>=end)
       {
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
-        buf[i] = PREFILL_WORD;i++;
+        if (!v->looped)
+          return 0;
+        idx -= v->loop_length>>16;
+        while (idx>=end)
+          idx -= v->loop_length>>16;
       }
-    for (j=0;j<numIterationsRest;j++,i++)
-      buf[i] = PREFILL_WORD;
+    return v->data[idx];
+  }
 
+static inline s32 interp_linear ( s32 p1, s32 p2, s32 frac )
+  {
+    return (p1<<8) + (p2-p1)*frac;
+  }
 
-    for (voice=0;voice<mod->num_channels;++voice)
-      {
-        if (mod->instrument[mod->instnum[voice]].data != NULL && mod->channel_active[voice])
-          {
-            u32 incval,noteidx;
+/* Catmull-Rom spline with the halves folded into a final shift */
+static inline s32 interp_cubic ( s32 p0, s32 p1, s32 p2, s32 p3, s32 frac )
+  {
+    s32 t;
 
-			noteidx = (mod->chanfreq[voice] - mod->chanfreq[voice]*2*(mod->instrument[mod->instnum[voice]].finetune-8)/256);
-			incval = mod->inctab[noteidx];
+    t = (-p0 + 3*p1 - 3*p2 + p3)*frac;
+    t = ((t + ((2*p0 - 5*p1 + 4*p2 - p3)<<8))*frac)>>8;
+    t = ((t + ((p2 - p0)<<8))*frac)>>8;
+    return (p1<<8) + (t>>1);
+  }
 
-            s8 * data = mod->instrument[mod->instnum[voice]].data;
-            union_dword playpos;
-            u32 loop_end = mod->instrument[mod->instnum[voice]].loop_end<<16;
-            s32 volume = mod->volume[voice];
-            playpos.adword = mod->playpos[voice];
+static void run_nearest ( s32 * acc, s32 stride, const MIX_VOICE * v, u32 pos, s32 n )
+  {
+    const s8 * data = v->data;
+    u32 inc = v->inc;
+    s32 volume = v->volume<<8;
 
-            if ( voice<mod->num_voices )
-              volume = (volume*(s32)mod->musicvolume)>>6;
-            else
-              volume = (volume*(s32)mod->sfxvolume)>>6;
+    while (n-->0)
+      {
+        *acc += data[pos>>16]*volume;
+        acc += stride;
+        pos += inc;
+      }
+  }
 
-            if (mod->freq==32000 || mod->freq==48000)
-              incval >>= 2;
+static void run_linear ( s32 * acc, s32 stride, const MIX_VOICE * v, u32 pos, s32 n )
+  {
+    const s8 * data = v->data;
+    u32 inc = v->inc;
+    s32 volume = v->volume;
 
-            for (j=i=0;j<numIterations;j++)
-              {
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-                MIX_SAMPLES;i++;
-              }
-            for (j=0;j<numIterationsRest;j++,i++)
-              {
-                MIX_SAMPLES;
-              }
-            mod->playpos[voice] = playpos.adword;
-          }
+    while (n-->0)
+      {
+        const s8 * p = &data[pos>>16];
+        *acc += interp_linear(p[0],p[1],(pos>>8)&0xff)*volume;
+        acc += stride;
+        pos += inc;
       }
-    return numSamples;
   }
 
-s32 mix_stereo_16bit ( MOD * mod, s16 * buf, s32 numSamples )
+static void run_cubic ( s32 * acc, s32 stride, const MIX_VOICE * v, u32 pos, s32 n )
   {
-    s32 accum;
-    s32 voice, i, j;
-    s16 * b = buf;
-    s32 shiftval = mod->shiftval+1;
-    s32 numIterations, numIterationsRest;
+    const s8 * data = v->data;
+    u32 inc = v->inc;
+    s32 volume = v->volume;
 
-    numIterations = (numSamples)>>2;
-    numIterationsRest = (numSamples)&((1<<2)-1);
+    while (n-->0)
+      {
+        const s8 * p = &data[pos>>16];
+        *acc += interp_cubic(p[-1],p[0],p[1],p[2],(pos>>8)&0xff)*volume;
+        acc += stride;
+        pos += inc;
+      }
+  }
 
-    for (i=j=0;j<numIterations;j++)
+static s32 mix_one ( s32 mode, const MIX_VOICE * v, u32 pos )
+  {
+    s32 idx = pos>>16;
+    s32 frac = (pos>>8)&0xff;
+
+    switch (mode)
       {
-        buf[i] = buf[i+1] = PREFILL_WORD;i+=2;
-        buf[i] = buf[i+1] = PREFILL_WORD;i+=2;
-        buf[i] = buf[i+1] = PREFILL_WORD;i+=2;
-        buf[i] = buf[i+1] = PREFILL_WORD;i+=2;
+        case MOD_INTERP_LINEAR:
+          return interp_linear(fetch_sample(v,idx),fetch_sample(v,idx+1),frac)*v->volume;
+        case MOD_INTERP_CUBIC:
+          return interp_cubic(fetch_sample(v,idx-1),fetch_sample(v,idx),
+                              fetch_sample(v,idx+1),fetch_sample(v,idx+2),frac)*v->volume;
+        default:
+          return (fetch_sample(v,idx)<<8)*v->volume;
       }
-    for (j=0;j<numIterationsRest;j++,i+=2)
-        buf[i] = buf[i+1] = PREFILL_WORD;
+  }
 
-/*    for (j=0;j<numSamples*2;j+=2)
-      buf[j] = buf[j+1] = PREFILL_WORD;*/
+/* Mixes one voice into the accumulators. Runs that cannot touch the loop
+   boundary go through the branch free inner loops, only the few samples
+   around the boundary take the wrapping path. Returns FALSE once a
+   non-looped sample has ended. */
+static BOOL mix_voice ( MOD * mod, MIX_VOICE * v, s32 * acc, s32 stride, s32 count )
+  {
+    s32 mode = mod->interpolation;
+    u32 guard_lo, guard_hi, safe_end;
+    s32 n;
 
-    for (voice=0;voice<mod->num_channels;++voice)
+    guard_lo = (mode==MOD_INTERP_CUBIC) ? (1<<16) : 0;
+    guard_hi = (mode==MOD_INTERP_CUBIC) ? (2<<16) : (mode==MOD_INTERP_LINEAR) ? (1<<16) : 0;
+    safe_end = v->loop_end>guard_hi ? v->loop_end-guard_hi : 0;
+
+    while (count>0)
       {
-        s32 lrofs = (((voice-1)>>1)&1)^1;
-        if (mod->instrument[mod->instnum[voice]].data != NULL && mod->channel_active[voice])
+        if (v->pos>=guard_lo && v->pos<safe_end)
           {
-            u32 incval,noteidx;
-
-			noteidx = (mod->chanfreq[voice] - mod->chanfreq[voice]*2*(mod->instrument[mod->instnum[voice]].finetune-8)/256);
-			incval = mod->inctab[noteidx];
-
-            s8 * data = mod->instrument[mod->instnum[voice]].data;
-            union_dword playpos;
-            u32 loop_end = mod->instrument[mod->instnum[voice]].loop_end<<16;
-            s32 volume = mod->volume[voice];
-            
-            if ( voice<mod->num_voices )
-              volume = (volume*(s32)mod->musicvolume)>>6;
+            if (v->inc==0)
+              n = count;
             else
-              volume = (volume*(s32)mod->sfxvolume)>>6;
-
-            playpos.adword = mod->playpos[voice];            
-            if (mod->freq==32000 || mod->freq==48000)
-              incval >>= 2;
-            
-            i = lrofs;
-            for (j=0;j<numIterations;j++)
               {
-                MIX_SAMPLES;i+=2;
-                MIX_SAMPLES;i+=2;
-                MIX_SAMPLES;i+=2;
-                MIX_SAMPLES;i+=2;
+                n = (safe_end - v->pos + v->inc - 1)/v->inc;
+                if (n>count)
+                  n = count;
               }
-            for (j=0;j<numIterationsRest;j++)
+
+            if (mode==MOD_INTERP_CUBIC)
+              run_cubic(acc,stride,v,v->pos,n);
+            else if (mode==MOD_INTERP_LINEAR)
+              run_linear(acc,stride,v,v->pos,n);
+            else
+              run_nearest(acc,stride,v,v->pos,n);
+
+            v->pos += v->inc*n;
+            acc += stride*n;
+            count -= n;
+          }
+        else
+          {
+            *acc += mix_one(mode,v,v->pos);
+            v->pos += v->inc;
+            acc += stride;
+            count--;
+          }
+
+        while (v->pos>=v->loop_end)
+          {
+            if (!v->looped)
               {
-                MIX_SAMPLES;i+=2;
+                v->pos = v->loop_end-(1<<16);
+                return FALSE;
               }
-/*            for (i=0;i<numSamples*2;i+=2)
-              {
-                MIX_SAMPLES;
-              }*/
-            mod->playpos[voice] = playpos.adword;
+            v->pos -= v->loop_length;
           }
       }
+    return TRUE;
+  }
+
+static void mix_block ( MOD * mod, s16 * buf, s32 numFrames, s32 channels )
+  {
+    s32 voice, i;
+    s32 * acc = mod->mixaccum;
+    s32 shiftval = MIX_FRAC_BITS - (mod->shiftval + (channels-1));
+    s32 total = numFrames*channels;
+    MIX_VOICE v;
+
+    memset(acc,0,total*sizeof(s32));
+
+    for (voice=0;voice<mod->num_channels;++voice)
+      {
+        MOD_INSTR * instr = &mod->instrument[mod->instnum[voice]];
+        s32 lrofs = 0;
+        u32 noteidx;
+
+        if (instr->data == NULL || !mod->channel_active[voice])
+          continue;
+
+        noteidx = (mod->chanfreq[voice] - mod->chanfreq[voice]*2*(instr->finetune-8)/256);
+
+        v.data = instr->data;
+        v.pos = mod->playpos[voice];
+        v.inc = mod->inctab[noteidx];
+        v.loop_end = instr->loop_end<<16;
+        v.loop_length = instr->loop_length<<16;
+        v.looped = instr->looped && v.loop_length!=0;
+        v.volume = mod->volume[voice];
+
+        if ( voice<mod->num_voices )
+          v.volume = (v.volume*(s32)mod->musicvolume)>>6;
+        else
+          v.volume = (v.volume*(s32)mod->sfxvolume)>>6;
+
+        if (mod->freq==32000 || mod->freq==48000)
+          v.inc >>= 2;
+
+        if (channels==2)
+          lrofs = (((voice-1)>>1)&1)^1;
+
+        if (!mix_voice(mod,&v,&acc[lrofs],channels,numFrames))
+          mod->channel_active[voice] = FALSE;
+        mod->playpos[voice] = v.pos;
+      }
+
+    for (i=0;i<total;i++)
+      {
+        s32 accum = (s32)(s16)PREFILL_WORD + (acc[i]>>shiftval);
+        if (accum<-32768) accum = -32768; else if (accum>32767) accum = 32767;
+        buf[i] = accum;
+      }
+  }
 
+s32 mix_mono_16bit ( MOD * mod, s16 * buf, s32 numSamples )
+  {
+    s32 done, n;
+
+    for (done=0;done<numSamples;done+=n)
+      {
+        n = numSamples-done;
+        if (n>MIX_BLOCK_SIZE)
+          n = MIX_BLOCK_SIZE;
+        mix_block(mod,&buf[done],n,1);
+      }
+    return numSamples;
+  }
+
+s32 mix_stereo_16bit ( MOD * mod, s16 * buf, s32 numSamples )
+  {
+    s32 done, n;
+
+    for (done=0;done<numSamples;done+=n)
+      {
+        n = numSamples-done;
+        if (n>MIX_BLOCK_SIZE/2)
+          n = MIX_BLOCK_SIZE/2;
+        mix_block(mod,&buf[done<<1],n,2);
+      }
     return numSamples;
   }
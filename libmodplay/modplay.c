@@ -1154,6 +1154,17 @@ u32 MOD_Player ( MOD * mod )
     return retval;
   }
 
+s32 MOD_SetInterpolation ( MOD * mod, s32 mode )
+  {
+    if (mod==NULL)
+      return -1;
+    if (mode<MOD_INTERP_NONE || mode>MOD_INTERP_CUBIC)
+      return -1;
+
+    mod->interpolation = mode;
+    return 0;
+  }
+
 s32 MOD_TriggerNote ( MOD * mod, s32 channel, u8 instnum, u16 freq, u8 vol )
   {
     if (mod==NULL)
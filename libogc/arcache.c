@@ -0,0 +1,665 @@
+/*-------------------------------------------------------------
+
+arcache.c -- ARAM heap and asset cache
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+#include "processor.h"
+#include "cache.h"
+#include "arqueue.h"
+#include "arcache.h"
+
+#define ARH_NUMCLASSES			24
+#define ARC_ARQOWNER			0x41524300
+#define ARC_ENTRY_DEAD			0x0001
+#define ROUNDUP32(x)			(((u32)(x)+0x1f)&~0x1f)
+
+/* ARAM isn't addressable by the CPU, so the heap keeps its block headers in
+ * main memory. blocks are linked in address order for coalescing, free ones
+ * additionally in a list per power of two size class.
+ */
+typedef struct _arh_block {
+	struct _arh_block *prev,*next;
+	struct _arh_block *fprev,*fnext;
+	u32 addr,len;
+	BOOL free;
+} arh_block;
+
+typedef struct _arc_entry {
+	struct _arc_entry *hnext;
+	struct _arc_entry *lprev,*lnext;
+	arh_block *blk;
+	u32 key,len;
+	u32 pins,flags;
+} arc_entry;
+
+static arh_block *__arh_blocks = NULL;
+static arh_block *__arh_spare = NULL;
+static arh_block *__arh_first = NULL;
+static arh_block *__arh_freelist[ARH_NUMCLASSES];
+static u32 __arh_freebytes = 0;
+
+static arc_entry *__arc_entries = NULL;
+static arc_entry *__arc_spare = NULL;
+static arc_entry **__arc_hash = NULL;
+static u32 __arc_maxentries = 0;
+static u32 __arc_hashmask = 0;
+static u32 __arc_pinned = 0;
+static arc_entry __arc_lru;
+static arc_stats __arc_stats;
+
+static __inline__ u32 __arh_class(u32 len)
+{
+	u32 cls = (31 - cntlzw(len)) - 5;
+	return (cls<ARH_NUMCLASSES) ? cls : (ARH_NUMCLASSES - 1);
+}
+
+static void __arh_linkfree(arh_block *blk)
+{
+	u32 cls = __arh_class(blk->len);
+
+	blk->free = TRUE;
+	blk->fprev = NULL;
+	blk->fnext = __arh_freelist[cls];
+	if(blk->fnext) blk->fnext->fprev = blk;
+	__arh_freelist[cls] = blk;
+	__arh_freebytes += blk->len;
+}
+
+static void __arh_unlinkfree(arh_block *blk)
+{
+	if(blk->fprev) blk->fprev->fnext = blk->fnext;
+	else __arh_freelist[__arh_class(blk->len)] = blk->fnext;
+	if(blk->fnext) blk->fnext->fprev = blk->fprev;
+
+	blk->free = FALSE;
+	__arh_freebytes -= blk->len;
+}
+
+static arh_block* __arh_alloc(u32 len)
+{
+	u32 cls;
+	arh_block *blk,*rest;
+
+	// first fit within the size class of len, any block of a larger class fits
+	cls = __arh_class(len);
+	for(blk=__arh_freelist[cls];blk;blk=blk->fnext) {
+		if(blk->len>=len) break;
+	}
+	for(cls++;!blk && cls<ARH_NUMCLASSES;cls++) blk = __arh_freelist[cls];
+	if(!blk) return NULL;
+
+	__arh_unlinkfree(blk);
+
+	// without a spare header the caller simply gets the whole block
+	if(blk->len>len && __arh_spare) {
+		rest = __arh_spare;
+		__arh_spare = rest->next;
+
+		rest->addr = blk->addr + len;
+		rest->len = blk->len - len;
+		rest->prev = blk;
+		rest->next = blk->next;
+		if(blk->next) blk->next->prev = rest;
+		blk->next = rest;
+		blk->len = len;
+		__arh_linkfree(rest);
+	}
+	return blk;
+}
+
+static void __arh_free(arh_block *blk)
+{
+	arh_block *nb;
+
+	nb = blk->next;
+	if(nb && nb->free) {
+		__arh_unlinkfree(nb);
+		blk->len += nb->len;
+		blk->next = nb->next;
+		if(nb->next) nb->next->prev = blk;
+		nb->next = __arh_spare;
+		__arh_spare = nb;
+	}
+
+	nb = blk->prev;
+	if(nb && nb->free) {
+		__arh_unlinkfree(nb);
+		nb->len += blk->len;
+		nb->next = blk->next;
+		if(blk->next) blk->next->prev = nb;
+		blk->next = __arh_spare;
+		__arh_spare = blk;
+		blk = nb;
+	}
+	__arh_linkfree(blk);
+}
+
+static __inline__ u32 __arc_hashkey(u32 key)
+{
+	return ((key*0x9e3779b1)>>16)&__arc_hashmask;
+}
+
+static arc_entry* __arc_lookup(u32 key)
+{
+	arc_entry *entry;
+
+	for(entry=__arc_hash[__arc_hashkey(key)];entry;entry=entry->hnext) {
+		if(entry->key==key) break;
+	}
+	return entry;
+}
+
+static __inline__ void __arc_lruunlink(arc_entry *entry)
+{
+	entry->lprev->lnext = entry->lnext;
+	entry->lnext->lprev = entry->lprev;
+}
+
+static __inline__ void __arc_lrupush(arc_entry *entry)
+{
+	entry->lprev = &__arc_lru;
+	entry->lnext = __arc_lru.lnext;
+	__arc_lru.lnext->lprev = entry;
+	__arc_lru.lnext = entry;
+}
+
+static void __arc_reset(void)
+{
+	u32 i;
+
+	__arc_lru.lprev = __arc_lru.lnext = &__arc_lru;
+	for(i=0;i<=__arc_hashmask;i++) __arc_hash[i] = NULL;
+
+	__arc_spare = NULL;
+	for(i=0;i<__arc_maxentries;i++) {
+		__arc_entries[i].hnext = __arc_spare;
+		__arc_spare = &__arc_entries[i];
+	}
+	__arc_stats.entries = 0;
+	__arc_stats.used_bytes = 0;
+}
+
+static void __arc_release(arc_entry *entry)
+{
+	__arc_stats.used_bytes -= entry->blk->len;
+	__arh_free(entry->blk);
+
+	entry->blk = NULL;
+	entry->hnext = __arc_spare;
+	__arc_spare = entry;
+}
+
+// storage of an entry with fetches in flight is released by the last one
+static void __arc_drop(arc_entry *entry)
+{
+	arc_entry **pentry;
+
+	pentry = &__arc_hash[__arc_hashkey(entry->key)];
+	while(*pentry!=entry) pentry = &(*pentry)->hnext;
+	*pentry = entry->hnext;
+
+	__arc_lruunlink(entry);
+	__arc_stats.entries--;
+
+	if(entry->pins) entry->flags |= ARC_ENTRY_DEAD;
+	else __arc_release(entry);
+}
+
+static __inline__ void __arc_unpin(arc_entry *entry)
+{
+	__arc_pinned--;
+	if(--entry->pins==0 && (entry->flags&ARC_ENTRY_DEAD)) __arc_release(entry);
+}
+
+static BOOL __arc_evictlru(void)
+{
+	arc_entry *entry;
+
+	for(entry=__arc_lru.lprev;entry!=&__arc_lru;entry=entry->lprev) {
+		if(!entry->pins) {
+			__arc_drop(entry);
+			__arc_stats.evictions++;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static arc_entry* __arc_newentry(u32 len)
+{
+	arc_entry *entry;
+	arh_block *blk;
+
+	while(!__arc_spare) {
+		if(!__arc_evictlru()) return NULL;
+	}
+	while(!(blk=__arh_alloc(len))) {
+		if(!__arc_evictlru()) return NULL;
+	}
+
+	entry = __arc_spare;
+	__arc_spare = entry->hnext;
+	entry->blk = blk;
+	return entry;
+}
+
+static arc_entry* __arc_pin(u32 key,u32 offset,u32 len,s32 *ret)
+{
+	u32 size;
+	arc_entry *entry;
+
+	entry = __arc_lookup(key);
+	if(!entry) {
+		__arc_stats.misses++;
+		*ret = ARC_ENOENT;
+		return NULL;
+	}
+
+	size = ROUNDUP32(entry->len);
+	if(offset>=size || len>(size - offset)) {
+		*ret = ARC_EINVAL;
+		return NULL;
+	}
+
+	entry->pins++;
+	__arc_pinned++;
+	__arc_lruunlink(entry);
+	__arc_lrupush(entry);
+	__arc_stats.hits++;
+
+	*ret = ARC_OK;
+	return entry;
+}
+
+static void __arc_fetchcallback(ARQRequest *arq)
+{
+	ARCRequest *req = (ARCRequest*)arq;
+
+	__arc_unpin((arc_entry*)req->entry);
+	req->entry = NULL;
+
+	// high priority requests are never split, so len is still the full transfer
+	if(req->callback) req->callback(req,arq->len);
+}
+
+s32 ARH_Init(u32 aram_base,u32 len,u32 max_blocks)
+{
+	u32 i,end,level;
+	arh_block *blocks,*old;
+
+	end = (aram_base + len)&~0x1f;
+	aram_base = ROUNDUP32(aram_base);
+	if(!aram_base || end<=aram_base || !max_blocks) return ARC_EINVAL;
+
+	blocks = malloc(max_blocks*sizeof(arh_block));
+	if(!blocks) return ARC_ENOMEM;
+
+	for(i=1;i<max_blocks;i++) blocks[i].next = (i<(max_blocks - 1)) ? &blocks[i + 1] : NULL;
+
+	_CPU_ISR_Disable(level);
+	// fetches in flight release their blocks when they complete
+	if(__arc_pinned) {
+		_CPU_ISR_Restore(level);
+		free(blocks);
+		return ARC_EBUSY;
+	}
+	old = __arh_blocks;
+
+	__arh_blocks = blocks;
+	__arh_spare = (max_blocks>1) ? &blocks[1] : NULL;
+	__arh_freebytes = 0;
+	for(i=0;i<ARH_NUMCLASSES;i++) __arh_freelist[i] = NULL;
+
+	__arh_first = &blocks[0];
+	__arh_first->prev = NULL;
+	__arh_first->next = NULL;
+	__arh_first->addr = aram_base;
+	__arh_first->len = end - aram_base;
+	__arh_linkfree(__arh_first);
+
+	// cached assets lived in the old heap
+	if(__arc_entries) __arc_reset();
+	_CPU_ISR_Restore(level);
+
+	if(old) free(old);
+	return ARC_OK;
+}
+
+u32 ARH_Alloc(u32 len)
+{
+	u32 level,addr;
+	arh_block *blk;
+
+	if(!len) return 0;
+
+	addr = 0;
+	_CPU_ISR_Disable(level);
+	if(__arh_blocks) {
+		blk = __arh_alloc(ROUNDUP32(len));
+		if(blk) addr = blk->addr;
+	}
+	_CPU_ISR_Restore(level);
+
+	return addr;
+}
+
+void ARH_Free(u32 aram_addr)
+{
+	u32 level;
+	arh_block *blk;
+
+	_CPU_ISR_Disable(level);
+	for(blk=__arh_first;blk;blk=blk->next) {
+		if(blk->addr==aram_addr) {
+			if(!blk->free) __arh_free(blk);
+			break;
+		}
+	}
+	_CPU_ISR_Restore(level);
+}
+
+u32 ARH_GetFreeSize(void)
+{
+	return __arh_freebytes;
+}
+
+u32 ARH_GetLargestFree(void)
+{
+	s32 cls;
+	u32 level,len;
+	arh_block *blk;
+
+	len = 0;
+	_CPU_ISR_Disable(level);
+	for(cls=(ARH_NUMCLASSES - 1);cls>=0 && !len;cls--) {
+		for(blk=__arh_freelist[cls];blk;blk=blk->fnext) {
+			if(blk->len>len) len = blk->len;
+		}
+	}
+	_CPU_ISR_Restore(level);
+
+	return len;
+}
+
+s32 ARC_Init(u32 max_entries)
+{
+	u32 level,hashsize;
+	arc_entry *entries,*oldentries;
+	arc_entry **hash,**oldhash;
+
+	if(!max_entries) return ARC_EINVAL;
+
+	hashsize = 1;
+	while(hashsize<max_entries && hashsize<0x10000) hashsize <<= 1;
+
+	entries = malloc(max_entries*sizeof(arc_entry));
+	hash = malloc(hashsize*sizeof(arc_entry*));
+	if(!entries || !hash) {
+		free(entries);
+		free(hash);
+		return ARC_ENOMEM;
+	}
+
+	_CPU_ISR_Disable(level);
+	// fetches in flight still point at their entries
+	if(__arc_pinned) {
+		_CPU_ISR_Restore(level);
+		free(entries);
+		free(hash);
+		return ARC_EBUSY;
+	}
+	oldentries = __arc_entries;
+	oldhash = __arc_hash;
+
+	// give the old storage back before forgetting about it
+	if(oldentries) {
+		while(__arc_lru.lnext!=&__arc_lru) __arc_drop(__arc_lru.lnext);
+	}
+
+	__arc_entries = entries;
+	__arc_hash = hash;
+	__arc_maxentries = max_entries;
+	__arc_hashmask = hashsize - 1;
+	memset(&__arc_stats,0,sizeof(arc_stats));
+	__arc_reset();
+	_CPU_ISR_Restore(level);
+
+	if(oldentries) free(oldentries);
+	if(oldhash) free(oldhash);
+	return ARC_OK;
+}
+
+s32 ARC_Insert(u32 key,void *buffer,u32 len)
+{
+	u32 level,rlen;
+	arc_entry *entry,*old,*entries;
+	ARQRequest arq;
+
+	if(!__arc_entries || !__arh_blocks) return ARC_EINVAL;
+	if(!buffer || ((u32)buffer)&0x1f || !len) return ARC_EINVAL;
+
+	rlen = ROUNDUP32(len);
+
+	_CPU_ISR_Disable(level);
+	old = __arc_lookup(key);
+	if(old) __arc_drop(old);
+	entry = __arc_newentry(rlen);
+	if(!entry) {
+		_CPU_ISR_Restore(level);
+		return ARC_ENOMEM;
+	}
+
+	entry->key = key;
+	entry->len = len;
+	entry->pins = 0;
+	entry->flags = 0;
+
+	// the copy holds the entry and its block like a fetch does
+	entries = __arc_entries;
+	__arc_pinned++;
+	_CPU_ISR_Restore(level);
+
+	DCFlushRange(buffer,rlen);
+	ARQ_PostRequest(&arq,ARC_ARQOWNER,ARQ_MRAMTOARAM,ARQ_PRIO_LO,entry->blk->addr,(u32)buffer,rlen);
+
+	_CPU_ISR_Disable(level);
+	__arc_pinned--;
+	if(__arc_entries!=entries) {
+		_CPU_ISR_Restore(level);
+		return ARC_EBUSY;
+	}
+
+	// someone else may have cached the same key while we were copying
+	old = __arc_lookup(key);
+	if(old) __arc_drop(old);
+
+	entry->hnext = __arc_hash[__arc_hashkey(key)];
+	__arc_hash[__arc_hashkey(key)] = entry;
+	__arc_lrupush(entry);
+
+	__arc_stats.inserts++;
+	__arc_stats.entries++;
+	__arc_stats.used_bytes += entry->blk->len;
+	_CPU_ISR_Restore(level);
+
+	return ARC_OK;
+}
+
+static void __arc_fetch(arc_entry *entry,void *dest,u32 offset,u32 rlen)
+{
+	u32 level;
+	ARQRequest arq;
+
+	DCInvalidateRange(dest,rlen);
+	ARQ_PostRequest(&arq,ARC_ARQOWNER,ARQ_ARAMTOMRAM,ARQ_PRIO_HI,entry->blk->addr + offset,(u32)dest,rlen);
+
+	_CPU_ISR_Disable(level);
+	__arc_unpin(entry);
+	_CPU_ISR_Restore(level);
+}
+
+s32 ARC_Fetch(u32 key,void *dest,u32 offset,u32 len)
+{
+	s32 ret;
+	u32 level,rlen;
+	arc_entry *entry;
+
+	if(!__arc_entries) return ARC_EINVAL;
+	if(!dest || ((u32)dest)&0x1f || offset&0x1f || !len) return ARC_EINVAL;
+
+	rlen = ROUNDUP32(len);
+
+	_CPU_ISR_Disable(level);
+	entry = __arc_pin(key,offset,rlen,&ret);
+	_CPU_ISR_Restore(level);
+
+	if(!entry) return ret;
+
+	__arc_fetch(entry,dest,offset,rlen);
+	return rlen;
+}
+
+s32 ARC_FetchAsync(ARCRequest *req,u32 key,void *dest,u32 offset,u32 len,ARCCallback cb)
+{
+	s32 ret;
+	u32 level,rlen;
+	arc_entry *entry;
+
+	if(!__arc_entries || !req) return ARC_EINVAL;
+	if(!dest || ((u32)dest)&0x1f || offset&0x1f || !len) return ARC_EINVAL;
+
+	rlen = ROUNDUP32(len);
+
+	_CPU_ISR_Disable(level);
+	entry = __arc_pin(key,offset,rlen,&ret);
+	_CPU_ISR_Restore(level);
+
+	if(!entry) return ret;
+
+	req->callback = cb;
+	req->entry = entry;
+
+	DCInvalidateRange(dest,rlen);
+	ARQ_PostRequestAsync(&req->arq,ARC_ARQOWNER,ARQ_ARAMTOMRAM,ARQ_PRIO_HI,entry->blk->addr + offset,(u32)dest,rlen,__arc_fetchcallback);
+
+	return ARC_OK;
+}
+
+s32 ARC_Load(u32 key,void *dest,u32 len,ARCLoader loader,void *usrdata)
+{
+	s32 ret;
+	u32 level,size;
+	arc_entry *entry;
+
+	if(!__arc_entries) return ARC_EINVAL;
+	if(!dest || ((u32)dest)&0x1f || !len || !loader) return ARC_EINVAL;
+
+	// an asset the loader came up short on is cached with the length it had
+	_CPU_ISR_Disable(level);
+	entry = __arc_lookup(key);
+	size = (entry && entry->len<len) ? entry->len : len;
+	entry = __arc_pin(key,0,ROUNDUP32(size),&ret);
+	_CPU_ISR_Restore(level);
+
+	if(entry) {
+		__arc_fetch(entry,dest,0,ROUNDUP32(size));
+		return size;
+	}
+	if(ret!=ARC_ENOENT) return ret;
+
+	ret = loader(key,dest,len,usrdata);
+	if(ret<0) return ARC_EIO;
+
+	// failing to cache the asset doesn't fail the read
+	if(ret>0) ARC_Insert(key,dest,ret);
+	return ret;
+}
+
+BOOL ARC_Contains(u32 key)
+{
+	u32 level;
+	BOOL ret = FALSE;
+
+	_CPU_ISR_Disable(level);
+	if(__arc_entries) ret = (__arc_lookup(key)!=NULL);
+	_CPU_ISR_Restore(level);
+
+	return ret;
+}
+
+void ARC_Evict(u32 key)
+{
+	u32 level;
+	arc_entry *entry;
+
+	_CPU_ISR_Disable(level);
+	if(__arc_entries) {
+		entry = __arc_lookup(key);
+		if(entry) __arc_drop(entry);
+	}
+	_CPU_ISR_Restore(level);
+}
+
+void ARC_Flush(void)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	if(__arc_entries) {
+		while(__arc_lru.lnext!=&__arc_lru) __arc_drop(__arc_lru.lnext);
+	}
+	_CPU_ISR_Restore(level);
+}
+
+void ARC_GetStats(arc_stats *stats)
+{
+	u32 level;
+
+	if(!stats) return;
+
+	_CPU_ISR_Disable(level);
+	*stats = __arc_stats;
+	stats->free_bytes = __arh_freebytes;
+	_CPU_ISR_Restore(level);
+}
+
+void ARC_ResetStats(void)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	__arc_stats.hits = 0;
+	__arc_stats.misses = 0;
+	__arc_stats.inserts = 0;
+	__arc_stats.evictions = 0;
+	_CPU_ISR_Restore(level);
+}
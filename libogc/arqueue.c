@@ -34,11 +34,18 @@ distribution.
 
 #include "asm.h"
 #include "processor.h"
+#include "timesupp.h"
 #include "arqueue.h"
 
 //#define _ARQ_DEBUG
 
+#define ARQ_MAX_CHUNK_SIZE		(1024*1024)
+
 static u32 __ARQChunkSize;
+static u32 __ARQMaxLatency = 0;
+static u32 __ARQRate = 0;
+static u32 __ARQDMAStart = 0;
+static u32 __ARQDMALen = 0;
 static u32 __ARQInitFlag = 0;
 static lwpq_t __ARQSyncQueue;
 
@@ -49,20 +56,74 @@ static ARQRequest *__ARQReqPendingHi;
 static ARQCallback __ARQCallbackLo = NULL;
 static ARQCallback __ARQCallbackHi = NULL;
 
+static __inline__ void __ARQNextSegment(ARQRequest *req)
+{
+	while(req->nsegs>0) {
+		req->aram_addr = req->segs->aram_addr;
+		req->mram_addr = req->segs->mram_addr;
+		req->len = req->segs->len;
+		req->segs++;
+		req->nsegs--;
+		if(req->len) break;
+	}
+}
+
+/* starts the next piece of req, at most maxlen bytes long. returns TRUE
+ * if this DMA completes the request. req->segs/nsegs always describe the
+ * segments not yet loaded into aram_addr/mram_addr/len.
+ */
+static BOOL __ARQStartNext(ARQRequest *req,u32 maxlen)
+{
+	u32 len;
+
+	len = req->len;
+	if(len>maxlen) len = maxlen;
+
+	AR_StartDMA(req->dir,req->mram_addr,req->aram_addr,len);
+	__ARQDMAStart = gettick();
+	__ARQDMALen = len;
+
+	if(len==req->len && !req->nsegs) return TRUE;
+
+	req->len -= len;
+	req->aram_addr += len;
+	req->mram_addr += len;
+	if(!req->len) __ARQNextSegment(req);
+	return FALSE;
+}
+
 static __inline__ void __ARQPopTaskQueueHi(void)
 {
 	ARQRequest *req;
 
-	req = (ARQRequest*)__lwp_queue_getI(&__ARQReqQueueHi);
-	if(!req) return;
+	req = __ARQReqPendingHi;
+	if(!req) {
+		req = (ARQRequest*)__lwp_queue_getI(&__ARQReqQueueHi);
+		if(!req) return;
 
-	req->state = ARQ_TASK_RUNNING;
+		req->state = ARQ_TASK_RUNNING;
+		__ARQReqPendingHi = req;
+	}
 #ifdef _ARQ_DEBUG
-	printf("__ARQPopTaskQueueHi(%02x,%08x,%08x,%d)\n",req->dir,req->aram_addr,req->mram_addr,req->len);
+	printf("__ARQPopTaskQueueHi(%02x,%08x,%08x,%d,%d)\n",req->dir,req->aram_addr,req->mram_addr,req->len,req->nsegs);
 #endif
-	AR_StartDMA(req->dir,req->mram_addr,req->aram_addr,req->len);
-	__ARQCallbackHi = req->callback;
-	__ARQReqPendingHi = req;
+	if(__ARQStartNext(req,~0)) __ARQCallbackHi = req->callback;
+}
+
+/* with a latency bound set, size low priority chunks so that a high
+ * priority request never waits longer than the bound for the bus.
+ */
+static u32 __ARQLoChunkSize(void)
+{
+	u32 size;
+
+	if(!__ARQMaxLatency || !__ARQRate) return __ARQChunkSize;
+
+	size = ((u64)__ARQRate*__ARQMaxLatency)>>16;
+	size &= ~31;
+	if(size<32) size = 32;
+	if(size>ARQ_MAX_CHUNK_SIZE) size = ARQ_MAX_CHUNK_SIZE;
+	return size;
 }
 
 static void __ARQCallbackDummy(ARQRequest *req)
@@ -87,22 +148,23 @@ static void __ARQServiceQueueLo(void)
 	if(req) {
 		req->state = ARQ_TASK_RUNNING;
 #ifdef _ARQ_DEBUG
-		printf("__ARQServiceQueueLo(%02x,%08x,%08x,%d,%d)\n",req->dir,req->aram_addr,req->mram_addr,req->len,__ARQChunkSize);
+		printf("__ARQServiceQueueLo(%02x,%08x,%08x,%d,%d,%d)\n",req->dir,req->aram_addr,req->mram_addr,req->len,req->nsegs,__ARQLoChunkSize());
 #endif
-		if(req->len<=__ARQChunkSize) {
-			AR_StartDMA(req->dir,req->mram_addr,req->aram_addr,req->len);
-			__ARQCallbackLo = __ARQReqPendingLo->callback;
-		} else {
-			AR_StartDMA(req->dir,req->mram_addr,req->aram_addr,__ARQChunkSize);
-			__ARQReqPendingLo->len -= __ARQChunkSize;
-			__ARQReqPendingLo->aram_addr += __ARQChunkSize;
-			__ARQReqPendingLo->mram_addr += __ARQChunkSize;
-		}
+		if(__ARQStartNext(req,__ARQLoChunkSize())) __ARQCallbackLo = req->callback;
 	}
 }
 
 static void __ARInterruptServiceRoutine(void)
 {
+	u32 rate,elapsed;
+
+	elapsed = diff_ticks(__ARQDMAStart,gettick());
+	if(__ARQDMALen && elapsed) {
+		rate = ((u64)__ARQDMALen<<16)/elapsed;
+		__ARQRate = __ARQRate ? ((__ARQRate - (__ARQRate>>2)) + (rate>>2)) : rate;
+	}
+	__ARQDMALen = 0;
+
 	if(__ARQCallbackHi) {
 		__ARQReqPendingHi->state = ARQ_TASK_FINISHED;
 		__ARQCallbackHi(__ARQReqPendingHi);
@@ -134,6 +196,8 @@ void ARQ_Init(void)
 	__ARQCallbackHi = NULL;
 	
 	__ARQChunkSize = ARQ_DEF_CHUNK_SIZE;
+	__ARQDMALen = 0;
+	__ARQRate = 0;
 
 	LWP_InitQueue(&__ARQSyncQueue);
 
@@ -172,6 +236,14 @@ u32 ARQ_GetChunkSize(void)
 	return __ARQChunkSize;
 }
 
+void ARQ_SetMaxLatency(u32 usecs)
+{
+	u32 level;
+	_CPU_ISR_Disable(level);
+	__ARQMaxLatency = microsecs_to_ticks(usecs);
+	_CPU_ISR_Restore(level);
+}
+
 void ARQ_FlushQueue(void)
 {
 	u32 level;
@@ -185,10 +257,24 @@ void ARQ_FlushQueue(void)
 	_CPU_ISR_Restore(level);
 }
 
-void ARQ_PostRequestAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u32 mram_addr,u32 len,ARQCallback cb)
+static void __ARQPostRequest(ARQRequest *req)
 {
 	u32 level;
 
+	_CPU_ISR_Disable(level);
+
+	if(req->prio==ARQ_PRIO_LO) __lwp_queue_appendI(&__ARQReqQueueLo,&req->node);
+	else __lwp_queue_appendI(&__ARQReqQueueHi,&req->node);
+
+	if(!__ARQReqPendingLo && !__ARQReqPendingHi) {
+		__ARQPopTaskQueueHi();
+		if(!__ARQReqPendingHi) __ARQServiceQueueLo();
+	}
+	_CPU_ISR_Restore(level);
+}
+
+void ARQ_PostRequestAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u32 mram_addr,u32 len,ARQCallback cb)
+{
 	req->state = ARQ_TASK_READY;
 	req->dir = dir;
 	req->owner = owner;
@@ -196,26 +282,37 @@ void ARQ_PostRequestAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_ad
 	req->mram_addr = mram_addr;
 	req->len = len;
 	req->prio = prio;
+	req->segs = NULL;
+	req->nsegs = 0;
 	req->callback = (cb==NULL) ? __ARQCallbackDummy : cb;
-	
-	_CPU_ISR_Disable(level);
 
-	if(prio==ARQ_PRIO_LO) __lwp_queue_appendI(&__ARQReqQueueLo,&req->node);
-	else __lwp_queue_appendI(&__ARQReqQueueHi,&req->node);
+	__ARQPostRequest(req);
+}
 
-	if(!__ARQReqPendingLo && !__ARQReqPendingHi) {
-		__ARQPopTaskQueueHi();
-		if(!__ARQReqPendingHi) __ARQServiceQueueLo();
-	}
-	_CPU_ISR_Restore(level);
+void ARQ_PostRequestSGAsync(ARQRequest *req,u32 owner,u32 dir,u32 prio,const ARQSegment *segs,u32 nsegs,ARQCallback cb)
+{
+	// trailing empty segments would leave the last real DMA looking unfinished
+	while(nsegs>0 && segs[nsegs - 1].len==0) nsegs--;
+
+	req->state = ARQ_TASK_READY;
+	req->dir = dir;
+	req->owner = owner;
+	req->aram_addr = 0;
+	req->mram_addr = 0;
+	req->len = 0;
+	req->prio = prio;
+	req->segs = segs;
+	req->nsegs = nsegs;
+	req->callback = (cb==NULL) ? __ARQCallbackDummy : cb;
+	__ARQNextSegment(req);
+
+	__ARQPostRequest(req);
 }
 
-void ARQ_PostRequest(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u32 mram_addr,u32 len)
+static void __ARQWaitRequest(ARQRequest *req)
 {
 	u32 level;
 
-	ARQ_PostRequestAsync(req,owner,dir,prio,aram_addr,mram_addr,len,__ARQCallbackSync);
-
 	_CPU_ISR_Disable(level);
 	while(req->state!=ARQ_TASK_FINISHED) {
 		LWP_ThreadSleep(__ARQSyncQueue);
@@ -223,6 +320,18 @@ void ARQ_PostRequest(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u3
 	_CPU_ISR_Restore(level);
 }
 
+void ARQ_PostRequest(ARQRequest *req,u32 owner,u32 dir,u32 prio,u32 aram_addr,u32 mram_addr,u32 len)
+{
+	ARQ_PostRequestAsync(req,owner,dir,prio,aram_addr,mram_addr,len,__ARQCallbackSync);
+	__ARQWaitRequest(req);
+}
+
+void ARQ_PostRequestSG(ARQRequest *req,u32 owner,u32 dir,u32 prio,const ARQSegment *segs,u32 nsegs)
+{
+	ARQ_PostRequestSGAsync(req,owner,dir,prio,segs,nsegs,__ARQCallbackSync);
+	__ARQWaitRequest(req);
+}
+
 void ARQ_RemoveRequest(ARQRequest *req)
 {
 	u32 level;
@@ -78,9 +78,11 @@ typedef struct _cond_st {
 
 lwp_objinfo _lwp_cond_objects;
 
+u32 __attribute__((weak)) __lwp_limit_condvars = LWP_LIMIT_CONDVARS;
+
 void __lwp_cond_init(void)
 {
-	__lwp_objmgr_initinfo(&_lwp_cond_objects,LWP_MAX_CONDVARS,sizeof(cond_st));
+	__lwp_objmgr_initinfoex(&_lwp_cond_objects,LWP_MAX_CONDVARS,__lwp_limit_condvars,sizeof(cond_st));
 }
 
 static __inline__ cond_st* __lwp_cond_open(cond_t cond)
@@ -78,32 +78,119 @@ static const unsigned int color_table[] =
 };
 
 static u32 do_xfb_copy = FALSE;
+static bool _console_dirty_copy = false;
 static struct _console_data_s _console_data;
 static struct _console_data_s *curr_con = NULL;
 static void *_console_buffer = NULL;
+static unsigned short *_console_cells = NULL;
+
+// per glyph byte, a mask selecting the foreground in each of the
+// FONT_XSIZE/2 YUYV pixel pairs
+static unsigned int _console_glyph_mask[256][FONT_XSIZE/2];
+static int _console_glyph_mask_init = 0;
 
 static FILE *stdcon = NULL;
 
 extern u8 console_font_8x16[];
 
+static inline int __console_phys_row(console_data_s *con,int row)
+{
+	row += con->scroll_top;
+	if(row>=con->con_rows) row -= con->con_rows;
+	return row;
+}
+
+static inline void __console_mark_dirty(console_data_s *con,int row)
+{
+	con->dirty[row>>5] |= (0x80000000>>(row&31));
+}
+
+static inline void __console_mark_all_dirty(console_data_s *con)
+{
+	memset(con->dirty,0xff,sizeof(con->dirty));
+}
+
+static void __console_init_glyph_mask(void)
+{
+	int i,j;
+	unsigned int mask;
+
+	if(_console_glyph_mask_init) return;
+
+	for(i=0;i<256;i++) {
+		for(j=0;j<FONT_XSIZE/2;j++) {
+			mask = 0;
+			if(i&(0x80>>(j*2))) mask |= 0xFFFF00FF;
+			if(i&(0x40>>(j*2))) mask |= 0x0000FF00;
+			_console_glyph_mask[i][j] = mask;
+		}
+	}
+	_console_glyph_mask_init = 1;
+}
+
+static void __console_alloc_cells(int cols,int rows)
+{
+	unsigned short *cells;
+
+	cells = realloc(_console_cells,cols*rows*sizeof(unsigned short));
+	if(!cells) {
+		free(_console_cells);
+		_console_cells = NULL;
+		return;
+	}
+	_console_cells = cells;
+}
+
 void __console_vipostcb(u32 retraceCnt)
 {
-	u32 ycnt,xcnt, fb_stride;
+	int row,line,last;
+	u32 xcnt,fb_stride,src_stride;
 	u32 *fb,*ptr;
+	void *xfb;
+	console_data_s *con;
+	unsigned int dirty[CONSOLE_MAX_ROWS/32];
+
+	if(!(con = curr_con)) return;
 
 	do_xfb_copy = TRUE;
 
-	ptr = curr_con->destbuffer;
-	fb = VIDEO_GetCurrentFramebuffer()+(curr_con->target_y*curr_con->tgt_stride) + curr_con->target_x*VI_DISPLAY_PIX_SZ;
+	// unless the application promised not to draw over the console, the XFB
+	// may have been overwritten since the last retrace
+	xfb = VIDEO_GetCurrentFramebuffer();
+	if(xfb!=con->last_xfb || !_console_dirty_copy) {
+		con->last_xfb = xfb;
+		__console_mark_all_dirty(con);
+	}
+	memcpy(dirty,con->dirty,sizeof(dirty));
+	memset(con->dirty,0,sizeof(con->dirty));
+
 	fb_stride = curr_con->tgt_stride/4 - (curr_con->con_xres/VI_DISPLAY_PIX_SZ);
+	src_stride = curr_con->con_stride/4 - (curr_con->con_xres/VI_DISPLAY_PIX_SZ);
 
-	for(ycnt=curr_con->con_yres;ycnt>0;ycnt--)
-	{
-		for(xcnt=curr_con->con_xres;xcnt>0;xcnt-=VI_DISPLAY_PIX_SZ)
-		{
-			*fb++ = *ptr++;
+	// the lines below the last text row are carried along with it
+	for(row=0;row<con->con_rows;row++) {
+		if(!(dirty[row>>5]&(0x80000000>>(row&31)))) continue;
+
+		last = (row==con->con_rows-1);
+		ptr = (u32*)(con->destbuffer + con->con_stride*__console_phys_row(con,row)*FONT_YSIZE);
+		fb = xfb + ((con->target_y + row*FONT_YSIZE)*con->tgt_stride) + con->target_x*VI_DISPLAY_PIX_SZ;
+
+		for(line=0;line<FONT_YSIZE;line++) {
+			for(xcnt=con->con_xres;xcnt>0;xcnt-=VI_DISPLAY_PIX_SZ)
+				*fb++ = *ptr++;
+			fb += fb_stride;
+			ptr += src_stride;
+		}
+
+		if(last) {
+			ptr = (u32*)(con->destbuffer + con->con_stride*con->con_rows*FONT_YSIZE);
+			for(line=con->con_rows*FONT_YSIZE;line<con->con_yres;line++) {
+				for(xcnt=con->con_xres;xcnt>0;xcnt-=VI_DISPLAY_PIX_SZ)
+					*fb++ = *ptr++;
+				fb += fb_stride;
+				ptr += src_stride;
+			}
 		}
-		fb += fb_stride;
 	}
 
 	do_xfb_copy = FALSE;
@@ -113,80 +200,51 @@ void __console_vipostcb(u32 retraceCnt)
 static void __console_drawc(int c)
 {
 	console_data_s *con;
-	int ay;
+	int ay,row;
 	unsigned int *ptr;
 	unsigned char *pbits;
-	unsigned char bits;
-	unsigned int color;
+	const unsigned int *mask;
 	unsigned int fgcolor, bgcolor;
 	unsigned int nextline;
+	unsigned short cell;
 
 	if(do_xfb_copy==TRUE) return;
 	if(!curr_con) return;
 	con = curr_con;
 
-	ptr = (unsigned int*)(con->destbuffer + ( con->con_stride *  con->cursor_row * FONT_YSIZE ) + ((con->cursor_col * FONT_XSIZE / 2) * 4));
+	if(con->cursor_col>=con->con_cols) return;
+
+	c &= 0xff;
+	row = __console_phys_row(con,con->cursor_row);
+	if(con->cells) {
+		// nothing to redraw if the cell already holds this glyph and colors;
+		// only the buffered console owns its pixels, the application may
+		// clear or draw over the XFB behind the unbuffered one
+		cell = (con->attr<<8)|c;
+		if(con->buffered && con->cells[row*con->con_cols + con->cursor_col]==cell) return;
+		con->cells[row*con->con_cols + con->cursor_col] = cell;
+	}
+
+	ptr = (unsigned int*)(con->destbuffer + ( con->con_stride *  row * FONT_YSIZE ) + ((con->cursor_col * FONT_XSIZE / 2) * 4));
 	pbits = &con->font[c * FONT_YSIZE];
-	nextline = con->con_stride/4 - 4;
+	nextline = con->con_stride/4 - FONT_XSIZE/2;
 	fgcolor = con->foreground;
 	bgcolor = con->background;
 
 	for (ay = 0; ay < FONT_YSIZE; ay++)
 	{
-		/* hard coded loop unrolling ! */
 		/* this depends on FONT_XSIZE = 8*/
-#if FONT_XSIZE == 8
-		bits = *pbits++;
-
-		/* bits 1 & 2 */
-		if ( bits & 0x80)
-			color = fgcolor & 0xFFFF00FF;
-		else
-			color = bgcolor & 0xFFFF00FF;
-		if (bits & 0x40)
-			color |= fgcolor  & 0x0000FF00;
-		else
-			color |= bgcolor  & 0x0000FF00;
-		*ptr++ = color;
-
-		/* bits 3 & 4 */
-		if ( bits & 0x20)
-			color = fgcolor & 0xFFFF00FF;
-		else
-			color = bgcolor & 0xFFFF00FF;
-		if (bits & 0x10)
-			color |= fgcolor  & 0x0000FF00;
-		else
-			color |= bgcolor  & 0x0000FF00;
-		*ptr++ = color;
-
-		/* bits 5 & 6 */
-		if ( bits & 0x08)
-			color = fgcolor & 0xFFFF00FF;
-		else
-			color = bgcolor & 0xFFFF00FF;
-		if (bits & 0x04)
-			color |= fgcolor  & 0x0000FF00;
-		else
-			color |= bgcolor  & 0x0000FF00;
-		*ptr++ = color;
-
-		/* bits 7 & 8 */
-		if ( bits & 0x02)
-			color = fgcolor & 0xFFFF00FF;
-		else
-			color = bgcolor & 0xFFFF00FF;
-		if (bits & 0x01)
-			color |= fgcolor  & 0x0000FF00;
-		else
-			color |= bgcolor  & 0x0000FF00;
-		*ptr++ = color;
+		mask = _console_glyph_mask[*pbits++];
+		ptr[0] = (fgcolor&mask[0])|(bgcolor&~mask[0]);
+		ptr[1] = (fgcolor&mask[1])|(bgcolor&~mask[1]);
+		ptr[2] = (fgcolor&mask[2])|(bgcolor&~mask[2]);
+		ptr[3] = (fgcolor&mask[3])|(bgcolor&~mask[3]);
 
 		/* next line */
-		ptr += nextline;
-#else
-#endif
+		ptr += FONT_XSIZE/2 + nextline;
 	}
+
+	__console_mark_dirty(con,con->cursor_row);
 }
 static void __console_clear_line( int line, int from, int to ) {
 	console_data_s *con;
@@ -196,16 +254,26 @@ static void __console_clear_line( int line, int from, int to ) {
 	unsigned int px_per_col = FONT_XSIZE/2;
 	unsigned int line_height = FONT_YSIZE;
 	unsigned int line_width;
+	unsigned short cell;
+	int row,col;
 	
 	if( !(con = curr_con) ) return;
-	// For some reason there are xres/2 pixels per screen width
-  x_pixels = con->con_xres / 2;
+	if( line<0 || line>=con->con_rows || from>=to ) return;
+
+	x_pixels = con->con_stride / 4;
+	row = __console_phys_row(con,line);
+
+	if(con->cells) {
+		cell = (con->attr<<8)|' ';
+		for(col=from;col<to;col++)
+			con->cells[row*con->con_cols + col] = cell;
+	}
 	
 	line_width = (to - from)*px_per_col;
 	p = (unsigned int*)con->destbuffer;
 	
 	// Move pointer to the current line and column offset
-	p += line*(FONT_YSIZE*x_pixels) + from*px_per_col;
+	p += row*(FONT_YSIZE*x_pixels) + from*px_per_col;
 	
 	// Clears 1 line of pixels at a time, line_height times
   while( line_height-- ) {
@@ -215,25 +283,36 @@ static void __console_clear_line( int line, int from, int to ) {
     p -= line_width;
     p += x_pixels;
   }
+
+	__console_mark_dirty(con,line);
 }
 static void __console_clear(void)
 {
 	console_data_s *con;
 	unsigned int c;
 	unsigned int *p;
+	unsigned short cell;
 
 	if( !(con = curr_con) ) return;
 
-	c = (con->con_xres*con->con_yres)/2;
+	c = (con->con_stride*con->con_yres)/4;
 	p = (unsigned int*)con->destbuffer;
 	
 	while(c--)
 		*p++ = con->background;
 
+	if(con->cells) {
+		cell = (con->attr<<8)|' ';
+		for(c=0;c<con->con_cols*con->con_rows;c++)
+			con->cells[c] = cell;
+	}
+
 	con->cursor_row = 0;
 	con->cursor_col = 0;
 	con->saved_row = 0;
 	con->saved_col = 0;
+	con->scroll_top = 0;
+	__console_mark_all_dirty(con);
 }
 static void __console_clear_from_cursor(void) {
 	console_data_s *con;
@@ -244,7 +323,7 @@ static void __console_clear_from_cursor(void) {
 	
   __console_clear_line( cur_row, con->cursor_col, con->con_cols );
   
-  while( cur_row++ < con->con_rows )
+  while( ++cur_row < con->con_rows )
     __console_clear_line( cur_row, 0, con->con_cols );
   
 }
@@ -261,10 +340,38 @@ static void __console_clear_to_cursor(void) {
     __console_clear_line( cur_row, 0, con->con_cols );
 }
 
+static void __console_scroll(void)
+{
+	unsigned int level;
+	console_data_s *con = curr_con;
+
+	if(con->buffered) {
+		// the backing store is a ring of text rows; the retrace callback
+		// unrolls it, so scrolling only moves the top row index
+		_CPU_ISR_Disable(level);
+		con->scroll_top = __console_phys_row(con,1);
+		__console_mark_all_dirty(con);
+		_CPU_ISR_Restore(level);
+	} else {
+		memmove(con->destbuffer,
+			con->destbuffer+con->con_stride*FONT_YSIZE,
+			con->con_stride*FONT_YSIZE*(con->con_rows-1));
+		if(con->cells)
+			memmove(con->cells,con->cells+con->con_cols,con->con_cols*(con->con_rows-1)*sizeof(unsigned short));
+	}
+	__console_clear_line(con->con_rows-1,0,con->con_cols);
+}
+
 void __console_init(void *framebuffer,int xstart,int ystart,int xres,int yres,int stride)
 {
 	unsigned int level;
 	console_data_s *con = &_console_data;
+	int rows = yres / FONT_YSIZE;
+
+	if(rows>CONSOLE_MAX_ROWS) rows = CONSOLE_MAX_ROWS;
+
+	__console_init_glyph_mask();
+	__console_alloc_cells(xres / FONT_XSIZE,rows);
 
 	_CPU_ISR_Disable(level);
 
@@ -272,7 +379,7 @@ void __console_init(void *framebuffer,int xstart,int ystart,int xres,int yres,in
 	con->con_xres = xres;
 	con->con_yres = yres;
 	con->con_cols = xres / FONT_XSIZE;
-	con->con_rows = yres / FONT_YSIZE;
+	con->con_rows = rows;
 	con->con_stride = con->tgt_stride = stride;
 	con->target_x = xstart;
 	con->target_y = ystart;
@@ -281,6 +388,11 @@ void __console_init(void *framebuffer,int xstart,int ystart,int xres,int yres,in
 
 	con->foreground = COLOR_WHITE;
 	con->background = COLOR_BLACK;
+	con->attr = CONSOLE_ATTR_DEFAULT;
+
+	con->cells = _console_cells;
+	con->buffered = 0;
+	con->last_xfb = NULL;
 
 	curr_con = con;
 
@@ -299,6 +411,12 @@ void __console_init_ex(void *conbuffer,int tgt_xstart,int tgt_ystart,int tgt_str
 {
 	unsigned int level;
 	console_data_s *con = &_console_data;
+	int rows = con_yres / FONT_YSIZE;
+
+	if(rows>CONSOLE_MAX_ROWS) rows = CONSOLE_MAX_ROWS;
+
+	__console_init_glyph_mask();
+	__console_alloc_cells(con_xres / FONT_XSIZE,rows);
 
 	_CPU_ISR_Disable(level);
 
@@ -310,7 +428,7 @@ void __console_init_ex(void *conbuffer,int tgt_xstart,int tgt_ystart,int tgt_str
 	con->tgt_stride = tgt_stride;
 	con->con_stride = con_stride;
 	con->con_cols = con_xres / FONT_XSIZE;
-	con->con_rows = con_yres / FONT_YSIZE;
+	con->con_rows = rows;
 	con->cursor_row = 0;
 	con->cursor_col = 0;
 	con->saved_row = 0;
@@ -320,6 +438,11 @@ void __console_init_ex(void *conbuffer,int tgt_xstart,int tgt_ystart,int tgt_str
 
 	con->foreground = COLOR_WHITE;
 	con->background = COLOR_BLACK;
+	con->attr = CONSOLE_ATTR_DEFAULT;
+
+	con->cells = _console_cells;
+	con->buffered = 1;
+	con->last_xfb = NULL;
 
 	curr_con = con;
 
@@ -490,6 +613,7 @@ static int __console_parse_escsequence(const char *pchr)
 					parameters[0] += 8;
 				}
 				con->foreground = color_table[parameters[0]];
+				con->attr = (con->attr&0x0f)|(parameters[0]<<4);
 			}
 			// handle 40-47 for background color changes
 			else if( (parameters[0] >= 40) && (parameters[0] <= 47) )
@@ -502,6 +626,7 @@ static int __console_parse_escsequence(const char *pchr)
 					parameters[0] += 8;
 				}
 				con->background = color_table[parameters[0]];
+				con->attr = (con->attr&0xf0)|parameters[0];
 			}
 		  break;
 		}
@@ -578,14 +703,7 @@ ssize_t __console_write(struct _reent *r,void *fd,const char *ptr,size_t len)
 		if( con->cursor_row >= con->con_rows)
 		{
 			/* if bottom border reached scroll */
-			memcpy(con->destbuffer,
-				con->destbuffer+con->con_stride*(FONT_YSIZE*FONT_YFACTOR+FONT_YGAP),
-				con->con_stride*con->con_yres-FONT_YSIZE);
-
-			unsigned int cnt = (con->con_stride * (FONT_YSIZE * FONT_YFACTOR + FONT_YGAP))/4;
-			unsigned int *ptr = (unsigned int*)(con->destbuffer + con->con_stride * (con->con_yres - FONT_YSIZE));
-			while(cnt--)
-				*ptr++ = con->background;
+			__console_scroll();
 			con->cursor_row--;
 		}
 	}
@@ -677,6 +795,11 @@ static int __gecko_close(void *c)
 	return 0;
 }
 
+void CON_EnableDirtyCopy(bool enable)
+{
+	_console_dirty_copy = enable;
+}
+
 void CON_EnableGecko(s32 chan,bool safe)
 {
 	if(chan<0 && __gecko_chan==-1) return;
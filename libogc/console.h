@@ -9,6 +9,8 @@
 #define FONT_XGAP			0
 #define FONT_YGAP			0
 #define TAB_SIZE			4
+#define CONSOLE_MAX_ROWS	64
+#define CONSOLE_ATTR_DEFAULT	0xf0		// bright white on black
 
 typedef struct _console_data_s {
 	void *destbuffer;
@@ -20,6 +22,13 @@ typedef struct _console_data_s {
 	int con_rows, con_cols;
 
 	unsigned int foreground,background;
+
+	unsigned short *cells;
+	unsigned char attr;
+	int buffered;
+	int scroll_top;
+	void *last_xfb;
+	unsigned int dirty[CONSOLE_MAX_ROWS/32];
 } console_data_s;
 
 extern ssize_t __console_write(struct _reent *r,void *fd,const char *ptr,size_t len);
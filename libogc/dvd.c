@@ -70,6 +70,7 @@ distribution.
 #define DVD_DISKIDSIZE					0x20
 #define DVD_DRVINFSIZE					0x20
 #define DVD_GCODE_BLKSIZE				0x200
+#define DVD_SCHED_MERGEMAX				0x80000
 
 #define DVD_INQUIRY						0x12000000
 #define DVD_FWSETOFFSET					0x32000000
@@ -205,6 +206,7 @@ static dvdcallbacklow __dvd_finaladdoncb = NULL;
 static dvdcallbacklow __dvd_finalpatchcb = NULL;
 static dvdcallbacklow __dvd_finaloffsetcb = NULL;
 static dvdcbcallback __dvd_cancelcallback = NULL;
+static dvdcmdblk *__dvd_cancelblock = NULL;
 static dvdcbcallback __dvd_mountusrcb = NULL;
 static dvdstatecb __dvd_laststate = NULL;
 static dvdcmdblk *__dvd_executing = NULL;
@@ -212,6 +214,13 @@ static void *__dvd_usrdata = NULL;
 static dvddiskid *__dvd_diskID = (dvddiskid*)0x80000000;
 
 static lwp_queue __dvd_waitingqueue[4];
+static lwp_queue __dvd_mergequeue;
+static lwp_queue *__dvd_mergefrom = NULL;
+static dvdcmdblk *__dvd_mergecancel = NULL;
+static dvdcmdblk __dvd_mergecmdblk;
+static u32 __dvd_schedmode = DVD_SCHED_FIFO;
+static u32 __dvd_scheddeadline = 0;
+static s64 __dvd_headpos = 0;
 static dvdcmdl __dvd_cmdlist[4];
 static dvdcmds __dvd_cmd_curr,__dvd_cmd_prev;
 
@@ -489,6 +498,138 @@ static dvdcmdblk* __dvd_popwaitingqueue(void)
 	return NULL;
 }
 
+static __inline__ s32 __dvd_isread(dvdcmdblk *block)
+{
+	return (block->cmd==0x0001 || block->cmd==0x0004);
+}
+
+/* completes the requests that were folded into one merged read. when only
+ * one of them was canceled, the others that didn't get all their data yet go
+ * back to the head of the queue they came from.
+ */
+static void __dvd_mergecb(s32 result,dvdcmdblk *block)
+{
+	u32 done;
+	dvdcmdblk *member,*cancel;
+	lwp_node *requeue = NULL;
+
+	cancel = __dvd_mergecancel;
+	__dvd_mergecancel = NULL;
+
+	done = block->txdsize;
+	while((member=(dvdcmdblk*)__lwp_queue_getI(&__dvd_mergequeue))) {
+		if(result==DVD_ERROR_CANCELED && cancel) {
+			if(member==cancel) {
+				done -= (done>member->len) ? member->len : done;
+				member->state = DVD_STATE_CANCELED;
+				if(member->cb) member->cb(result,member);
+				continue;
+			}
+			if(done<member->len) {
+				done = 0;
+				member->state = DVD_STATE_WAITING;
+				member->txdsize = 0;
+				if(requeue) __lwp_queue_insertI(requeue,&member->node);
+				else __lwp_queue_prependI(__dvd_mergefrom,&member->node);
+				requeue = &member->node;
+				continue;
+			}
+		} else if(result<0) {
+			member->state = block->state;
+			if(member->cb) member->cb(result,member);
+			continue;
+		}
+
+		member->txdsize = (done>member->len) ? member->len : done;
+		done -= member->txdsize;
+		member->state = DVD_STATE_END;
+		if(member->cb) member->cb(member->txdsize,member);
+	}
+}
+
+static dvdcmdblk* __dvd_mergereads(lwp_queue *queue,dvdcmdblk *first)
+{
+	u32 len;
+	dvdcmdblk *block;
+
+	len = first->len;
+	while(len<DVD_SCHED_MERGEMAX) {
+		block = (dvdcmdblk*)queue->first;
+		while(block!=(dvdcmdblk*)__lwp_queue_tail(queue) && __dvd_isread(block)) {
+			if(block->cmd==first->cmd && block->offset==(first->offset + len)
+				&& block->buf==(first->buf + len) && (len + block->len)<=DVD_SCHED_MERGEMAX) break;
+			block = (dvdcmdblk*)block->node.next;
+		}
+		if(block==(dvdcmdblk*)__lwp_queue_tail(queue) || !__dvd_isread(block)) break;
+
+		if(len==first->len) {
+			__dvd_mergefrom = queue;
+			__dvd_mergecancel = NULL;
+			__lwp_queue_init_empty(&__dvd_mergequeue);
+			__lwp_queue_appendI(&__dvd_mergequeue,&first->node);
+			first->state = DVD_STATE_BUSY;
+		}
+		__lwp_queue_extractI(&block->node);
+		__lwp_queue_appendI(&__dvd_mergequeue,&block->node);
+		block->state = DVD_STATE_BUSY;
+		len += block->len;
+	}
+	if(len==first->len) return first;
+
+	__dvd_mergecmdblk.cmd = first->cmd;
+	__dvd_mergecmdblk.buf = first->buf;
+	__dvd_mergecmdblk.offset = first->offset;
+	__dvd_mergecmdblk.len = len;
+	__dvd_mergecmdblk.txdsize = 0;
+	__dvd_mergecmdblk.cb = __dvd_mergecb;
+	return &__dvd_mergecmdblk;
+}
+
+/* C-SCAN over the reads queued ahead of the first non-read command of the
+ * highest priority level. other commands keep their place in the queue.
+ */
+static dvdcmdblk* __dvd_schedwaitingqueue(void)
+{
+	u32 i,level;
+	lwp_queue *queue;
+	dvdcmdblk *block,*best,*lowest;
+
+	_CPU_ISR_Disable(level);
+	for(i=0;i<4;i++) {
+		if(!__lwp_queue_isempty(&__dvd_waitingqueue[i])) break;
+	}
+	if(i>=4) {
+		_CPU_ISR_Restore(level);
+		return NULL;
+	}
+
+	queue = &__dvd_waitingqueue[i];
+	block = (dvdcmdblk*)queue->first;
+	if(__dvd_schedmode!=DVD_SCHED_CSCAN || !__dvd_isread(block)) {
+		block = __dvd_popwaitingqueueprio(i);
+		_CPU_ISR_Restore(level);
+		return block;
+	}
+
+	// the queue is in arrival order, so its head is always the oldest request
+	if(__dvd_scheddeadline && (s32)(gettick() - block->deadline)>=0) best = block;
+	else {
+		best = lowest = NULL;
+		while(block!=(dvdcmdblk*)__lwp_queue_tail(queue) && __dvd_isread(block)) {
+			if(block->offset>=__dvd_headpos && (!best || block->offset<best->offset)) best = block;
+			if(!lowest || block->offset<lowest->offset) lowest = block;
+			block = (dvdcmdblk*)block->node.next;
+		}
+		if(!best) best = lowest;
+	}
+
+	__lwp_queue_extractI(&best->node);
+	block = __dvd_mergereads(queue,best);
+	__dvd_headpos = block->offset + block->len;
+	_CPU_ISR_Restore(level);
+	return block;
+}
+
 static void __dvd_timeouthandler(syswd_t alarm,void *cbarg)
 {
 	dvdcallbacklow cb;
@@ -644,7 +785,7 @@ static s32 __dvd_checkcancel(u32 cancelpt)
 
 		block->state = DVD_STATE_CANCELED;
 		if(block->cb) block->cb(DVD_ERROR_CANCELED,block);
-		if(__dvd_cancelcallback) __dvd_cancelcallback(DVD_ERROR_OK,block);
+		if(__dvd_cancelcallback) __dvd_cancelcallback(DVD_ERROR_OK,__dvd_cancelblock);
 
 		__dvd_stateready();
 		return 1;
@@ -720,7 +861,7 @@ static void __dvd_stateerrorcb(s32 result)
 	if(block->cb) block->cb(DVD_ERROR_FATAL,block);
 	if(__dvd_canceling) {
 		__dvd_canceling = 0;
-		if(__dvd_cancelcallback) __dvd_cancelcallback(DVD_ERROR_OK,block);
+		if(__dvd_cancelcallback) __dvd_cancelcallback(DVD_ERROR_OK,__dvd_cancelblock);
 	}
 	__dvd_stateready();
 }
@@ -846,7 +987,7 @@ static void __dvd_statebusycb(s32 result)
 		__dvd_executing = &__dvd_dummycmdblk;
 		block->state = DVD_STATE_CANCELED;
 		if(block->cb) block->cb(DVD_ERROR_CANCELED,block);
-		if(__dvd_cancelcallback) __dvd_cancelcallback(DVD_ERROR_OK,block);
+		if(__dvd_cancelcallback) __dvd_cancelcallback(DVD_ERROR_OK,__dvd_cancelblock);
 		__dvd_stateready();
 		return;
 	}
@@ -1654,7 +1795,7 @@ static void __dvd_stateready(void)
 		return;
 	}
 
-	__dvd_executing = __dvd_popwaitingqueue();
+	__dvd_executing = __dvd_schedwaitingqueue();
 
 	if(__dvd_fatalerror) {
 		__dvd_executing->state = DVD_STATE_FATAL_ERROR;
@@ -1838,6 +1979,7 @@ static s32 __issuecommand(s32 prio,dvdcmdblk *block)
 
 	_CPU_ISR_Disable(level);
 	block->state = DVD_STATE_WAITING;
+	block->deadline = gettick() + __dvd_scheddeadline;
 	ret = __dvd_pushwaitingqueue(prio,block);
 	if(!__dvd_executing && !__dvd_pauseflag) __dvd_stateready();
 	_CPU_ISR_Restore(level);
@@ -2668,6 +2810,12 @@ s32 DVD_CancelAsync(dvdcmdblk *block,dvdcbcallback cb)
 			}
 			__dvd_canceling = 1;
 			__dvd_cancelcallback = cb;
+			__dvd_cancelblock = block;
+			// the merged read is broken off; only the request canceled fails
+			if(__dvd_executing==&__dvd_mergecmdblk) {
+				if(block!=&__dvd_mergecmdblk) __dvd_mergecancel = block;
+				else __dvd_cancelblock = (dvdcmdblk*)__dvd_mergequeue.first;
+			}
 			if(__dvd_currcmd==0x0001 || __dvd_currcmd==0x0004) DVD_LowBreak();
 			break;
 		case DVD_STATE_WAITING:
@@ -2688,6 +2836,7 @@ s32 DVD_CancelAsync(dvdcmdblk *block,dvdcbcallback cb)
 			}
 			__dvd_canceling = 1;
 			__dvd_cancelcallback = cb;
+			__dvd_cancelblock = block;
 			break;
 		case DVD_STATE_NO_DISK:
 		case DVD_STATE_COVER_OPEN:
@@ -3531,6 +3680,16 @@ u32 DVD_SetAutoInvalidation(u32 auto_inv)
 	return ret;
 }
 
+void DVD_SetScheduler(u32 mode,u32 deadline)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	__dvd_schedmode = mode;
+	__dvd_scheddeadline = millisecs_to_ticks(deadline);
+	_CPU_ISR_Restore(level);
+}
+
 static bool __gcdvd_Startup(DISC_INTERFACE *disc)
 {
 	DVD_Init();
@@ -687,6 +687,17 @@ void c_guMtxConcat(const Mtx a,const Mtx b,Mtx ab)
 		c_guMtxCopy(tmp,ab);
 }
 
+void c_guMtxConcatArray(const Mtx a,const Mtx *srcBase,Mtx *dstBase,u32 count)
+{
+	u32 i;
+	Mtx tmp;
+
+	// copy a once so that dstBase may overlap it
+	c_guMtxCopy(a,tmp);
+	for(i=0;i<count;i++)
+		c_guMtxConcat(tmp,srcBase[i],dstBase[i]);
+}
+
 void c_guMtxScale(Mtx mt,f32 xS,f32 yS,f32 zS)
 {
     mt[0][0] = xS;    mt[0][1] = 0.0f;  mt[0][2] = 0.0f;  mt[0][3] = 0.0f;
@@ -986,6 +997,46 @@ f32 c_guVecDotProduct(const guVector *a,const guVector *b)
     return dot;
 }
 
+void c_guVecMultiplyArray(const Mtx mt,const guVector *srcBase,guVector *dstBase,u32 count)
+{
+	u32 i;
+	f32 x,y,z;
+
+	for(i=0;i<count;i++) {
+		x = srcBase[i].x;
+		y = srcBase[i].y;
+		z = srcBase[i].z;
+
+		dstBase[i].x = mt[0][0]*x + mt[0][1]*y + mt[0][2]*z + mt[0][3];
+		dstBase[i].y = mt[1][0]*x + mt[1][1]*y + mt[1][2]*z + mt[1][3];
+		dstBase[i].z = mt[2][0]*x + mt[2][1]*y + mt[2][2]*z + mt[2][3];
+	}
+}
+
+void c_guVecMultiplySRArray(const Mtx mt,const guVector *srcBase,guVector *dstBase,u32 count)
+{
+	u32 i;
+	f32 x,y,z;
+
+	for(i=0;i<count;i++) {
+		x = srcBase[i].x;
+		y = srcBase[i].y;
+		z = srcBase[i].z;
+
+		dstBase[i].x = mt[0][0]*x + mt[0][1]*y + mt[0][2]*z;
+		dstBase[i].y = mt[1][0]*x + mt[1][1]*y + mt[1][2]*z;
+		dstBase[i].z = mt[2][0]*x + mt[2][1]*y + mt[2][2]*z;
+	}
+}
+
+void c_guVecNormalizeArray(const guVector *srcBase,guVector *dstBase,u32 count)
+{
+	u32 i;
+
+	for(i=0;i<count;i++)
+		c_guVecNormalize(&srcBase[i],&dstBase[i]);
+}
+
 void c_guQuatAdd(const guQuaternion *a,const guQuaternion *b,guQuaternion *ab)
 {
 	ab->x = a->x + b->x;
@@ -4,6 +4,7 @@
 #include <math.h>
 #include "asm.h"
 #include "processor.h"
+#include "cache.h"
 #include "irq.h"
 #include "lwp.h"
 #include "system.h"
@@ -24,34 +25,46 @@
 
 #define GX_LOAD_BP_REG(x)				\
 	do {								\
-		wgPipe->U8 = 0x61;				\
-		asm volatile ("" ::: "memory" ); \
-		wgPipe->U32 = (u32)(x);		\
-		asm volatile ("" ::: "memory" ); \
+		u32 _bpval = (u32)(x);			\
+		if(!_gxwfactive || __GX_FilterBP(_bpval)) { \
+			wgPipe->U8 = 0x61;				\
+			asm volatile ("" ::: "memory" ); \
+			wgPipe->U32 = _bpval;		\
+			asm volatile ("" ::: "memory" ); \
+		}								\
 	} while(0)
 
 #define GX_LOAD_CP_REG(x, y)			\
 	do {								\
-		wgPipe->U8 = 0x08;				\
-		asm volatile ("" ::: "memory" ); \
-		wgPipe->U8 = (u8)(x);			\
-		asm volatile ("" ::: "memory" ); \
-		wgPipe->U32 = (u32)(y);		\
-		asm volatile ("" ::: "memory" ); \
+		u32 _cpreg = (u8)(x);			\
+		u32 _cpval = (u32)(y);			\
+		if(!_gxwfactive || __GX_FilterCP(_cpreg,_cpval)) { \
+			wgPipe->U8 = 0x08;				\
+			asm volatile ("" ::: "memory" ); \
+			wgPipe->U8 = _cpreg;			\
+			asm volatile ("" ::: "memory" ); \
+			wgPipe->U32 = _cpval;		\
+			asm volatile ("" ::: "memory" ); \
+		}								\
 	} while(0)
 
 #define GX_LOAD_XF_REG(x, y)			\
 	do {								\
-		wgPipe->U8 = 0x10;				\
-		asm volatile ("" ::: "memory" ); \
-		wgPipe->U32 = (u32)((x)&0xffff);		\
-		asm volatile ("" ::: "memory" ); \
-		wgPipe->U32 = (u32)(y);		\
-		asm volatile ("" ::: "memory" ); \
+		u32 _xfreg = (u32)((x)&0xffff);	\
+		u32 _xfval = (u32)(y);			\
+		if(!_gxwfactive || __GX_FilterXF(_xfreg,_xfval)) { \
+			wgPipe->U8 = 0x10;				\
+			asm volatile ("" ::: "memory" ); \
+			wgPipe->U32 = _xfreg;		\
+			asm volatile ("" ::: "memory" ); \
+			wgPipe->U32 = _xfval;		\
+			asm volatile ("" ::: "memory" ); \
+		}								\
 	} while(0)
 
 #define GX_LOAD_XF_REGS(x, n)			\
 	do {								\
+		if(_gxwfactive) __GX_FilterXFRange(((x)&0xffff),((n)&0xffff)); \
 		wgPipe->U8 = 0x10;				\
 		asm volatile ("" ::: "memory" ); \
 		wgPipe->U32 = (u32)(((((n)&0xffff)-1)<<16)|((x)&0xffff));				\
@@ -126,6 +139,124 @@ static u8 _gx_saved_data[STRUCT_REGDEF_SIZE] ATTRIBUTE_ALIGN(32);
 
 static s32 __gx_onreset(s32 final);
 
+/* redundant write filter. the last value loaded into each BP, CP and XF
+ * register (0x1000-0x10ff) is remembered, so a load of the same value
+ * again can be dropped. only BP registers in __gx_bpstateregs are
+ * filtered; the TEV color registers are handled in __GX_SetTevRegs.
+ */
+static u32 _gxwfenabled = 0;
+static u32 _gxwfactive = 0;
+static u32 _gxwfredirected = 0;
+static u32 _gxwfbpmask = 0x00ffffff;
+static u32 _gxwfbp[256];
+static u32 _gxwfcp[256];
+static u32 _gxwfxf[256];
+static u32 _gxwfbpvalid[8];
+static u32 _gxwfcpvalid[8];
+static u32 _gxwfxfvalid[8];
+static GXWriteStats _gxwfstats;
+
+static __inline__ u32 __GX_IsBPCached(u32 val)
+{
+	u32 reg = _SHIFTR(val,24,8);
+	return ((_gxwfbpvalid[reg>>5]&(1<<(reg&0x1f))) && _gxwfbp[reg]==val);
+}
+
+static __inline__ void __GX_CacheBP(u32 val)
+{
+	u32 reg = _SHIFTR(val,24,8);
+	_gxwfbp[reg] = val;
+	_gxwfbpvalid[reg>>5] |= (1<<(reg&0x1f));
+}
+
+static __inline__ void __GX_ForgetBP(u32 reg)
+{
+	_gxwfbpvalid[reg>>5] &= ~(1<<(reg&0x1f));
+}
+
+static u32 __GX_FilterBP(u32 val)
+{
+	u32 mask,reg = _SHIFTR(val,24,8);
+	u32 bit = (1<<(reg&0x1f));
+
+	if(reg==0xfe) _gxwfbpmask = (val&0x00ffffff);
+	else {
+		mask = _gxwfbpmask;
+		_gxwfbpmask = 0x00ffffff;
+
+		if(!(__gx_bpstateregs[reg>>5]&bit)) _gxwfbpvalid[reg>>5] &= ~bit;
+		else if(mask!=0x00ffffff) {
+			// a load following a BP mask only replaces the bits under the mask
+			if(_gxwfbpvalid[reg>>5]&bit) _gxwfbp[reg] = (_gxwfbp[reg]&~mask)|(val&mask);
+		} else if(__GX_IsBPCached(val)) {
+			_gxwfstats.bpSuppressed++;
+			return 0;
+		} else __GX_CacheBP(val);
+	}
+	_gxwfstats.bpEmitted++;
+	return 1;
+}
+
+static u32 __GX_FilterCP(u32 reg,u32 val)
+{
+	u32 bit = (1<<(reg&0x1f));
+
+	if((_gxwfcpvalid[reg>>5]&bit) && _gxwfcp[reg]==val) {
+		_gxwfstats.cpSuppressed++;
+		return 0;
+	}
+	_gxwfcp[reg] = val;
+	_gxwfcpvalid[reg>>5] |= bit;
+	_gxwfstats.cpEmitted++;
+	return 1;
+}
+
+static u32 __GX_FilterXF(u32 reg,u32 val)
+{
+	u32 bit = (1<<(reg&0x1f));
+
+	if((reg&0xff00)==0x1000) {
+		reg &= 0xff;
+		if((_gxwfxfvalid[reg>>5]&bit) && _gxwfxf[reg]==val) {
+			_gxwfstats.xfSuppressed++;
+			return 0;
+		}
+		_gxwfxf[reg] = val;
+		_gxwfxfvalid[reg>>5] |= bit;
+	}
+	_gxwfstats.xfEmitted++;
+	return 1;
+}
+
+static void __GX_FilterXFRange(u32 reg,u32 cnt)
+{
+	u32 end = reg + cnt;
+
+	_gxwfstats.xfEmitted++;
+	if(end<=0x1000 || reg>=0x1100) return;
+
+	if(reg<0x1000) reg = 0x1000;
+	if(end>0x1100) end = 0x1100;
+	while(reg<end) {
+		_gxwfxfvalid[(reg>>5)&7] &= ~(1<<(reg&0x1f));
+		reg++;
+	}
+}
+
+static void __GX_InvalidateWriteFilter(void)
+{
+	_gxwfbpmask = 0x00ffffff;
+	memset(_gxwfbpvalid,0,sizeof(_gxwfbpvalid));
+	memset(_gxwfcpvalid,0,sizeof(_gxwfcpvalid));
+	memset(_gxwfxfvalid,0,sizeof(_gxwfxfvalid));
+}
+
+// loads going into a display list or a redirected pipe don't reach the GP
+static void __GX_UpdateWriteFilter(void)
+{
+	_gxwfactive = (_gxwfenabled && !__gx->gxFifoUnlinked && !_gxwfredirected);
+}
+
 static sys_resetinfo __gx_resetinfo = {
 	{},
 	__gx_onreset,
@@ -1050,6 +1181,135 @@ static void __GX_SetDirtyState(void)
 	__gx->dirtyState = 0;
 }
 
+/* FIFO capture. at each GX_Flush() the commands written to the CPU FIFO
+ * since the last one are copied into a ring of records, as are finished
+ * display lists. whenever data had to be dropped, the vertex descriptor
+ * and formats are recorded ahead of the next FIFO record so a decoder
+ * can keep sizing the vertices.
+ */
+static u8 *_gxcapbuf = NULL;
+static u32 _gxcapactive = 0;
+static u32 _gxcapsize = 0;
+static u32 _gxcaprd = 0;
+static u32 _gxcapwt = 0;
+static u32 _gxcapused = 0;
+static u32 _gxcaplost = 0;
+static u32 _gxcaplast = 0;
+static u32 _gxcapsync = 0;
+static u32 _gxcapstate[26];
+
+static u32 __GX_GetFifoWritePtr(void)
+{
+	u32 val;
+
+	while(!IsWriteGatherBufferEmpty());
+
+	val = _piReg[0x05];
+#if defined(HW_DOL)
+	return (u32)MEM_PHYSICAL_TO_K0((val&0x03FFFFE0));
+#else
+	return (u32)MEM_PHYSICAL_TO_K0((val&0x1FFFFFE0));
+#endif
+}
+
+static void __GX_CapturePut(const void *src,u32 len)
+{
+	u32 cnt;
+
+	while(len) {
+		cnt = _gxcapsize - _gxcapwt;
+		if(cnt>len) cnt = len;
+
+		memcpy(_gxcapbuf + _gxcapwt,src,cnt);
+		src = (const u8*)src + cnt;
+		_gxcapwt += cnt;
+		if(_gxcapwt==_gxcapsize) _gxcapwt = 0;
+		_gxcapused += cnt;
+		len -= cnt;
+	}
+}
+
+static void __GX_CaptureGet(void *dst,u32 len)
+{
+	u32 cnt;
+
+	while(len) {
+		cnt = _gxcapsize - _gxcaprd;
+		if(cnt>len) cnt = len;
+
+		memcpy(dst,_gxcapbuf + _gxcaprd,cnt);
+		dst = (u8*)dst + cnt;
+		_gxcaprd += cnt;
+		if(_gxcaprd==_gxcapsize) _gxcaprd = 0;
+		_gxcapused -= cnt;
+		len -= cnt;
+	}
+}
+
+static void __GX_CaptureSaveState(void)
+{
+	s32 i;
+
+	_gxcapstate[0] = __gx->vcdLo;
+	_gxcapstate[1] = __gx->vcdHi;
+	for(i=0;i<8;i++) {
+		_gxcapstate[2+i] = __gx->VAT0reg[i];
+		_gxcapstate[10+i] = __gx->VAT1reg[i];
+		_gxcapstate[18+i] = __gx->VAT2reg[i];
+	}
+	_gxcapsync = 1;
+}
+
+static void __GX_CaptureRecord(u32 type,const void *data0,u32 len0,const void *data1,u32 len1)
+{
+	u32 hdr,need,len = (len0 + len1);
+	static const u32 pad = 0;
+
+	need = 4 + ((len+3)&~3);
+	if(type==GX_CAPTURE_FIFO && _gxcapsync) need += 4 + sizeof(_gxcapstate);
+	if(need>(_gxcapsize - _gxcapused)) {
+		_gxcaplost += len;
+		if(type==GX_CAPTURE_FIFO) __GX_CaptureSaveState();
+		return;
+	}
+
+	if(type==GX_CAPTURE_FIFO && _gxcapsync) {
+		hdr = (_SHIFTL(GX_CAPTURE_VTXSTATE,24,8)|sizeof(_gxcapstate));
+		__GX_CapturePut(&hdr,4);
+		__GX_CapturePut(_gxcapstate,sizeof(_gxcapstate));
+		_gxcapsync = 0;
+	}
+
+	hdr = (_SHIFTL(type,24,8)|(len&0x00ffffff));
+	__GX_CapturePut(&hdr,4);
+	__GX_CapturePut(data0,len0);
+	if(len1) __GX_CapturePut(data1,len1);
+	if(len&3) __GX_CapturePut(&pad,(4 - (len&3)));
+}
+
+static void __GX_CaptureFifo(u32 wt_ptr)
+{
+	u32 start,end,last;
+	struct __gxfifo *cpufifo = (struct __gxfifo*)&_cpufifo;
+
+	last = _gxcaplast;
+	_gxcaplast = wt_ptr;
+
+	start = cpufifo->buf_start;
+	end = start + cpufifo->size;
+	if(wt_ptr==last || last<start || last>=end || wt_ptr<start || wt_ptr>=end) return;
+
+	// the GP FIFO is filled by the write gather pipe, bypassing the cache
+	if(wt_ptr>last) {
+		DCInvalidateRange((void*)last,(wt_ptr - last));
+		__GX_CaptureRecord(GX_CAPTURE_FIFO,(void*)last,(wt_ptr - last),NULL,0);
+	} else {
+		DCInvalidateRange((void*)last,(end - last));
+		DCInvalidateRange((void*)start,(wt_ptr - start));
+		__GX_CaptureRecord(GX_CAPTURE_FIFO,(void*)last,(end - last),(void*)start,(wt_ptr - start));
+	}
+}
+
 static u32 __GX_GetNumXfbLines(u16 efbHeight,u32 yscale)
 {
 	u32 tmp,tmp1;
@@ -1078,6 +1338,7 @@ GXFifoObj* GX_Init(void *base,u32 size)
 	SYS_RegisterResetFunc(&__gx_resetinfo);
 
 	memset(__gxregs,0,STRUCT_REGDEF_SIZE);
+	__GX_InvalidateWriteFilter();
 
 	__GX_FifoInit();
 	GX_InitFifoBase(&_gxfifoobj,base,size);
@@ -1105,6 +1366,7 @@ GXFifoObj* GX_Init(void *base,u32 size)
 
 	__gx->saveDLctx = 1;
 	__gx->gxFifoUnlinked = 0;
+	__GX_UpdateWriteFilter();
 
 	__gx->sciTLcorner = (__gx->sciTLcorner&~0xff000000)|(_SHIFTL(0x20,24,8));
 	__gx->sciBRcorner = (__gx->sciBRcorner&~0xff000000)|(_SHIFTL(0x21,24,8));
@@ -1262,6 +1524,7 @@ void GX_SetCPUFifo(const GXFifoObj *fifo)
 	struct __gxfifo *cpufifo = (struct __gxfifo*)&_cpufifo;
 
 	_CPU_ISR_Disable(level);
+	__GX_InvalidateWriteFilter();
 	if(!fifo) {
 		_gxcpufifoready = 0;
 		_cpgplinked = 0;
@@ -1282,6 +1545,7 @@ void GX_SetCPUFifo(const GXFifoObj *fifo)
 	cpufifo->fifo_wrap = ptr->fifo_wrap;
 	cpufifo->gpfifo_ready = ptr->gpfifo_ready;
 	cpufifo->cpufifo_ready = 1;
+	_gxcaplast = cpufifo->wt_ptr;
 
 	_gxcpufifoready = 1;
 	if(__GX_CPGPLinkCheck()) {
@@ -1347,6 +1611,7 @@ void GX_SetGPFifo(const GXFifoObj *fifo)
 	_CPU_ISR_Disable(level);
 	__GX_FifoReadDisable();
 	__GX_WriteFifoIntEnable(GX_DISABLE,GX_DISABLE);
+	__GX_InvalidateWriteFilter();
 
 	if(!fifo) {
 		_gxgpfifoready = 0;
@@ -1508,6 +1773,9 @@ volatile void* GX_RedirectWriteGatherPipe(void *ptr)
 	_piReg[5] = ((u32)ptr&0x1FFFFFE0);
 	ppcsync();
 
+	_gxwfredirected = 1;
+	__GX_UpdateWriteFilter();
+
 	_CPU_ISR_Restore(level);
 
 	return (volatile void*)0xCC008000;
@@ -1535,11 +1803,108 @@ void GX_RestoreWriteGatherPipe(void)
 		__GX_WriteFifoIntEnable(GX_ENABLE,GX_DISABLE);
 		__GX_FifoLink(GX_TRUE);
 	}
+
+	_gxwfredirected = 0;
+	__GX_UpdateWriteFilter();
+
+	_CPU_ISR_Restore(level);
+}
+
+void GX_SetWriteFilter(u8 enable)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	_gxwfenabled = enable;
+	__GX_InvalidateWriteFilter();
+	__GX_UpdateWriteFilter();
+	_CPU_ISR_Restore(level);
+}
+
+void GX_InvalidateWriteFilter(void)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	__GX_InvalidateWriteFilter();
+	_CPU_ISR_Restore(level);
+}
+
+void GX_GetWriteStats(GXWriteStats *stats)
+{
+	u32 level;
+
+	if(!stats) return;
+
+	_CPU_ISR_Disable(level);
+	*stats = _gxwfstats;
+	_CPU_ISR_Restore(level);
+}
+
+void GX_ClearWriteStats(void)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	memset(&_gxwfstats,0,sizeof(GXWriteStats));
+	_CPU_ISR_Restore(level);
+}
+
+void GX_StartCapture(void *buf,u32 size)
+{
+	u32 level;
+
+	GX_Flush();
+
+	_CPU_ISR_Disable(level);
+	_gxcapactive = 0;
+	_gxcapbuf = buf;
+	_gxcapsize = (size&~3);
+	_gxcaprd = 0;
+	_gxcapwt = 0;
+	_gxcapused = 0;
+	_gxcaplost = 0;
+	if(_gxcapbuf && _gxcapsize) {
+		_gxcaplast = __GX_GetFifoWritePtr();
+		__GX_CaptureSaveState();
+		_gxcapactive = 1;
+	}
+	_CPU_ISR_Restore(level);
+}
+
+void GX_StopCapture(void)
+{
+	GX_Flush();
+	_gxcapactive = 0;
+}
+
+u32 GX_ReadCapture(void *buf,u32 len)
+{
+	u32 level,hdr,size,ret = 0;
+
+	_CPU_ISR_Disable(level);
+	while(_gxcapused) {
+		hdr = *(u32*)(_gxcapbuf + _gxcaprd);
+		size = 4 + (((hdr&0x00ffffff)+3)&~3);
+		if(size>(len - ret)) break;
+
+		__GX_CaptureGet((u8*)buf + ret,size);
+		ret += size;
+	}
 	_CPU_ISR_Restore(level);
+
+	return ret;
+}
+
+u32 GX_GetCaptureLost(void)
+{
+	return _gxcaplost;
 }
 
 void GX_Flush(void)
 {
+	u32 level;
+
 	if(__gx->dirtyState)
 		__GX_SetDirtyState();
 
@@ -1553,6 +1918,12 @@ void GX_Flush(void)
 	wgPipe->U32 = 0;
 
 	ppcsync();
+
+	if(_gxcapactive && !__gx->gxFifoUnlinked && !_gxwfredirected) {
+		_CPU_ISR_Disable(level);
+		__GX_CaptureFifo(__GX_GetFifoWritePtr());
+		_CPU_ISR_Restore(level);
+	}
 }
 
 void GX_EnableBreakPt(void *break_pt)
@@ -1582,6 +1953,7 @@ void GX_DisableBreakPt(void)
 void GX_AbortFrame(void)
 {
 	__GX_Abort();
+	__GX_InvalidateWriteFilter();
 	if(__GX_IsGPFifoReady()) {
 		__GX_CleanGPFifo();
 		__GX_InitRevBits();
@@ -1680,6 +2052,8 @@ GXBreakPtCallback GX_SetBreakPtCallback(GXBreakPtCallback cb)
 
 void GX_PixModeSync(void)
 {
+	// the unchanged load is the sync, keep the write filter from dropping it
+	__GX_ForgetBP(_SHIFTR(__gx->peCntrl,24,8));
 	GX_LOAD_BP_REG(__gx->peCntrl);
 }
 
@@ -2085,6 +2459,7 @@ void GX_ClearBoundingBox(void)
 
 void GX_BeginDispList(void *list,u32 size)
 {
+	u32 level;
 	struct __gxfifo *fifo;
 
 	if(__gx->dirtyState)
@@ -2103,15 +2478,22 @@ void GX_BeginDispList(void *list,u32 size)
 	fifo->rdwt_dst = 0;
 
 	__gx->gxFifoUnlinked = 1;
+	__GX_UpdateWriteFilter();
 
 	GX_GetCPUFifo(&_gx_old_cpufifo);
+	if(_gxcapactive) {
+		_CPU_ISR_Disable(level);
+		__GX_CaptureFifo(((struct __gxfifo*)&_gx_old_cpufifo)->wt_ptr);
+		_CPU_ISR_Restore(level);
+	}
 	GX_SetCPUFifo(&_gx_dl_fifoobj);
 	__GX_ResetWriteGatherPipe();
 }
 
 u32 GX_EndDispList(void)
 {
-	u32 level;
+	u32 level,size;
+	void *list;
 	u8 wrap = 0;
 
 	GX_GetCPUFifo(&_gx_dl_fifoobj);
@@ -2124,11 +2506,21 @@ u32 GX_EndDispList(void)
 	}
 
 	__gx->gxFifoUnlinked = 0;
+	__GX_UpdateWriteFilter();
 
 	wrap = GX_GetFifoWrap(&_gx_dl_fifoobj);
 	if(wrap) return 0;
 
-	return GX_GetFifoCount(&_gx_dl_fifoobj);
+	size = GX_GetFifoCount(&_gx_dl_fifoobj);
+	if(_gxcapactive) {
+		list = (void*)((struct __gxfifo*)&_gx_dl_fifoobj)->buf_start;
+
+		_CPU_ISR_Disable(level);
+		DCInvalidateRange(list,size);
+		__GX_CaptureRecord(GX_CAPTURE_DISPLIST,list,size,NULL,0);
+		_CPU_ISR_Restore(level);
+	}
+	return size;
 }
 
 void GX_CallDispList(const void *list,u32 nbytes)
@@ -2142,6 +2534,9 @@ void GX_CallDispList(const void *list,u32 nbytes)
 	wgPipe->U8 = 0x40;		//call displaylist
 	wgPipe->U32 = MEM_VIRTUAL_TO_PHYSICAL(list);
 	wgPipe->U32 = nbytes;
+
+	// the list may have loaded any register
+	__GX_InvalidateWriteFilter();
 }
 
 void GX_SetChanCtrl(s32 channel,u8 enable,u8 ambsrc,u8 matsrc,u8 litmask,u8 diff_fn,u8 attn_fn)
@@ -3821,64 +4216,69 @@ void GX_SetPointSize(u8 width,u8 fmt)
 	GX_LOAD_BP_REG(__gx->lpWidth);
 }
 
-void GX_SetTevColor(u8 tev_regid,GXColor color)
+/* the TEV color registers are written as a pair, with the second load
+ * repeated to flush it through. the filter drops the four loads only if
+ * both registers already hold their values.
+ */
+static void __GX_SetTevRegs(u32 ra,u32 bg)
 {
-	u32 reg;
+	u32 cache = 0;
 
-	reg = (_SHIFTL((0xe0+(tev_regid<<1)),24,8)|(_SHIFTL(color.a,12,8))|(color.r&0xff));
-	GX_LOAD_BP_REG(reg);
+	if(_gxwfactive) {
+		if(_gxwfbpmask==0x00ffffff && __GX_IsBPCached(ra) && __GX_IsBPCached(bg)) {
+			_gxwfstats.bpSuppressed += 4;
+			return;
+		}
+		cache = (_gxwfbpmask==0x00ffffff);
+	}
 
-	reg = (_SHIFTL((0xe1+(tev_regid<<1)),24,8)|(_SHIFTL(color.g,12,8))|(color.b&0xff));
-	GX_LOAD_BP_REG(reg);
+	GX_LOAD_BP_REG(ra);
+	GX_LOAD_BP_REG(bg);
 
 	//this two calls should obviously flush the Write Gather Pipe.
-	GX_LOAD_BP_REG(reg);
-	GX_LOAD_BP_REG(reg);
+	GX_LOAD_BP_REG(bg);
+	GX_LOAD_BP_REG(bg);
+
+	if(cache) {
+		__GX_CacheBP(ra);
+		__GX_CacheBP(bg);
+	}
 }
 
-void GX_SetTevColorS10(u8 tev_regid,GXColorS10 color)
+void GX_SetTevColor(u8 tev_regid,GXColor color)
 {
-	u32 reg;
+	u32 ra,bg;
 
-	reg = (_SHIFTL((0xe0+(tev_regid<<1)),24,8)|(_SHIFTL(color.a,12,11))|(color.r&0x7ff));
-	GX_LOAD_BP_REG(reg);
+	ra = (_SHIFTL((0xe0+(tev_regid<<1)),24,8)|(_SHIFTL(color.a,12,8))|(color.r&0xff));
+	bg = (_SHIFTL((0xe1+(tev_regid<<1)),24,8)|(_SHIFTL(color.g,12,8))|(color.b&0xff));
+	__GX_SetTevRegs(ra,bg);
+}
 
-	reg = (_SHIFTL((0xe1+(tev_regid<<1)),24,8)|(_SHIFTL(color.g,12,11))|(color.b&0x7ff));
-	GX_LOAD_BP_REG(reg);
+void GX_SetTevColorS10(u8 tev_regid,GXColorS10 color)
+{
+	u32 ra,bg;
 
-	//this two calls should obviously flush the Write Gather Pipe.
-	GX_LOAD_BP_REG(reg);
-	GX_LOAD_BP_REG(reg);
+	ra = (_SHIFTL((0xe0+(tev_regid<<1)),24,8)|(_SHIFTL(color.a,12,11))|(color.r&0x7ff));
+	bg = (_SHIFTL((0xe1+(tev_regid<<1)),24,8)|(_SHIFTL(color.g,12,11))|(color.b&0x7ff));
+	__GX_SetTevRegs(ra,bg);
 }
 
 void GX_SetTevKColor(u8 tev_kregid,GXColor color)
 {
-	u32 reg;
-
-	reg = (_SHIFTL((0xe0+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.a,12,8))|(color.r&0xff));
-	GX_LOAD_BP_REG(reg);
+	u32 ra,bg;
 
-	reg = (_SHIFTL((0xe1+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.g,12,8))|(color.b&0xff));
-	GX_LOAD_BP_REG(reg);
-
-	//this two calls should obviously flush the Write Gather Pipe.
-	GX_LOAD_BP_REG(reg);
-	GX_LOAD_BP_REG(reg);
+	ra = (_SHIFTL((0xe0+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.a,12,8))|(color.r&0xff));
+	bg = (_SHIFTL((0xe1+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.g,12,8))|(color.b&0xff));
+	__GX_SetTevRegs(ra,bg);
 }
 
 void GX_SetTevKColorS10(u8 tev_kregid,GXColorS10 color)
 {
-	u32 reg;
+	u32 ra,bg;
 
-	reg = (_SHIFTL((0xe0+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.a,12,11))|(color.r&0x7ff));
-	GX_LOAD_BP_REG(reg);
-
-	reg = (_SHIFTL((0xe1+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.g,12,11))|(color.b&0x7ff));
-	GX_LOAD_BP_REG(reg);
-
-	//this two calls should obviously flush the Write Gather Pipe.
-	GX_LOAD_BP_REG(reg);
-	GX_LOAD_BP_REG(reg);
+	ra = (_SHIFTL((0xe0+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.a,12,11))|(color.r&0x7ff));
+	bg = (_SHIFTL((0xe1+(tev_kregid<<1)),24,8)|(_SHIFTL(1,23,1))|(_SHIFTL(color.g,12,11))|(color.b&0x7ff));
+	__GX_SetTevRegs(ra,bg);
 }
 
 void GX_SetTevOp(u8 tevstage,u8 mode)
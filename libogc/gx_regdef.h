@@ -5,6 +5,16 @@
 
 #define STRUCT_REGDEF_SIZE		1440
 
+/* BP registers holding plain state, one bit per register. triggers like
+ * copies, texture loads, tokens and counters are left out, as are the
+ * TEV color registers, whose loads are repeated to flush them through.
+ */
+static const u32 __gx_bpstateregs[8] =
+{
+	0xFFFF7FDF,0xFFFFFFE7,0x021BBE1F,0x00000100,
+	0xFFFFFFFF,0x0FFFFFFF,0xFFFFFFFF,0x3FFFFF00
+};
+
 struct __gx_regdef
 {
 	u16 cpSRreg;
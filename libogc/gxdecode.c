@@ -0,0 +1,508 @@
+/*-------------------------------------------------------------
+
+gxdecode.c -- GX command stream decoder
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "gx.h"
+#include "gx_regdef.h"
+#include "gxdecode.h"
+
+#define _SHIFTR(v, s, w)	\
+    ((u32)(((u32)(v) >> (s)) & ((0x01 << (w)) - 1)))
+
+#define GXD_LINESIZE			96
+
+struct __gxd_regname {
+	u16 first;
+	u16 last;
+	const char *name;
+};
+
+static const struct __gxd_regname _gxdbpnames[] =
+{
+	{0x00,0x00,"GENMODE"},{0x01,0x04,"DISPCOPY_FILTER"},{0x06,0x0e,"IND_MTX"},{0x0f,0x0f,"IND_IMASK"},
+	{0x10,0x1f,"IND_CMD"},{0x20,0x20,"SCISSOR_TL"},{0x21,0x21,"SCISSOR_BR"},{0x22,0x22,"LPSIZE"},
+	{0x23,0x24,"PERF_COUNTER"},{0x25,0x26,"IND_SCALE"},{0x27,0x27,"IND_REF"},{0x28,0x2f,"TEV_ORDER"},
+	{0x30,0x3f,"SU_TEXSIZE"},{0x40,0x40,"ZMODE"},{0x41,0x41,"BLENDMODE"},{0x42,0x42,"DSTALPHA"},
+	{0x43,0x43,"PE_CONTROL"},{0x44,0x44,"FIELD_MASK"},{0x45,0x45,"DRAWDONE"},{0x46,0x46,"PE_CLOCK"},
+	{0x47,0x47,"TOKEN"},{0x48,0x48,"TOKEN_INT"},{0x49,0x49,"COPY_SRC_TL"},{0x4a,0x4a,"COPY_SRC_WH"},
+	{0x4b,0x4b,"COPY_DST_ADDR"},{0x4c,0x4c,"COPY_DST_STRIDE"},{0x4d,0x4d,"COPY_YSCALE"},{0x4f,0x50,"CLEAR_COLOR"},
+	{0x51,0x51,"CLEAR_Z"},{0x52,0x52,"COPY_EXECUTE"},{0x53,0x54,"COPY_FILTER"},{0x55,0x56,"BOUNDINGBOX"},
+	{0x58,0x58,"REVBITS"},{0x59,0x59,"SCISSOR_OFFSET"},{0x60,0x63,"TEX_PRELOAD"},{0x64,0x65,"TLUT_LOAD"},
+	{0x66,0x66,"TEX_INVALIDATE"},{0x67,0x67,"PERF_METRIC"},{0x68,0x68,"FIELD_MODE"},{0x69,0x69,"VI_CLOCK"},
+	{0xe0,0xe7,"TEV_REGISTER"},{0xe8,0xe8,"FOG_RANGE"},{0xe9,0xed,"FOG_RANGE_K"},{0xee,0xf1,"FOG_PARAM"},
+	{0xf2,0xf2,"FOG_COLOR"},{0xf3,0xf3,"ALPHA_COMPARE"},{0xf4,0xf5,"ZTEX"},{0xf6,0xfd,"TEV_KSEL"},
+	{0xfe,0xfe,"BP_MASK"},{0,0,NULL}
+};
+
+static const char* const _gxdtexnames[8] =
+{
+	"TX_MODE0","TX_MODE1","TX_IMAGE0","TX_IMAGE1","TX_IMAGE2","TX_IMAGE3","TX_TLUT",NULL
+};
+
+static const struct __gxd_regname _gxdcpnames[] =
+{
+	{0x20,0x20,"PERF_SELECT"},{0x30,0x30,"MTXIDX_A"},{0x40,0x40,"MTXIDX_B"},{0x50,0x50,"VCD_LO"},
+	{0x60,0x60,"VCD_HI"},{0x70,0x77,"VAT_A"},{0x80,0x87,"VAT_B"},{0x90,0x97,"VAT_C"},
+	{0xa0,0xaf,"ARRAY_BASE"},{0xb0,0xbf,"ARRAY_STRIDE"},{0,0,NULL}
+};
+
+static const struct __gxd_regname _gxdxfnames[] =
+{
+	{0x0000,0x03ff,"POS_MTX"},{0x0400,0x045f,"NRM_MTX"},{0x0500,0x05ff,"DUALTEX_MTX"},{0x0600,0x067f,"LIGHT"},
+	{0x1000,0x1000,"ERROR"},{0x1008,0x1008,"VTX_SPEC"},{0x1009,0x1009,"NUM_COLORS"},{0x100a,0x100b,"AMBIENT"},
+	{0x100c,0x100d,"MATERIAL"},{0x100e,0x1011,"CHAN_CTRL"},{0x1012,0x1012,"DUALTEX"},{0x1018,0x1018,"MTXIDX_A"},
+	{0x1019,0x1019,"MTXIDX_B"},{0x101a,0x101f,"VIEWPORT"},{0x1020,0x1026,"PROJECTION"},{0x103f,0x103f,"NUM_TEXGENS"},
+	{0x1040,0x1047,"TEXGEN"},{0x1050,0x1057,"DUALTEXGEN"},{0,0,NULL}
+};
+
+static const char* const _gxdprimnames[8] =
+{
+	"QUADS","QUADS2","TRIANGLES","TRIANGLESTRIP","TRIANGLEFAN","LINES","LINESTRIP","POINTS"
+};
+
+static const char* const _gxdxfindexnames[4] = {"A","B","C","D"};
+
+static const u8 _gxdcompsize[8] = {1,1,2,2,4,0,0,0};
+static const u8 _gxdclrsize[8] = {2,3,4,2,3,4,0,0};
+
+// VAT word and bit of the component count of each texture coordinate, its format follows
+static const u8 _gxdtexvat[8][2] = {{0,21},{1,0},{1,9},{1,18},{1,27},{2,5},{2,14},{2,23}};
+
+static __inline__ u32 __gxd_read16(const u8 *p)
+{
+	return ((u32)p[0]<<8)|(u32)p[1];
+}
+
+static __inline__ u32 __gxd_read32(const u8 *p)
+{
+	return ((u32)p[0]<<24)|((u32)p[1]<<16)|((u32)p[2]<<8)|(u32)p[3];
+}
+
+static const char* __gxd_regname(const struct __gxd_regname *names,u32 reg)
+{
+	while(names->name) {
+		if(reg>=names->first && reg<=names->last) return names->name;
+		names++;
+	}
+	return "";
+}
+
+static const char* __gxd_bpname(u32 reg)
+{
+	if(reg>=0x80 && reg<0xc0) return _gxdtexnames[_SHIFTR(reg,2,3)] ? _gxdtexnames[_SHIFTR(reg,2,3)] : "";
+	if(reg>=0xc0 && reg<0xe0) return (reg&1) ? "TEV_ALPHA_ENV" : "TEV_COLOR_ENV";
+	return __gxd_regname(_gxdbpnames,reg);
+}
+
+static void __gxd_print(GXDecoder *dec,const char *fmt,...) __attribute__((format(printf,2,3)));
+
+static void __gxd_print(GXDecoder *dec,const char *fmt,...)
+{
+	u32 len = 0;
+	char line[GXD_LINESIZE];
+	va_list args;
+
+	if(dec->indl) {
+		line[0] = ' ';
+		line[1] = ' ';
+		len = 2;
+	}
+
+	va_start(args,fmt);
+	vsnprintf(line + len,GXD_LINESIZE - len,fmt,args);
+	va_end(args);
+
+	dec->output(dec->usrdata,line);
+}
+
+static void __gxd_flushnops(GXDecoder *dec)
+{
+	if(!dec->parser.nops) return;
+
+	if(dec->output) __gxd_print(dec,"NOP  x%u",dec->parser.nops);
+	dec->parser.nops = 0;
+}
+
+static u32 __gxd_vtxsize(const GXDecoder *dec,u32 fmt)
+{
+	u32 i,type,cnt,vfmt,vat;
+	u32 vcdlo = dec->cp[0x50];
+	u32 vcdhi = dec->cp[0x60];
+	u32 vat0 = dec->cp[0x70+fmt];
+	u32 size = 0;
+
+	// matrix indices
+	for(i=0;i<9;i++) {
+		if(vcdlo&(1<<i)) size++;
+	}
+
+	// index8 and index16 attributes take 1 and 2 bytes
+	type = _SHIFTR(vcdlo,9,2);
+	if(type==1) size += (_SHIFTR(vat0,0,1) ? 3 : 2)*_gxdcompsize[_SHIFTR(vat0,1,3)];
+	else if(type) size += type - 1;
+
+	type = _SHIFTR(vcdlo,11,2);
+	cnt = _SHIFTR(vat0,9,1);
+	if(type==1) size += (cnt ? 9 : 3)*_gxdcompsize[_SHIFTR(vat0,10,3)];
+	else if(type) size += ((cnt && _SHIFTR(vat0,31,1)) ? 3 : 1)*(type - 1);
+
+	type = _SHIFTR(vcdlo,13,2);
+	if(type==1) size += _gxdclrsize[_SHIFTR(vat0,14,3)];
+	else if(type) size += type - 1;
+
+	type = _SHIFTR(vcdlo,15,2);
+	if(type==1) size += _gxdclrsize[_SHIFTR(vat0,18,3)];
+	else if(type) size += type - 1;
+
+	for(i=0;i<8;i++) {
+		type = _SHIFTR(vcdhi,(i<<1),2);
+		if(type==1) {
+			vat = dec->cp[0x70+(_gxdtexvat[i][0]<<4)+fmt];
+			cnt = _SHIFTR(vat,_gxdtexvat[i][1],1);
+			vfmt = _SHIFTR(vat,_gxdtexvat[i][1]+1,3);
+			size += (cnt ? 2 : 1)*_gxdcompsize[vfmt];
+		} else if(type) size += type - 1;
+	}
+	return size;
+}
+
+// counts a load and returns whether it left the register unchanged
+static u32 __gxd_load(GXDecoder *dec,u32 *regs,u32 *valid,u32 reg,u32 val)
+{
+	u32 bit = (1<<(reg&0x1f));
+
+	if(dec->indl) return 0;
+
+	dec->stats.loads++;
+	if((valid[reg>>5]&bit) && regs[reg]==val) {
+		dec->stats.redundantLoads++;
+		return 1;
+	}
+	regs[reg] = val;
+	valid[reg>>5] |= bit;
+	dec->changes++;
+	return 0;
+}
+
+static void __gxd_bp(GXDecoder *dec,u32 val)
+{
+	u32 reg = _SHIFTR(val,24,8);
+	u32 bit = (1<<(reg&0x1f));
+	u32 mask,redundant = 0;
+
+	if(reg==0xfe) {
+		dec->bpmask = (val&0x00ffffff);
+		if(!dec->indl) dec->stats.loads++;
+	} else {
+		mask = dec->bpmask;
+		dec->bpmask = 0x00ffffff;
+
+		// the second TEV color register is loaded three times in a row to flush it
+		if((reg&0xf8)==0xe0 && val==dec->lastbp) {
+			if(!dec->indl) dec->stats.loads++;
+		} else if(!(__gx_bpstateregs[reg>>5]&bit) && (reg&0xf8)!=0xe0) {
+			if(!dec->indl) dec->stats.loads++;
+		} else if(mask!=0x00ffffff) {
+			// only the bits under the mask are replaced
+			if(!dec->indl) {
+				dec->stats.loads++;
+				dec->changes++;
+			}
+			if(dec->bpvalid[reg>>5]&bit) dec->bp[reg] = (dec->bp[reg]&~mask)|(val&mask);
+		} else redundant = __gxd_load(dec,dec->bp,dec->bpvalid,reg,val);
+	}
+	dec->lastbp = val;
+
+	if(dec->output) __gxd_print(dec,"BP   %02x %06x %-16s%s",reg,(val&0x00ffffff),__gxd_bpname(reg),redundant ? " (redundant)" : "");
+
+	// a copy to the external frame buffer ends the frame
+	if(reg==0x52 && (val&0x4000) && !dec->indl) GXD_EndFrame(dec);
+}
+
+static void __gxd_cp(GXDecoder *dec,u32 reg,u32 val)
+{
+	u32 redundant = __gxd_load(dec,dec->cp,dec->cpvalid,reg,val);
+
+	// vertex formats are needed to size the draws, even inside display lists
+	if(dec->indl) dec->cp[reg] = val;
+
+	if(dec->output) __gxd_print(dec,"CP   %02x %08x %-16s%s",reg,val,__gxd_regname(_gxdcpnames,reg),redundant ? " (redundant)" : "");
+}
+
+static void __gxd_xf(GXDecoder *dec,u32 addr,u32 val)
+{
+	u32 redundant = 0;
+
+	if((addr&0xff00)==0x1000) redundant = __gxd_load(dec,dec->xf,dec->xfvalid,(addr&0xff),val);
+	else if(!dec->indl) {
+		dec->stats.loads++;
+		dec->changes++;
+	}
+
+	if(dec->output) __gxd_print(dec,"XF   %04x %08x %-16s%s",addr,val,__gxd_regname(_gxdxfnames,addr),redundant ? " (redundant)" : "");
+}
+
+static u32 __gxd_cmdsize(u32 op)
+{
+	if(op>=0x80 && op<0xc0) return 3;
+
+	switch(op) {
+		case 0x08:
+			return 6;
+		case 0x10:
+		case 0x20:
+		case 0x28:
+		case 0x30:
+		case 0x38:
+		case 0x61:
+			return 5;
+		case 0x40:
+			return 9;
+		default:
+			return 1;
+	}
+}
+
+static void __gxd_count(GXDecoder *dec,u32 cmd,u32 bytes)
+{
+	if(dec->indl) return;
+
+	dec->stats.cmdCount[cmd]++;
+	dec->stats.cmdBytes[cmd] += bytes;
+}
+
+static void __gxd_command(GXDecoder *dec)
+{
+	u32 op,val,cnt,size;
+	GXDParser *parser = &dec->parser;
+	const u8 *cmd = parser->cmd;
+
+	op = cmd[0];
+	if(op) __gxd_flushnops(dec);
+
+	if(op>=0x80 && op<0xc0) {
+		cnt = __gxd_read16(cmd + 1);
+		size = cnt*__gxd_vtxsize(dec,(op&7));
+		parser->skip = size;
+
+		__gxd_count(dec,GXD_CMD_DRAW,3 + size);
+		if(!dec->indl) {
+			dec->stats.draws++;
+			dec->stats.vertices += cnt;
+			dec->stats.stateChanges += dec->changes;
+			if(dec->changes>dec->stats.maxStateChanges) dec->stats.maxStateChanges = dec->changes;
+			dec->changes = 0;
+		}
+		if(dec->output) __gxd_print(dec,"DRAW %s fmt %u, %u vertices, %u bytes",_gxdprimnames[_SHIFTR(op,3,3)],(op&7),cnt,size);
+		return;
+	}
+
+	switch(op) {
+		case 0x00:
+			__gxd_count(dec,GXD_CMD_NOP,1);
+			parser->nops++;
+			break;
+		case 0x08:
+			__gxd_count(dec,GXD_CMD_CP,6);
+			__gxd_cp(dec,cmd[1],__gxd_read32(cmd + 2));
+			break;
+		case 0x10:
+			val = __gxd_read32(cmd + 1);
+			parser->xfaddr = (val&0xffff);
+			parser->xfleft = _SHIFTR(val,16,16) + 1;
+			__gxd_count(dec,GXD_CMD_XF,5 + (parser->xfleft<<2));
+			break;
+		case 0x20:
+		case 0x28:
+		case 0x30:
+		case 0x38:
+			val = __gxd_read32(cmd + 1);
+			__gxd_count(dec,GXD_CMD_XFINDEX,5);
+			if(!dec->indl) {
+				dec->stats.loads++;
+				dec->changes++;
+			}
+			if(dec->output) __gxd_print(dec,"XFIX %s index %u, addr %03x, %u words",_gxdxfindexnames[_SHIFTR(op,3,2)],_SHIFTR(val,16,16),(val&0xfff),_SHIFTR(val,12,4) + 1);
+			break;
+		case 0x40:
+			val = __gxd_read32(cmd + 5);
+			__gxd_count(dec,GXD_CMD_CALLDL,9);
+			if(!dec->indl) {
+				dec->stats.dlCalls++;
+				dec->stats.dlBytes += val;
+
+				// the list may have loaded any register
+				memset(dec->bpvalid,0,sizeof(dec->bpvalid));
+				memset(dec->cpvalid,0,sizeof(dec->cpvalid));
+				memset(dec->xfvalid,0,sizeof(dec->xfvalid));
+			}
+			if(dec->output) __gxd_print(dec,"CALL %08x, %u bytes",__gxd_read32(cmd + 1),val);
+			break;
+		case 0x48:
+			__gxd_count(dec,GXD_CMD_INVVC,1);
+			if(dec->output) __gxd_print(dec,"INVALIDATE VTX CACHE");
+			break;
+		case 0x61:
+			__gxd_count(dec,GXD_CMD_BP,5);
+			__gxd_bp(dec,__gxd_read32(cmd + 1));
+			break;
+		default:
+			__gxd_count(dec,GXD_CMD_UNKNOWN,1);
+			if(dec->output) __gxd_print(dec,"UNKNOWN %02x",op);
+			break;
+	}
+}
+
+// collects the bytes of the current command, across calls if need be
+static u32 __gxd_fill(GXDParser *parser,const u8 **data,u32 *len,u32 size)
+{
+	u32 cnt;
+
+	if(parser->have<size) {
+		cnt = size - parser->have;
+		if(cnt>*len) cnt = *len;
+
+		memcpy(parser->cmd + parser->have,*data,cnt);
+		parser->have += cnt;
+		*data += cnt;
+		*len -= cnt;
+	}
+	return (parser->have>=size);
+}
+
+void GXD_Init(GXDecoder *dec,GXDOutputCallback output,GXDFrameCallback framecb,void *usrdata)
+{
+	memset(dec,0,sizeof(GXDecoder));
+
+	dec->bpmask = 0x00ffffff;
+	dec->output = output;
+	dec->framecb = framecb;
+	dec->usrdata = usrdata;
+}
+
+void GXD_Decode(GXDecoder *dec,const void *data,u32 len)
+{
+	u32 cnt;
+	const u8 *ptr = data;
+	GXDParser *parser = &dec->parser;
+
+	while(len) {
+		if(parser->skip) {
+			cnt = (parser->skip<len) ? parser->skip : len;
+			parser->skip -= cnt;
+			ptr += cnt;
+			len -= cnt;
+			continue;
+		}
+
+		if(parser->xfleft) {
+			if(!__gxd_fill(parser,&ptr,&len,4)) break;
+
+			__gxd_xf(dec,parser->xfaddr,__gxd_read32(parser->cmd));
+			parser->xfaddr++;
+			parser->xfleft--;
+			parser->have = 0;
+			continue;
+		}
+
+		if(!__gxd_fill(parser,&ptr,&len,1)) break;
+		if(!__gxd_fill(parser,&ptr,&len,__gxd_cmdsize(parser->cmd[0]))) break;
+
+		__gxd_command(dec);
+		parser->have = 0;
+	}
+	__gxd_flushnops(dec);
+}
+
+u32 GXD_DecodeCapture(GXDecoder *dec,const void *data,u32 len)
+{
+	s32 i;
+	u32 hdr,type,size,pos;
+	u32 vtxstate[26];
+	GXDParser parser;
+	const u8 *ptr = data;
+
+	pos = 0;
+	while((len - pos)>=4) {
+		hdr = __gxd_read32(ptr + pos);
+		type = _SHIFTR(hdr,24,8);
+		size = (hdr&0x00ffffff);
+		if((((size+3)&~3) + 4)>(len - pos)) break;
+
+		pos += 4;
+		if(type==GX_CAPTURE_FIFO) GXD_Decode(dec,ptr + pos,size);
+		else if(type==GX_CAPTURE_DISPLIST) {
+			// a display list runs with whatever state it's called in, keep it apart
+			parser = dec->parser;
+			vtxstate[0] = dec->cp[0x50];
+			vtxstate[1] = dec->cp[0x60];
+			for(i=0;i<24;i++) vtxstate[2+i] = dec->cp[0x70+((i>>3)<<4)+(i&7)];
+
+			if(dec->output) dec->output(dec->usrdata,"DISPLIST");
+			memset(&dec->parser,0,sizeof(GXDParser));
+			dec->indl = 1;
+			GXD_Decode(dec,ptr + pos,size);
+			dec->indl = 0;
+
+			dec->parser = parser;
+			dec->cp[0x50] = vtxstate[0];
+			dec->cp[0x60] = vtxstate[1];
+			for(i=0;i<24;i++) dec->cp[0x70+((i>>3)<<4)+(i&7)] = vtxstate[2+i];
+		} else if(type==GX_CAPTURE_VTXSTATE && size==sizeof(vtxstate)) {
+			dec->cp[0x50] = __gxd_read32(ptr + pos);
+			dec->cp[0x60] = __gxd_read32(ptr + pos + 4);
+			for(i=0;i<24;i++) dec->cp[0x70+((i>>3)<<4)+(i&7)] = __gxd_read32(ptr + pos + 8 + (i<<2));
+
+			// nothing is known about the other registers after a gap
+			memset(dec->bpvalid,0,sizeof(dec->bpvalid));
+			memset(dec->cpvalid,0,sizeof(dec->cpvalid));
+			memset(dec->xfvalid,0,sizeof(dec->xfvalid));
+			memset(&dec->parser,0,sizeof(GXDParser));
+			dec->bpmask = 0x00ffffff;
+			if(dec->output) dec->output(dec->usrdata,"VTXSTATE");
+		}
+		pos += ((size+3)&~3);
+	}
+	return pos;
+}
+
+void GXD_EndFrame(GXDecoder *dec)
+{
+	u32 frame = dec->stats.frame;
+
+	if(dec->framecb) dec->framecb(dec->usrdata,&dec->stats);
+
+	memset(&dec->stats,0,sizeof(GXDStats));
+	dec->stats.frame = frame + 1;
+	dec->changes = 0;
+}
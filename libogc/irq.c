@@ -248,7 +248,11 @@ void c_irqdispatcher(frame_context *ctx)
 			i++;
 		}
 
-		if(g_IRQHandler[irq]) g_IRQHandler[irq](irq,ctx);
+		if(g_IRQHandler[irq]) {
+			__lwp_trace_record(LWP_TRACE_IRQENTER,irq,0);
+			g_IRQHandler[irq](irq,ctx);
+			__lwp_trace_record(LWP_TRACE_IRQEXIT,irq,0);
+		}
 	}
 #ifdef _IRQ_DEBUG
 	__irq_dump(mask,irq);
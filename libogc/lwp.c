@@ -87,6 +87,15 @@ typedef struct _tqueue_st {
 lwp_objinfo _lwp_thr_objects;
 lwp_objinfo _lwp_tqueue_objects;
 
+u32 __attribute__((weak)) __lwp_limit_threads = LWP_LIMIT_THREADS;
+u32 __attribute__((weak)) __lwp_limit_tqueues = LWP_LIMIT_TQUEUES;
+
+extern lwp_objinfo _lwp_mutex_objects;
+extern lwp_objinfo _lwp_sema_objects;
+extern lwp_objinfo _lwp_cond_objects;
+extern lwp_objinfo _lwp_mqbox_objects;
+extern lwp_objinfo sys_alarm_objects;
+
 extern int __crtmain(void);
 
 extern u8 __stack_addr[],__stack_end[];
@@ -168,8 +177,8 @@ static void* idle_func(void *arg)
 
 void __lwp_sysinit(void)
 {
-	__lwp_objmgr_initinfo(&_lwp_thr_objects,LWP_MAX_THREADS,sizeof(lwp_cntrl));
-	__lwp_objmgr_initinfo(&_lwp_tqueue_objects,LWP_MAX_TQUEUES,sizeof(tqueue_st));
+	__lwp_objmgr_initinfoex(&_lwp_thr_objects,LWP_MAX_THREADS,__lwp_limit_threads,sizeof(lwp_cntrl));
+	__lwp_objmgr_initinfoex(&_lwp_tqueue_objects,LWP_MAX_TQUEUES,__lwp_limit_tqueues,sizeof(tqueue_st));
 
 	// create idle thread, is needed if all threads are locked on a queue
 	_thr_idle = (lwp_cntrl*)__lwp_objmgr_allocate(&_lwp_thr_objects);
@@ -569,3 +578,67 @@ s32 LWP_ThreadSignal(lwpq_t thequeue)
 
 	return 0;
 }
+
+s32 LWP_GetObjectStats(u32 objclass,lwp_objstats *stats)
+{
+	u32 level;
+	lwp_objinfo *info;
+
+	if(!stats) return EINVAL;
+
+	switch(objclass) {
+		case LWP_OBJCLASS_THREAD:
+			info = &_lwp_thr_objects;
+			break;
+		case LWP_OBJCLASS_TQUEUE:
+			info = &_lwp_tqueue_objects;
+			break;
+		case LWP_OBJCLASS_MUTEX:
+			info = &_lwp_mutex_objects;
+			break;
+		case LWP_OBJCLASS_SEMAPHORE:
+			info = &_lwp_sema_objects;
+			break;
+		case LWP_OBJCLASS_CONDVAR:
+			info = &_lwp_cond_objects;
+			break;
+		case LWP_OBJCLASS_MQUEUE:
+			info = &_lwp_mqbox_objects;
+			break;
+		case LWP_OBJCLASS_ALARM:
+			info = &sys_alarm_objects;
+			break;
+		default:
+			return EINVAL;
+	}
+
+	_CPU_ISR_Disable(level);
+	stats->inuse = info->alloc_nodes - info->inactives_cnt;
+	stats->allocated = info->alloc_nodes;
+	stats->limit = info->max_nodes;
+	stats->highwater = info->hwm;
+	_CPU_ISR_Restore(level);
+
+	return 0;
+}
+
+s32 LWP_GetThreadStats(lwp_t thethread,lwp_threadstats *stats)
+{
+	u32 level;
+	lwp_cntrl *lwp_thread;
+
+	if(!stats) return EINVAL;
+
+	lwp_thread = __lwp_cntrl_open(thethread);
+	if(!lwp_thread) return EINVAL;
+
+	_CPU_ISR_Disable(level);
+	stats->cpu_ticks = lwp_thread->cpu_ticks;
+	stats->switches = lwp_thread->switch_cnt;
+	if(__lwp_thread_isexec(lwp_thread))
+		stats->cpu_ticks += diff_ticks(lwp_thread->switch_time,gettime());
+	_CPU_ISR_Restore(level);
+
+	__lwp_thread_dispatchenable();
+	return 0;
+}
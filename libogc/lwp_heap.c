@@ -52,6 +52,7 @@ distribution.
 -------------------------------------------------------------*/
 
 #include <stdlib.h>
+#include <string.h>
 #include <system.h>
 #include <processor.h>
 #include <sys_state.h>
@@ -59,15 +60,53 @@ distribution.
 
 #include "lwp_heap.h"
 
+static heap_block* __lwp_heap_tlsf_search(heap_tlsf *tlsf,u32 size)
+{
+	u32 fl,sl,fl_map,sl_map;
+
+	__lwp_heap_tlsf_mapping_search(size,&fl,&sl);
+	if(fl>=HEAP_TLSF_FL_INDEX_COUNT) return NULL;
+
+	sl_map = tlsf->sl_bitmap[fl]&(0xffffffff>>sl);
+	if(!sl_map) {
+		fl_map = tlsf->fl_bitmap&(0xffffffff>>(fl+1));
+		if(!fl_map) return NULL;
+
+		fl = cntlzw(fl_map);
+		sl_map = tlsf->sl_bitmap[fl];
+	}
+	sl = cntlzw(sl_map);
+
+	return tlsf->blocks[fl][sl];
+}
+
 u32 __lwp_heap_init(heap_cntrl *theheap,void *start_addr,u32 size,u32 pg_size)
+{
+	return __lwp_heap_init_mode(theheap,start_addr,size,pg_size,HEAP_MODE_FIRSTFIT);
+}
+
+u32 __lwp_heap_init_mode(heap_cntrl *theheap,void *start_addr,u32 size,u32 pg_size,u32 mode)
 {
 	u32 dsize,level;
 	heap_block *block;
+	heap_tlsf *tlsf = NULL;
 
 	if(!__lwp_heap_pgsize_valid(pg_size) || size<HEAP_MIN_SIZE) return 0;
 
+	if(mode==HEAP_MODE_TLSF) {
+		dsize = (sizeof(heap_tlsf) + (PPC_ALIGNMENT - 1))&~(PPC_ALIGNMENT - 1);
+		if(size<(dsize + HEAP_MIN_SIZE)) return 0;
+
+		tlsf = (heap_tlsf*)start_addr;
+		memset(tlsf,0,sizeof(heap_tlsf));
+
+		start_addr += dsize;
+		size -= dsize;
+	}
+
 	_CPU_ISR_Disable(level);
 	theheap->pg_size = pg_size;
+	theheap->tlsf = tlsf;
 	dsize = (size - HEAP_OVERHEAD);
 	
 	block = (heap_block*)start_addr;
@@ -81,6 +120,8 @@ u32 __lwp_heap_init(heap_cntrl *theheap,void *start_addr,u32 size,u32 pg_size)
 	theheap->perm_null = NULL;
 	theheap->last = block;
 	
+	if(tlsf) __lwp_heap_tlsf_insert(tlsf,block);
+
 	block = __lwp_heap_nextblock(block);
 	block->back_flag = dsize;
 	block->front_flag = HEAP_DUMMY_FLAG;
@@ -111,7 +152,35 @@ void* __lwp_heap_allocate(heap_cntrl *theheap,u32 size)
 		dsize += (theheap->pg_size - excess);
 
 	if(dsize<sizeof(heap_block)) dsize = sizeof(heap_block);
-	
+
+	if(theheap->tlsf) {
+		block = __lwp_heap_tlsf_search(theheap->tlsf,dsize);
+		if(!block) {
+			_CPU_ISR_Restore(level);
+			return NULL;
+		}
+		__lwp_heap_tlsf_remove(theheap->tlsf,block);
+
+		if((block->front_flag-dsize)>(theheap->pg_size+HEAP_BLOCK_USED_OVERHEAD)) {
+			block->front_flag -= dsize;
+			next_block = __lwp_heap_nextblock(block);
+			next_block->back_flag = block->front_flag;
+
+			tmp_block = __lwp_heap_blockat(next_block,dsize);
+			tmp_block->back_flag = next_block->front_flag = __lwp_heap_buildflag(dsize,HEAP_BLOCK_USED);
+			__lwp_heap_tlsf_insert(theheap->tlsf,block);
+
+			ptr = __lwp_heap_startuser(next_block);
+		} else {
+			next_block = __lwp_heap_nextblock(block);
+			next_block->back_flag = __lwp_heap_buildflag(block->front_flag,HEAP_BLOCK_USED);
+			block->front_flag = next_block->back_flag;
+
+			ptr = __lwp_heap_startuser(block);
+		}
+		goto done;
+	}
+
 	for(block=theheap->first;;block=block->next) {
 		if(block==__lwp_heap_tail(theheap)) {
 			_CPU_ISR_Restore(level);
@@ -140,6 +209,7 @@ void* __lwp_heap_allocate(heap_cntrl *theheap,u32 size)
 		ptr = __lwp_heap_startuser(block);
 	}
 
+done:
 	offset = (theheap->pg_size - ((u32)ptr&(theheap->pg_size-1)));
 	ptr += offset;
 	*(((u32*)ptr)-1) = offset;
@@ -172,6 +242,32 @@ BOOL __lwp_heap_free(heap_cntrl *theheap,void *ptr)
 		_CPU_ISR_Restore(level);
 		return FALSE;
 	}
+
+	if(theheap->tlsf) {
+		if(__lwp_heap_prev_blockfree(block)) {
+			prev_block = __lwp_heap_prevblock(block);
+			if(!__lwp_heap_blockin(theheap,prev_block)) {
+				_CPU_ISR_Restore(level);
+				return FALSE;
+			}
+
+			__lwp_heap_tlsf_remove(theheap->tlsf,prev_block);
+			dsize += prev_block->front_flag;
+			block = prev_block;
+		}
+		if(__lwp_heap_blockfree(next_block)) {
+			__lwp_heap_tlsf_remove(theheap->tlsf,next_block);
+			dsize += next_block->front_flag;
+		}
+
+		block->front_flag = dsize;
+		tmp_block = __lwp_heap_nextblock(block);
+		tmp_block->back_flag = dsize;
+		__lwp_heap_tlsf_insert(theheap->tlsf,block);
+
+		_CPU_ISR_Restore(level);
+		return TRUE;
+	}
 	
 	if(__lwp_heap_prev_blockfree(block)) {
 		prev_block = __lwp_heap_prevblock(block);
@@ -125,4 +125,60 @@ static __inline__ u32 __lwp_heap_buildflag(u32 size,u32 flag)
 	return (size|flag);
 }
 
+static __inline__ void __lwp_heap_tlsf_mapping_insert(u32 size,u32 *fl,u32 *sl)
+{
+	u32 f;
+
+	if(size<HEAP_TLSF_SMALL_BLOCK_SIZE) {
+		*fl = 0;
+		*sl = size/(HEAP_TLSF_SMALL_BLOCK_SIZE/HEAP_TLSF_SL_INDEX_COUNT);
+	} else {
+		f = 31 - cntlzw(size);
+		*sl = (size>>(f-HEAP_TLSF_SL_INDEX_LOG2))^HEAP_TLSF_SL_INDEX_COUNT;
+		*fl = f - (HEAP_TLSF_FL_INDEX_SHIFT-1);
+	}
+}
+
+static __inline__ void __lwp_heap_tlsf_mapping_search(u32 size,u32 *fl,u32 *sl)
+{
+	if(size>=HEAP_TLSF_SMALL_BLOCK_SIZE)
+		size += (1<<((31 - cntlzw(size))-HEAP_TLSF_SL_INDEX_LOG2)) - 1;
+	__lwp_heap_tlsf_mapping_insert(size,fl,sl);
+}
+
+static __inline__ void __lwp_heap_tlsf_insert(heap_tlsf *tlsf,heap_block *block)
+{
+	u32 fl,sl;
+	heap_block *head;
+
+	__lwp_heap_tlsf_mapping_insert(__lwp_heap_blocksize(block),&fl,&sl);
+
+	head = tlsf->blocks[fl][sl];
+	block->next = head;
+	block->prev = NULL;
+	if(head) head->prev = block;
+	tlsf->blocks[fl][sl] = block;
+
+	tlsf->fl_bitmap |= (0x80000000>>fl);
+	tlsf->sl_bitmap[fl] |= (0x80000000>>sl);
+}
+
+static __inline__ void __lwp_heap_tlsf_remove(heap_tlsf *tlsf,heap_block *block)
+{
+	u32 fl,sl;
+
+	__lwp_heap_tlsf_mapping_insert(__lwp_heap_blocksize(block),&fl,&sl);
+
+	if(block->next) block->next->prev = block->prev;
+	if(block->prev) block->prev->next = block->next;
+	else {
+		tlsf->blocks[fl][sl] = block->next;
+		if(!block->next) {
+			tlsf->sl_bitmap[fl] &= ~(0x80000000>>sl);
+			if(!tlsf->sl_bitmap[fl])
+				tlsf->fl_bitmap &= ~(0x80000000>>fl);
+		}
+	}
+}
+
 #endif
@@ -69,13 +69,60 @@ u32 __lwp_objmgr_memsize(void)
 	return _lwp_objmgr_memsize;
 }
 
-void __lwp_objmgr_initinfo(lwp_objinfo *info,u32 max_nodes,u32 node_size)
+/* Adds up to grow_nodes objects to the pool. Only one caller extends a
+ * pool at a time; the block is allocated with interrupts enabled. */
+static u32 __lwp_objmgr_extend(lwp_objinfo *info)
 {
-	u32 idx,i,size;
+	u32 level,i,idx,cnt;
+	u8 *block;
 	lwp_obj *object;
-	lwp_queue inactives;
+
+	_CPU_ISR_Disable(level);
+	if(info->extending || info->alloc_nodes>=info->max_nodes) {
+		_CPU_ISR_Restore(level);
+		return 0;
+	}
+	info->extending = 1;
+	idx = info->alloc_nodes;
+	_CPU_ISR_Restore(level);
+
+	cnt = info->grow_nodes;
+	if(cnt>(info->max_nodes - idx)) cnt = (info->max_nodes - idx);
+
+	block = (u8*)__lwp_wkspace_allocate(cnt*info->node_size);
+
+	_CPU_ISR_Disable(level);
+	if(block) {
+		if(!info->obj_blocks) info->obj_blocks = block;
+		for(i=0;i<cnt;i++) {
+			object = (lwp_obj*)(block + (i*info->node_size));
+			object->id = (idx + i);
+			object->information = NULL;
+			__lwp_queue_appendI(&info->inactives,&object->node);
+		}
+		info->alloc_nodes += cnt;
+		info->inactives_cnt += cnt;
+		_lwp_objmgr_memsize += (cnt*info->node_size);
+	}
+	info->extending = 0;
+	_CPU_ISR_Restore(level);
+
+	return (block!=NULL);
+}
+
+void __lwp_objmgr_initinfo(lwp_objinfo *info,u32 max_nodes,u32 node_size)
+{
+	__lwp_objmgr_initinfoex(info,max_nodes,max_nodes,node_size);
+}
+
+void __lwp_objmgr_initinfoex(lwp_objinfo *info,u32 init_nodes,u32 max_nodes,u32 node_size)
+{
+	u32 i;
 	void **local_table;
-	
+
+	if(max_nodes>(LWP_OBJINDEX(~0)+1)) max_nodes = (LWP_OBJINDEX(~0)+1);
+	if(init_nodes>max_nodes) init_nodes = max_nodes;
+
 	info->min_id = 0;
 	info->max_id = 0;
 	info->inactives_cnt = 0;
@@ -83,37 +130,28 @@ void __lwp_objmgr_initinfo(lwp_objinfo *info,u32 max_nodes,u32 node_size)
 	info->max_nodes = max_nodes;
 	info->obj_blocks = NULL;
 	info->local_table = &null_local_table;
+	info->alloc_nodes = 0;
+	info->grow_nodes = init_nodes;
+	info->hwm = 0;
+	info->extending = 0;
 
 	__lwp_queue_init_empty(&info->inactives);
 
-	size = ((info->max_nodes*sizeof(lwp_obj*))+(info->max_nodes*info->node_size));
 	local_table = (void**)__lwp_wkspace_allocate(info->max_nodes*sizeof(lwp_obj*));
-	if(!local_table) return;
+	if(!local_table) {
+		info->max_nodes = 0;
+		return;
+	}
 
 	info->local_table = (lwp_obj**)local_table;
 	for(i=0;i<info->max_nodes;i++) {
 		local_table[i] = NULL;
 	}
+	info->max_id = info->max_nodes;
+	_lwp_objmgr_memsize += (info->max_nodes*sizeof(lwp_obj*));
 
-	info->obj_blocks = __lwp_wkspace_allocate(info->max_nodes*info->node_size);
-	if(!info->obj_blocks) {
-		__lwp_wkspace_free(local_table);
-		return;
-	}
-
-	__lwp_queue_initialize(&inactives,info->obj_blocks,info->max_nodes,info->node_size);
-
-	idx = info->min_id;
-	while((object=(lwp_obj*)__lwp_queue_get(&inactives))!=NULL) {
-		object->id = idx;
-		object->information = NULL;
-		__lwp_queue_append(&info->inactives,&object->node);
-		idx++;
-	}
-
-	info->max_id += info->max_nodes;
-	info->inactives_cnt += info->max_nodes;
-	_lwp_objmgr_memsize += size;
+	if(init_nodes>0) __lwp_objmgr_extend(info);
+	if(info->grow_nodes==0) info->grow_nodes = 1;
 }
 
 lwp_obj* __lwp_objmgr_getisrdisable(lwp_objinfo *info,u32 id,u32 *p_level)
@@ -122,8 +160,8 @@ lwp_obj* __lwp_objmgr_getisrdisable(lwp_objinfo *info,u32 id,u32 *p_level)
 	lwp_obj *object = NULL;
 
 	_CPU_ISR_Disable(level);
-	if(info->max_id>=id) {
-		if((object=info->local_table[id])!=NULL) {
+	if(LWP_OBJINDEX(id)<info->max_nodes) {
+		if((object=info->local_table[LWP_OBJINDEX(id)])!=NULL && object->id==id) {
 			*p_level = level;
 			return object;
 		}
@@ -136,8 +174,8 @@ lwp_obj* __lwp_objmgr_getnoprotection(lwp_objinfo *info,u32 id)
 {
 	lwp_obj *object = NULL;
 
-	if(info->max_id>=id) {
-		if((object=info->local_table[id])!=NULL) return object;
+	if(LWP_OBJINDEX(id)<info->max_nodes) {
+		if((object=info->local_table[LWP_OBJINDEX(id)])!=NULL && object->id==id) return object;
 	}
 	return NULL;
 }
@@ -146,9 +184,9 @@ lwp_obj* __lwp_objmgr_get(lwp_objinfo *info,u32 id)
 {
 	lwp_obj *object = NULL;
 
-	if(info->max_id>=id) {
+	if(LWP_OBJINDEX(id)<info->max_nodes) {
 		__lwp_thread_dispatchdisable();
-		if((object=info->local_table[id])!=NULL) return object;
+		if((object=info->local_table[LWP_OBJINDEX(id)])!=NULL && object->id==id) return object;
 		__lwp_thread_dispatchenable();
 	}
 	return NULL;
@@ -156,16 +194,20 @@ lwp_obj* __lwp_objmgr_get(lwp_objinfo *info,u32 id)
 
 lwp_obj* __lwp_objmgr_allocate(lwp_objinfo *info)
 {
-	u32 level;
+	u32 level,inuse;
 	lwp_obj* object;
 
-	_CPU_ISR_Disable(level);
-	 object = (lwp_obj*)__lwp_queue_getI(&info->inactives);
-	 if(object) {
-		 object->information = info;
-		 info->inactives_cnt--;
-	 }
-	_CPU_ISR_Restore(level);
+	do {
+		_CPU_ISR_Disable(level);
+		object = (lwp_obj*)__lwp_queue_getI(&info->inactives);
+		if(object) {
+			object->information = info;
+			info->inactives_cnt--;
+			inuse = (info->alloc_nodes - info->inactives_cnt);
+			if(inuse>info->hwm) info->hwm = inuse;
+		}
+		_CPU_ISR_Restore(level);
+	} while(!object && __lwp_objmgr_extend(info));
 
 	return object;
 }
@@ -175,6 +217,7 @@ void __lwp_objmgr_free(lwp_objinfo *info,lwp_obj *object)
 	u32 level;
 
 	_CPU_ISR_Disable(level);
+	object->id = (((LWP_OBJGEN(object->id) + 1)&0xff)<<16)|LWP_OBJINDEX(object->id);
 	__lwp_queue_appendI(&info->inactives,&object->node);
 	object->information	= NULL;
 	info->inactives_cnt++;
@@ -61,12 +61,12 @@ static __inline__ void __lwp_objmgr_setlocal(lwp_objinfo *info,u32 idx,lwp_obj *
 
 static __inline__ void __lwp_objmgr_open(lwp_objinfo *info,lwp_obj *object)
 {
-	__lwp_objmgr_setlocal(info,object->id,object);
+	__lwp_objmgr_setlocal(info,LWP_OBJINDEX(object->id),object);
 }
 
 static __inline__ void __lwp_objmgr_close(lwp_objinfo *info,lwp_obj *object)
 {
-	__lwp_objmgr_setlocal(info,object->id,NULL);
+	__lwp_objmgr_setlocal(info,LWP_OBJINDEX(object->id),NULL);
 }
 
 #endif
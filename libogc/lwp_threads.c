@@ -83,6 +83,10 @@ u32 _lwp_ticks_per_timeslice = 0;
 void **__lwp_thr_libc_reent = NULL;
 lwp_queue _lwp_thr_ready[LWP_MAXPRIORITIES];
 
+lwp_traceevt *_lwp_trace_buf = NULL;
+u32 _lwp_trace_mask = 0;
+u32 _lwp_trace_head = 0;
+
 static void (*_lwp_exitfunc)(void);
 
 extern void _cpu_context_switch(void *,void *);
@@ -230,6 +234,7 @@ void __thread_dispatch_fp(void)
 void __thread_dispatch(void)
 {
 	u32 level;
+	u64 now;
 	lwp_cntrl *exec,*heir;
 
 	_CPU_ISR_Disable(level);
@@ -239,6 +244,12 @@ void __thread_dispatch(void)
 		_thread_dispatch_disable_level = 1;
 		_context_switch_want = FALSE;
 		_thr_executing = heir;
+
+		now = gettime();
+		exec->cpu_ticks += diff_ticks(exec->switch_time,now);
+		heir->switch_time = now;
+		heir->switch_cnt++;
+		__lwp_trace_record(LWP_TRACE_DISPATCH,LWP_OBJINDEX(exec->object.id),LWP_OBJINDEX(heir->object.id));
 		_CPU_ISR_Restore(level);
 
 		if(__lwp_thr_libc_reent) {
@@ -377,6 +388,7 @@ void __lwp_thread_setstate(lwp_cntrl *thethread,u32 state)
 	}
 
 	thethread->cur_state = state;
+	__lwp_trace_record(LWP_TRACE_BLOCK,LWP_OBJINDEX(thethread->object.id),state);
 	if(__lwp_queue_onenode(ready)) {
 		__lwp_queue_init_empty(ready);
 		__lwp_priomap_removefrom(&thethread->priomap);
@@ -404,6 +416,7 @@ void __lwp_thread_clearstate(lwp_cntrl *thethread,u32 state)
 	if(__lwp_statesset(cur_state,state)) {
 		cur_state = thethread->cur_state = __lwp_clearstate(cur_state,state);
 		if(__lwp_stateready(cur_state)) {
+			__lwp_trace_record(LWP_TRACE_UNBLOCK,LWP_OBJINDEX(thethread->object.id),0);
 			__lwp_priomap_addto(&thethread->priomap);
 			__lwp_queue_appendI(thethread->ready,&thethread->object.node);
 			_CPU_ISR_Flash(level);
@@ -663,6 +676,9 @@ u32 __lwp_thread_init(lwp_cntrl *thethread,void *stack_area,u32 stack_size,u32 p
 	thethread->cpu_time_budget = _lwp_ticks_per_timeslice;
 	thethread->suspendcnt = 0;
 	thethread->res_cnt = 0;
+	thethread->cpu_ticks = 0;
+	thethread->switch_time = 0;
+	thethread->switch_cnt = 0;
 	__lwp_thread_setpriority(thethread,prio);
 
 	__libc_create_hook(_thr_executing,thethread);
@@ -768,6 +784,8 @@ void __lwp_thread_startmultitasking(void)
 	kprintf("__lwp_start_multitasking(%p,%p)\n",_thr_executing,_thr_heir);
 #endif
 	__lwp_thread_starttimeslice();
+	_thr_heir->switch_time = gettime();
+	_thr_heir->switch_cnt++;
 	_cpu_context_switch((void*)&core_context,(void*)&_thr_heir->context);
 
 	if(_lwp_exitfunc) _lwp_exitfunc();
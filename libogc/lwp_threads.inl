@@ -54,6 +54,21 @@ distribution.
 #ifndef __OGC_LWP_THREADS_INL__
 #define __OGC_LWP_THREADS_INL__
 
+/* callers run with interrupts disabled, which makes claiming the slot atomic */
+static __inline__ void __lwp_trace_record(u32 type,u32 arg0,u32 arg1)
+{
+	lwp_traceevt *evt;
+
+	if(!_lwp_trace_buf) return;
+
+	evt = &_lwp_trace_buf[_lwp_trace_head&_lwp_trace_mask];
+	_lwp_trace_head++;
+	evt->time = gettime();
+	evt->type = type;
+	evt->arg0 = arg0;
+	evt->arg1 = arg1;
+}
+
 static __inline__ u32 __lwp_thread_isexec(lwp_cntrl *thethread)
 {
 	return (thethread==_thr_executing);
@@ -0,0 +1,171 @@
+/*-------------------------------------------------------------
+
+lwp_trace.c -- Scheduler trace recording and export
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "asm.h"
+#include "processor.h"
+#include "lwp_threads.h"
+#include "usbgecko.h"
+#include "lwp.h"
+
+/* events from interrupt handlers are shown on their own track */
+#define TRACE_IRQ_TID			0x10000
+
+static lwp_traceevt *trace_events = NULL;
+static u32 trace_count = 0;
+
+s32 LWP_TraceStart(lwp_traceevt *buffer,u32 count)
+{
+	u32 level;
+
+	if(!buffer || count==0 || (count&(count - 1))) return EINVAL;
+
+	_CPU_ISR_Disable(level);
+	trace_events = buffer;
+	trace_count = count;
+	_lwp_trace_head = 0;
+	_lwp_trace_mask = (count - 1);
+	_lwp_trace_buf = buffer;
+	_CPU_ISR_Restore(level);
+
+	return 0;
+}
+
+void LWP_TraceStop(void)
+{
+	u32 level;
+
+	_CPU_ISR_Disable(level);
+	_lwp_trace_buf = NULL;
+	_CPU_ISR_Restore(level);
+}
+
+static s32 __lwp_trace_emit(lwp_tracewrite writefn,void *usrdata,const char *data,u32 len)
+{
+	s32 ret;
+
+	while(len>0) {
+		ret = writefn(data,len,usrdata);
+		if(ret<=0) return -1;
+
+		data += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+s32 LWP_TraceExport(lwp_tracewrite writefn,void *usrdata)
+{
+	s32 len;
+	u32 i,first,head;
+	u64 t0,ns;
+	char line[192];
+	const char *sep;
+	lwp_traceevt *evt;
+
+	if(!writefn || !trace_events) return EINVAL;
+
+	LWP_TraceStop();
+
+	head = _lwp_trace_head;
+	first = (head>trace_count) ? (head - trace_count) : 0;
+	t0 = (first<head) ? trace_events[first&(trace_count - 1)].time : 0;
+
+	len = snprintf(line,sizeof(line),"{\"traceEvents\":[\n"
+				   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"IRQ\"}}",TRACE_IRQ_TID);
+	if(__lwp_trace_emit(writefn,usrdata,line,len)<0) return EIO;
+
+	sep = ",\n";
+	for(i=first;i!=head;i++) {
+		evt = &trace_events[i&(trace_count - 1)];
+		ns = ticks_to_nanosecs(diff_ticks(t0,evt->time));
+
+		switch(evt->type) {
+			case LWP_TRACE_DISPATCH:
+				len = snprintf(line,sizeof(line),"%s{\"name\":\"run\",\"ph\":\"E\",\"pid\":0,\"tid\":%u,\"ts\":%llu.%03u}"
+							   ",\n{\"name\":\"run\",\"ph\":\"B\",\"pid\":0,\"tid\":%u,\"ts\":%llu.%03u}",
+							   sep,evt->arg0,ns/1000,(u32)(ns%1000),evt->arg1,ns/1000,(u32)(ns%1000));
+				break;
+			case LWP_TRACE_BLOCK:
+				len = snprintf(line,sizeof(line),"%s{\"name\":\"block\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%llu.%03u,\"args\":{\"state\":\"0x%x\"}}",
+							   sep,evt->arg0,ns/1000,(u32)(ns%1000),evt->arg1);
+				break;
+			case LWP_TRACE_UNBLOCK:
+				len = snprintf(line,sizeof(line),"%s{\"name\":\"unblock\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":%u,\"ts\":%llu.%03u}",
+							   sep,evt->arg0,ns/1000,(u32)(ns%1000));
+				break;
+			case LWP_TRACE_IRQENTER:
+			case LWP_TRACE_IRQEXIT:
+				len = snprintf(line,sizeof(line),"%s{\"name\":\"irq %u\",\"ph\":\"%c\",\"pid\":0,\"tid\":%u,\"ts\":%llu.%03u}",
+							   sep,evt->arg0,(evt->type==LWP_TRACE_IRQENTER ? 'B' : 'E'),TRACE_IRQ_TID,ns/1000,(u32)(ns%1000));
+				break;
+			default:
+				continue;
+		}
+		if(__lwp_trace_emit(writefn,usrdata,line,len)<0) return EIO;
+	}
+
+	if(__lwp_trace_emit(writefn,usrdata,"\n]}\n",4)<0) return EIO;
+	return 0;
+}
+
+static s32 __lwp_trace_filewrite(const char *data,u32 len,void *usrdata)
+{
+	return fwrite(data,1,len,(FILE*)usrdata);
+}
+
+s32 LWP_TraceExportFile(const char *filename)
+{
+	s32 ret;
+	FILE *fp;
+
+	if(!filename) return EINVAL;
+
+	fp = fopen(filename,"wb");
+	if(!fp) return errno;
+
+	ret = LWP_TraceExport(__lwp_trace_filewrite,fp);
+	if(fclose(fp)!=0 && ret==0) ret = EIO;
+
+	return ret;
+}
+
+static s32 __lwp_trace_geckowrite(const char *data,u32 len,void *usrdata)
+{
+	return usb_sendbuffer_safe((s32)usrdata,data,len);
+}
+
+s32 LWP_TraceExportUSBGecko(s32 chn)
+{
+	return LWP_TraceExport(__lwp_trace_geckowrite,(void*)chn);
+}
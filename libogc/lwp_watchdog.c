@@ -63,11 +63,9 @@ distribution.
 #include <stdio.h>
 #endif
 
-vu32 _wd_sync_level;
-vu32 _wd_sync_count;
 u32 _wd_ticks_since_boot;
 
-lwp_queue _wd_ticks_queue;
+wd_queue _wd_ticks_queue;
 
 static void __lwp_wd_settimer(wd_cntrl *wd)
 {
@@ -102,60 +100,111 @@ static void __lwp_wd_settimer(wd_cntrl *wd)
 	}
 }
 
+static wd_cntrl* __lwp_wd_meld(wd_cntrl *a,wd_cntrl *b)
+{
+	wd_cntrl *t;
+
+	if(!a) return b;
+	if(!b) return a;
+
+	/* on equal fire times the watchdog already queued stays in front */
+	if(b->fire<a->fire) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	b->prev = a;
+	b->sibling = a->child;
+	if(a->child) a->child->prev = b;
+	a->child = b;
+
+	return a;
+}
+
+static wd_cntrl* __lwp_wd_combine(wd_cntrl *first)
+{
+	wd_cntrl *a,*b,*next,*list;
+
+	if(!first) return NULL;
+
+	/* pass one: meld pairs left to right, stacking the results */
+	list = NULL;
+	while(first) {
+		a = first;
+		b = a->sibling;
+		next = b ? b->sibling : NULL;
+
+		a->sibling = NULL;
+		if(b) {
+			b->sibling = NULL;
+			a = __lwp_wd_meld(a,b);
+		}
+		a->sibling = list;
+		list = a;
+		first = next;
+	}
+
+	/* pass two: meld the stack back right to left */
+	a = list;
+	list = a->sibling;
+	a->sibling = NULL;
+	while(list) {
+		next = list->sibling;
+		list->sibling = NULL;
+		a = __lwp_wd_meld(a,list);
+		list = next;
+	}
+	a->prev = NULL;
+
+	return a;
+}
+
+static void __lwp_wd_extract(wd_queue *header,wd_cntrl *wd)
+{
+	wd_cntrl *sub;
+
+	if(header->root==wd) {
+		header->root = __lwp_wd_combine(wd->child);
+	} else {
+		if(wd->prev->child==wd)
+			wd->prev->child = wd->sibling;
+		else
+			wd->prev->sibling = wd->sibling;
+		if(wd->sibling) wd->sibling->prev = wd->prev;
+
+		sub = __lwp_wd_combine(wd->child);
+		header->root = __lwp_wd_meld(header->root,sub);
+	}
+	wd->child = wd->sibling = wd->prev = NULL;
+}
+
 void __lwp_watchdog_init(void)
 {
-	_wd_sync_level = 0;
-	_wd_sync_count = 0;
 	_wd_ticks_since_boot = 0;
 
-	__lwp_queue_init_empty(&_wd_ticks_queue);
+	_wd_ticks_queue.root = NULL;
 }
 
-void __lwp_wd_insert(lwp_queue *header,wd_cntrl *wd)
+void __lwp_wd_insert(wd_queue *header,wd_cntrl *wd)
 {
 	u32 level;
-	u64 fire;
-	u32 isr_nest_level;
-	wd_cntrl *after;
 #ifdef _LWPWD_DEBUG
 	printf("__lwp_wd_insert(%p,%llu,%llu)\n",wd,wd->start,wd->fire);
 #endif
-	isr_nest_level = __lwp_isr_in_progress();
-	wd->state = LWP_WD_INSERTED;
-
-	_wd_sync_count++;
-restart:
 	_CPU_ISR_Disable(level);
-	fire = wd->fire;
-	for(after=__lwp_wd_first(header);;after=__lwp_wd_next(after)) {
-		if(fire==0 || !__lwp_wd_next(after)) break;
-		if(fire<after->fire) break;
-
-		_CPU_ISR_Flash(level);
-		if(wd->state!=LWP_WD_INSERTED) goto exit_insert;
-		if(_wd_sync_level>isr_nest_level) {
-			_wd_sync_level = isr_nest_level;
-			_CPU_ISR_Restore(level);
-			goto restart;
-		}
-	}
+	wd->child = wd->sibling = wd->prev = NULL;
 	__lwp_wd_activate(wd);
-	wd->fire = fire;
-	__lwp_queue_insertI(after->node.prev,&wd->node);
-	if(__lwp_wd_first(header)==wd) __lwp_wd_settimer(wd);
-
-exit_insert:
-	_wd_sync_level = isr_nest_level;
-	_wd_sync_count--;
+	header->root = __lwp_wd_meld(header->root,wd);
+	if(header->root==wd) __lwp_wd_settimer(wd);
 	_CPU_ISR_Restore(level);
-	return;
 }
 
-u32 __lwp_wd_remove(lwp_queue *header,wd_cntrl *wd)
+u32 __lwp_wd_remove(wd_queue *header,wd_cntrl *wd)
 {
 	u32 level;
 	u32 prev_state;
-	wd_cntrl *next;
+	u32 was_first;
 #ifdef _LWPWD_DEBUG
 	printf("__lwp_wd_remove(%p)\n",wd);
 #endif
@@ -170,23 +219,22 @@ u32 __lwp_wd_remove(lwp_queue *header,wd_cntrl *wd)
 		case LWP_WD_ACTIVE:
 		case LWP_WD_REMOVE:
 			wd->state = LWP_WD_INACTIVE;
-			next = __lwp_wd_next(wd);
-			if(_wd_sync_count) _wd_sync_level = __lwp_isr_in_progress();
-			__lwp_queue_extractI(&wd->node);
-			if(!__lwp_queue_isempty(header) && __lwp_wd_first(header)==next) __lwp_wd_settimer(next);
+			was_first = (header->root==wd);
+			__lwp_wd_extract(header,wd);
+			if(was_first && !__lwp_wd_isempty(header)) __lwp_wd_settimer(__lwp_wd_first(header));
 			break;
 	}
 	_CPU_ISR_Restore(level);
 	return prev_state;
 }
 
-void __lwp_wd_tickle(lwp_queue *queue)
+void __lwp_wd_tickle(wd_queue *queue)
 {
 	wd_cntrl *wd;
 	u64 now;
 	s64 diff;
 
-	if(__lwp_queue_isempty(queue)) return;
+	if(__lwp_wd_isempty(queue)) return;
 
 	wd = __lwp_wd_first(queue);
 	now = __SYS_GetSystemTime();
@@ -208,34 +256,41 @@ void __lwp_wd_tickle(lwp_queue *queue)
 					break;
 			}
 			wd = __lwp_wd_first(queue);
-		} while(!__lwp_queue_isempty(queue) && wd->fire==0);
+		} while(!__lwp_wd_isempty(queue) && wd->fire==0);
 	} else {
 		__lwp_wd_reset(wd);
 	}
 }
 
-void __lwp_wd_adjust(lwp_queue *queue,u32 dir,s64 interval)
+void __lwp_wd_adjust(wd_queue *queue,u32 dir,s64 interval)
 {
 	u32 level;
 	u64 abs_int;
+	wd_cntrl *wd;
 
 	_CPU_ISR_Disable(level);
 	abs_int = __SYS_GetSystemTime()+LWP_WD_ABS(interval);
-	if(!__lwp_queue_isempty(queue)) {
+	if(!__lwp_wd_isempty(queue)) {
 		switch(dir) {
 			case LWP_WD_BACKWARD:
-				__lwp_wd_first(queue)->fire += LWP_WD_ABS(interval);
+				wd = __lwp_wd_first(queue);
+				__lwp_wd_extract(queue,wd);
+				wd->fire += LWP_WD_ABS(interval);
+				queue->root = __lwp_wd_meld(queue->root,wd);
+				__lwp_wd_settimer(__lwp_wd_first(queue));
 				break;
 			case LWP_WD_FORWARD:
 				while(abs_int) {
-					if(abs_int<__lwp_wd_first(queue)->fire) {
-						__lwp_wd_first(queue)->fire -= LWP_WD_ABS(interval);
+					wd = __lwp_wd_first(queue);
+					if(abs_int<wd->fire) {
+						wd->fire -= LWP_WD_ABS(interval);
+						__lwp_wd_settimer(wd);
 						break;
 					} else {
-						abs_int -= __lwp_wd_first(queue)->fire;
-						__lwp_wd_first(queue)->fire = __SYS_GetSystemTime();
+						abs_int -= wd->fire;
+						wd->fire = __SYS_GetSystemTime();
 						__lwp_wd_tickle(queue);
-						if(__lwp_queue_isempty(queue)) break;
+						if(__lwp_wd_isempty(queue)) break;
 					}
 				}
 				break;
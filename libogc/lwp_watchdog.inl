@@ -62,24 +62,14 @@ static __inline__ void __lwp_wd_initialize(wd_cntrl *wd,wd_service_routine routi
 	wd->usr_data = usr_data;
 }
 
-static __inline__ wd_cntrl* __lwp_wd_first(lwp_queue *queue)
+static __inline__ wd_cntrl* __lwp_wd_first(wd_queue *queue)
 {
-	return (wd_cntrl*)queue->first;
+	return queue->root;
 }
 
-static __inline__ wd_cntrl* __lwp_wd_last(lwp_queue *queue)
+static __inline__ bool __lwp_wd_isempty(wd_queue *queue)
 {
-	return (wd_cntrl*)queue->last;
-}
-
-static __inline__ wd_cntrl* __lwp_wd_next(wd_cntrl *wd)
-{
-	return (wd_cntrl*)wd->node.next;
-}
-
-static __inline__ wd_cntrl* __lwp_wd_prev(wd_cntrl *wd)
-{
-	return (wd_cntrl*)wd->node.prev;
+	return (queue->root==NULL);
 }
 
 static __inline__ void __lwp_wd_activate(wd_cntrl *wd)
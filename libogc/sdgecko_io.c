@@ -81,7 +81,7 @@ static bool _ioCardInserted[MAX_DRIVE];
 
 static u8 _ioResponse[MAX_DRIVE][128];
 static u8 _ioCrc7Table[256];
-static u16 _ioCrc16Table[2][256];
+static u16 _ioCrc16Table[4][256];
 
 // SDHC support
 static u32 _initType[MAX_DRIVE];
@@ -181,24 +181,32 @@ static void __init_crc16(void)
 		_ioCrc16Table[0][i] = crc16;
 	}
 
-	for(i=0;i<256;i++) {
-		crc16 = _ioCrc16Table[0][i];
-		crc16 = _ioCrc16Table[0][crc16>>8]^(crc16<<8);
-		_ioCrc16Table[1][i] = crc16;
+	for(j=1;j<4;j++) {
+		for(i=0;i<256;i++) {
+			crc16 = _ioCrc16Table[j-1][i];
+			crc16 = _ioCrc16Table[0][crc16>>8]^(crc16<<8);
+			_ioCrc16Table[j][i] = crc16;
+		}
 	}
 }
 
+// slicing-by-4, one 32-bit word per step
 static u16 __make_crc16(void *buffer,u32 len)
 {
 	s32 i;
-	u16 crc16;
-	u16 *ptr;
+	u32 crc16,val;
+	u32 *ptr;
 
 	crc16 = 0;
-	len /= 2;
 	ptr = buffer;
-	for(i=0;i<len;i++) {
-		crc16 ^= ptr[i];
+	for(i=0;i<len/4;i++) {
+		val = ptr[i];
+		crc16 ^= val>>16;
+		crc16 = _ioCrc16Table[3][crc16>>8]^_ioCrc16Table[2][crc16&0xff]^
+				_ioCrc16Table[1][(val>>8)&0xff]^_ioCrc16Table[0][val&0xff];
+	}
+	if(len&2) {
+		crc16 ^= *(u16*)&ptr[i];
 		crc16 = _ioCrc16Table[1][crc16>>8]^_ioCrc16Table[0][crc16&0xff];
 	}
 	return crc16;
@@ -614,10 +622,14 @@ static s32 __card_dataresponse(s32 drv_no)
 	return ret;
 }
 
-static s32 __card_dataread(s32 drv_no,void *buf,u32 len)
+/* Reads one data block and returns its CRC in *crc. If prev_buf is given,
+ * *crc holds the CRC received for it on entry and prev_buf is checked
+ * while the DMA for buf is in flight.
+ */
+static s32 __card_datareadex(s32 drv_no,void *buf,u32 len,void *prev_buf,u16 *crc)
 {
 	u8 *ptr;
-	u16 crc,crc_org;
+	u16 crc_org;
 	s32 startT,ret;
 
 	if(drv_no<0 || drv_no>=MAX_DRIVE) return CARDIO_ERROR_NOCARD;
@@ -667,7 +679,21 @@ static s32 __card_dataread(s32 drv_no,void *buf,u32 len)
 		}
 	}
 
-	if(_ioTransferMode[drv_no]==CARDIO_TRANSFER_DMA) {
+	if(_ioTransferMode[drv_no]==CARDIO_TRANSFER_DMA && prev_buf && !((u32)ptr&0x1f) && !(len&0x1f)) {
+		DCInvalidateRange(ptr,len);
+		if(EXI_Dma(drv_no,ptr,len,EXI_READ,NULL)==0) {
+			EXI_Deselect(drv_no);
+			EXI_Unlock(drv_no);
+			return CARDIO_ERROR_IOERROR;
+		}
+		if(__make_crc16(prev_buf,len)!=*crc) ret = CARDIO_OP_IOERR_CRC;
+		prev_buf = NULL;
+		if(EXI_Sync(drv_no)==0) {
+			EXI_Deselect(drv_no);
+			EXI_Unlock(drv_no);
+			return CARDIO_ERROR_IOERROR;
+		}
+	} else if(_ioTransferMode[drv_no]==CARDIO_TRANSFER_DMA) {
 		if(EXI_DmaEx(drv_no,ptr,len,EXI_READ)==0) {
 			EXI_Deselect(drv_no);
 			EXI_Unlock(drv_no);
@@ -694,6 +720,19 @@ static s32 __card_dataread(s32 drv_no,void *buf,u32 len)
 	EXI_Deselect(drv_no);
 	EXI_Unlock(drv_no);
 
+	if(prev_buf && __make_crc16(prev_buf,len)!=*crc) ret = CARDIO_OP_IOERR_CRC;
+	*crc = crc_org;
+	return ret;
+}
+
+static s32 __card_dataread(s32 drv_no,void *buf,u32 len)
+{
+	u16 crc,crc_org;
+	s32 ret;
+
+	ret = __card_datareadex(drv_no,buf,len,NULL,&crc_org);
+	if(ret==CARDIO_ERROR_NOCARD || ret==CARDIO_ERROR_IOERROR) return ret;
+
 	crc = __make_crc16(buf,len);
 	if(crc!=crc_org) ret = CARDIO_OP_IOERR_CRC;
 #ifdef _CARDIO_DEBUG
@@ -1420,9 +1459,11 @@ s32 sdgecko_readSector(s32 drv_no,void *buf,u32 sector_no)
 s32 sdgecko_readSectors(s32 drv_no,u32 sector_no,u32 num_sectors,void *buf)
 {
 	u32 i;
+	u16 crc;
 	s32 ret,ret2;
 	u8 arg[4] = {0,0,0,0};
 	char *ptr = (char*)buf;
+	char *prev = NULL;
 
 	if(drv_no<0 || drv_no>=MAX_DRIVE) return CARDIO_ERROR_NOCARD;
 
@@ -1447,15 +1488,19 @@ s32 sdgecko_readSectors(s32 drv_no,u32 sector_no,u32 num_sectors,void *buf)
 		if((ret=__card_response1(drv_no))!=0) return ret;
 	}
 
+	// the CRC of each block is verified while the next one is transferred
 	for(i=0;i<num_sectors;i++) {
-		if((ret=__card_dataread(drv_no,ptr,_ioPageSize[drv_no]))!=0) {
-			if((ret2=__card_sendcmd(drv_no,0x0C,NULL))!=0) return ret2;
-			if((ret2=__card_stopresponse(drv_no))!=0) return ret2;
-			return ret;
-		}
+		if((ret=__card_datareadex(drv_no,ptr,_ioPageSize[drv_no],prev,&crc))!=0) break;
+		prev = ptr;
 		ptr += _ioPageSize[drv_no];
 		sector_no++;
 	}
+	if(ret==0 && __make_crc16(prev,_ioPageSize[drv_no])!=crc) ret = CARDIO_OP_IOERR_CRC;
+	if(ret!=0) {
+		if((ret2=__card_sendcmd(drv_no,0x0C,NULL))!=0) return ret2;
+		if((ret2=__card_stopresponse(drv_no))!=0) return ret2;
+		return ret;
+	}
 	_ioReadSector[drv_no] = sector_no;
 	return ret;
 }
@@ -77,9 +77,11 @@ typedef struct _sema_st
 
 lwp_objinfo _lwp_sema_objects;
 
+u32 __attribute__((weak)) __lwp_limit_semas = LWP_LIMIT_SEMAS;
+
 void __lwp_sema_init(void)
 {
-	__lwp_objmgr_initinfo(&_lwp_sema_objects,LWP_MAX_SEMAS,sizeof(sema_st));
+	__lwp_objmgr_initinfoex(&_lwp_sema_objects,LWP_MAX_SEMAS,__lwp_limit_semas,sizeof(sema_st));
 }
 
 static __inline__ sema_st* __lwp_sema_open(sem_t sem)
@@ -48,6 +48,7 @@ distribution.
 #include "wiilaunch.h"
 #endif
 #include "cache.h"
+#include "szp.h"
 #include "video.h"
 #include "system.h"
 #include "sys_state.h"
@@ -89,13 +90,6 @@ struct _sramcntrl {
 	s32 sync;
 } sramcntrl ATTRIBUTE_ALIGN(32);
 
-typedef struct _yay0header {
-	unsigned int id ATTRIBUTE_PACKED;
-	unsigned int dec_size ATTRIBUTE_PACKED;
-	unsigned int links_offset ATTRIBUTE_PACKED;
-	unsigned int chunks_offset ATTRIBUTE_PACKED;
-} yay0header;
-
 static u16 sys_fontenc = 0xffff;
 static u32 sys_fontcharsinsheet = 0;
 static u8 *sys_fontwidthtab = NULL;
@@ -757,55 +751,6 @@ void __dsp_shutdown(void)
 	while(_dspReg[5]&DSPCR_RES);
 }
 
-static void decode_szp(void *src,void *dest)
-{
-	u32 i,k,link;
-	u8 *dest8,*tmp;
-	u32 loff,coff,roff;
-	u32 size,cnt,cmask,bcnt;
-	yay0header *header;
-
-	dest8 = (u8*)dest;
-	header = (yay0header*)src;
-	size = header->dec_size;
-	loff = header->links_offset;
-	coff = header->chunks_offset;
-
-	roff = sizeof(yay0header);
-	cmask = 0;
-	cnt = 0;
-	bcnt = 0;
-
-	do {
-		if(!bcnt) {
-			cmask = *(u32*)(src+roff);
-			roff += 4;
-			bcnt = 32;
-		}
-
-		if(cmask&0x80000000) {
-			dest8[cnt++] = *(u8*)(src+coff);
-			coff++;
-		} else {
-			link = *(u16*)(src+loff);
-			loff += 2;
-
-			tmp = dest8+(cnt-(link&0x0fff)-1);
-			k = link>>12;
-			if(k==0) {
-				k = (*(u8*)(src+coff))+18;
-				coff++;
-			} else k += 2;
-
-			for(i=0;i<k;i++) {
-				dest8[cnt++] = tmp[i];
-			}
-		}
-		cmask <<= 1;
-		bcnt--;
-	} while(cnt<size);
-}
-
 syssram* __SYS_LockSram(void)
 {
 	return (syssram*)__locksram(0);
@@ -950,7 +895,7 @@ u32 __SYS_LoadFont(void *src,void *dest)
 {
 	if(__read_font(src)==0) return 0;
 
-	decode_szp(src,dest);
+	SZP_Decompress(src,dest);
 
 	sys_fontdata = (sys_fontheader*)dest;
 	sys_fontwidthtab = (u8*)dest+sys_fontdata->width_table;
@@ -79,11 +79,13 @@ typedef struct _alarm_st
 	void *cb_arg;
 } alarm_st;
 
-static lwp_objinfo sys_alarm_objects;
+lwp_objinfo sys_alarm_objects;
+
+u32 __attribute__((weak)) __lwp_limit_watchdogs = LWP_LIMIT_WATCHDOGS;
 
 void __lwp_syswd_init(void)
 {
-	__lwp_objmgr_initinfo(&sys_alarm_objects,LWP_MAX_WATCHDOGS,sizeof(alarm_st));
+	__lwp_objmgr_initinfoex(&sys_alarm_objects,LWP_MAX_WATCHDOGS,__lwp_limit_watchdogs,sizeof(alarm_st));
 }
 
 static __inline__ alarm_st* __lwp_syswd_open(syswd_t wd)
@@ -0,0 +1,341 @@
+/*-------------------------------------------------------------
+
+szp.c -- Yay0/Yaz0 decompression
+
+Copyright (C) 2004 - 2025
+Michael Wiedenbauer (shagkur)
+Dave Murphy (WinterMute)
+Extrems' Corner.org
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1.	The origin of this software must not be misrepresented; you
+must not claim that you wrote the original software. If you use
+this software in a product, an acknowledgment in the product
+documentation would be appreciated but is not required.
+
+2.	Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3.	This notice may not be removed or altered from any source
+distribution.
+
+-------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "asm.h"
+#include "processor.h"
+#include "cache.h"
+#include "arqueue.h"
+#include "szp.h"
+
+#define SZP_HEADERSIZE			16
+#define SZP_MAGIC_YAY0			0x59617930
+#define SZP_MAGIC_YAZ0			0x59617A30
+#define SZP_ARQOWNER			0x535A5000
+#define ROUNDUP32(x)			(((u32)(x)+0x1f)&~0x1f)
+
+static __inline__ u32 __szp_read32(const u8 *p)
+{
+	return ((u32)p[0]<<24)|((u32)p[1]<<16)|((u32)p[2]<<8)|(u32)p[3];
+}
+
+static s32 __szp_format(const u8 *header)
+{
+	u32 magic = __szp_read32(header);
+
+	if(magic==SZP_MAGIC_YAY0) return SZP_FORMAT_YAY0;
+	if(magic==SZP_MAGIC_YAZ0) return SZP_FORMAT_YAZ0;
+	return SZP_ERROR_FORMAT;
+}
+
+/* copies a back-reference of len bytes from dist bytes behind dst. runs
+ * that don't overlap their source, or do so at least a word apart, are
+ * moved in blocks instead of byte by byte.
+ */
+static __inline__ void __szp_copy(u8 *dst,u32 dist,u32 len)
+{
+	const u8 *src = dst - dist;
+
+	if(dist>=len) memcpy(dst,src,len);
+	else if(dist==1) memset(dst,*src,len);
+	else if(dist>=4) {
+		while(len>dist) {
+			memcpy(dst,src,dist);
+			dst += dist;
+			len -= dist;
+		}
+		memcpy(dst,dst - dist,len);
+	} else {
+		while(len--) {
+			*dst = *src++;
+			dst++;
+		}
+	}
+}
+
+s32 SZP_GetDecodedSize(const void *src)
+{
+	if(__szp_format(src)<0) return SZP_ERROR_FORMAT;
+	return __szp_read32((const u8*)src + 4);
+}
+
+s32 SZP_Decompress(const void *src,void *dest)
+{
+	s32 format;
+	u32 mask,bits,link,dist,cnt,size;
+	const u8 *code,*links,*chunks;
+	u8 *out,*end;
+
+	format = __szp_format(src);
+	if(format<0) return SZP_ERROR_FORMAT;
+
+	size = __szp_read32((const u8*)src + 4);
+	out = dest;
+	end = out + size;
+	code = (const u8*)src + SZP_HEADERSIZE;
+
+	mask = 0;
+	bits = 0;
+	if(format==SZP_FORMAT_YAY0) {
+		links = (const u8*)src + __szp_read32((const u8*)src + 8);
+		chunks = (const u8*)src + __szp_read32((const u8*)src + 12);
+
+		while(out<end) {
+			if(!bits) {
+				mask = __szp_read32(code);
+				code += 4;
+				bits = 32;
+			}
+
+			if(mask&0x80000000) *out++ = *chunks++;
+			else {
+				link = (links[0]<<8)|links[1];
+				links += 2;
+
+				dist = (link&0x0fff) + 1;
+				cnt = link>>12;
+				cnt = cnt ? (cnt + 2) : (*chunks++ + 18);
+
+				if(dist>(u32)(out - (u8*)dest)) return SZP_ERROR_DATA;
+				if(cnt>(u32)(end - out)) cnt = end - out;
+				__szp_copy(out,dist,cnt);
+				out += cnt;
+			}
+			mask <<= 1;
+			bits--;
+		}
+	} else {
+		while(out<end) {
+			if(!bits) {
+				mask = (u32)(*code++)<<24;
+				bits = 8;
+			}
+
+			if(mask&0x80000000) *out++ = *code++;
+			else {
+				link = (code[0]<<8)|code[1];
+				code += 2;
+
+				dist = (link&0x0fff) + 1;
+				cnt = link>>12;
+				cnt = cnt ? (cnt + 2) : (*code++ + 18);
+
+				if(dist>(u32)(out - (u8*)dest)) return SZP_ERROR_DATA;
+				if(cnt>(u32)(end - out)) cnt = end - out;
+				__szp_copy(out,dist,cnt);
+				out += cnt;
+			}
+			mask <<= 1;
+			bits--;
+		}
+	}
+	return size;
+}
+
+static void __szp_streaminit(szpstream *stream,u32 offset)
+{
+	stream->offset = offset;
+	stream->pos = 0;
+	stream->len = 0;
+}
+
+static s32 __szp_refill(szpdecoder *dec,szpstream *stream)
+{
+	s32 ret;
+
+	ret = dec->reader(dec->usrdata,stream->offset,stream->buf,SZP_STREAMBUFSIZE);
+	if(ret<=0 || ret>SZP_STREAMBUFSIZE) return SZP_ERROR_READ;
+
+	stream->offset += ret;
+	stream->pos = 0;
+	stream->len = ret;
+	return ret;
+}
+
+static __inline__ s32 __szp_getbyte(szpdecoder *dec,szpstream *stream)
+{
+	if(stream->pos==stream->len && __szp_refill(dec,stream)<0) return SZP_ERROR_READ;
+	return stream->buf[stream->pos++];
+}
+
+s32 SZP_Init(szpdecoder *dec,szpreadcb reader,void *usrdata)
+{
+	s32 ret,format;
+	u8 *header;
+
+	if(!dec || !reader) return SZP_ERROR_FORMAT;
+
+	dec->reader = reader;
+	dec->usrdata = usrdata;
+
+	// the header is read through the code stream, which then starts right behind it
+	header = dec->code.buf;
+	ret = reader(usrdata,0,header,SZP_HEADERSIZE);
+	if(ret!=SZP_HEADERSIZE) return SZP_ERROR_READ;
+
+	format = __szp_format(header);
+	if(format<0) return SZP_ERROR_FORMAT;
+
+	dec->format = format;
+	dec->dec_size = __szp_read32(header + 4);
+	dec->out_pos = 0;
+	dec->mask = 0;
+	dec->mask_bits = 0;
+	dec->copy_len = 0;
+	dec->copy_dist = 0;
+
+	__szp_streaminit(&dec->code,SZP_HEADERSIZE);
+	if(format==SZP_FORMAT_YAY0) {
+		__szp_streaminit(&dec->links,__szp_read32(header + 8));
+		__szp_streaminit(&dec->chunks,__szp_read32(header + 12));
+	}
+	return dec->dec_size;
+}
+
+/* copies part of a back-reference. history older than this call's output
+ * sits at the end of the window, newer history is in dest itself.
+ */
+static void __szp_backref(szpdecoder *dec,u8 *dest,u8 *out,u32 len)
+{
+	s32 src;
+	u32 cnt;
+
+	src = (s32)(out - dest) - (s32)dec->copy_dist;
+	if(src<0) {
+		cnt = (u32)-src;
+		if(cnt>len) cnt = len;
+
+		memcpy(out,dec->window + SZP_WINDOWSIZE + src,cnt);
+		out += cnt;
+		len -= cnt;
+	}
+	if(len) __szp_copy(out,dec->copy_dist,len);
+}
+
+s32 SZP_Decode(szpdecoder *dec,void *dest,u32 len)
+{
+	s32 val,lo;
+	u32 link,cnt,produced;
+	u8 *out,*end;
+	szpstream *literals,*links;
+
+	if(len>(dec->dec_size - dec->out_pos)) len = dec->dec_size - dec->out_pos;
+	if(!len) return 0;
+
+	out = dest;
+	end = out + len;
+	literals = (dec->format==SZP_FORMAT_YAY0) ? &dec->chunks : &dec->code;
+	links = (dec->format==SZP_FORMAT_YAY0) ? &dec->links : &dec->code;
+
+	while(out<end) {
+		if(dec->copy_len) {
+			cnt = end - out;
+			if(cnt>dec->copy_len) cnt = dec->copy_len;
+
+			__szp_backref(dec,dest,out,cnt);
+			out += cnt;
+			dec->copy_len -= cnt;
+			continue;
+		}
+
+		if(!dec->mask_bits) {
+			if(dec->format==SZP_FORMAT_YAY0) {
+				if((val=__szp_getbyte(dec,&dec->code))<0) return val;
+				dec->mask = (u32)val<<24;
+				if((val=__szp_getbyte(dec,&dec->code))<0) return val;
+				dec->mask |= (u32)val<<16;
+				if((val=__szp_getbyte(dec,&dec->code))<0) return val;
+				dec->mask |= val<<8;
+				if((val=__szp_getbyte(dec,&dec->code))<0) return val;
+				dec->mask |= val;
+				dec->mask_bits = 32;
+			} else {
+				if((val=__szp_getbyte(dec,&dec->code))<0) return val;
+				dec->mask = (u32)val<<24;
+				dec->mask_bits = 8;
+			}
+		}
+
+		if(dec->mask&0x80000000) {
+			if((val=__szp_getbyte(dec,literals))<0) return val;
+			*out++ = val;
+		} else {
+			if((val=__szp_getbyte(dec,links))<0) return val;
+			if((lo=__szp_getbyte(dec,links))<0) return lo;
+			link = (val<<8)|lo;
+
+			cnt = link>>12;
+			if(!cnt) {
+				if((val=__szp_getbyte(dec,literals))<0) return val;
+				cnt = val + 18;
+			} else cnt += 2;
+
+			dec->copy_dist = (link&0x0fff) + 1;
+			if(dec->copy_dist>(dec->out_pos + (u32)(out - (u8*)dest))) return SZP_ERROR_DATA;
+			dec->copy_len = cnt;
+		}
+		dec->mask <<= 1;
+		dec->mask_bits--;
+	}
+
+	// a run running past the end of the data is cut short, as the one-shot decoder does
+	if(dec->out_pos + len==dec->dec_size) dec->copy_len = 0;
+
+	produced = len;
+	if(produced>=SZP_WINDOWSIZE) memcpy(dec->window,end - SZP_WINDOWSIZE,SZP_WINDOWSIZE);
+	else {
+		memmove(dec->window,dec->window + produced,SZP_WINDOWSIZE - produced);
+		memcpy(dec->window + SZP_WINDOWSIZE - produced,dest,produced);
+	}
+	dec->out_pos += produced;
+
+	return produced;
+}
+
+s32 SZP_DecodeToARAM(szpdecoder *dec,u32 aram_addr,void *staging,u32 staging_len)
+{
+	s32 ret,total;
+	ARQRequest req;
+
+	staging_len &= ~0x1f;
+	if(!staging_len || ((u32)staging)&0x1f || aram_addr&0x1f) return SZP_ERROR_DATA;
+
+	total = 0;
+	while((ret=SZP_Decode(dec,staging,staging_len))>0) {
+		DCFlushRange(staging,ROUNDUP32(ret));
+		ARQ_PostRequest(&req,SZP_ARQOWNER,ARQ_MRAMTOARAM,ARQ_PRIO_LO,aram_addr,(u32)staging,ROUNDUP32(ret));
+
+		aram_addr += ret;
+		total += ret;
+	}
+	return (ret<0) ? ret : total;
+}
@@ -29,9 +29,23 @@ distribution.
 
 -------------------------------------------------------------*/
 
+#include <stdlib.h>
+#include <string.h>
 #include <gctypes.h>
+#include <gx.h>
 #include <texconv.h>
 
+#define CMPR_OPAQUE_MASK		0xffff
+
+typedef struct _cmprblock {
+	s32 px[16][3];
+	u32 mask;
+	u32 count;
+} cmprblock;
+
+static const f32 _cmprWeights4[4] = {1.0f,0.0f,0.625f,0.375f};
+static const f32 _cmprWeights3[4] = {1.0f,0.0f,0.5f,0.0f};
+
 void MakeTexture565(const void *src,void *dst,s32 width,s32 height)
 {
 	register u32 tmp0=0,tmp1=0,tmp2=0,tmp3=0;
@@ -78,3 +92,538 @@ void MakeTexture565(const void *src,void *dst,s32 width,s32 height)
 		: "memory"
 	);
 }
+
+static inline void __texconv_st16(u8 *dst,u32 val)
+{
+	dst[0] = (u8)(val>>8);
+	dst[1] = (u8)val;
+}
+
+static inline const u8* __texconv_texel(const u8 *src,u32 width,u32 height,u32 x,u32 y)
+{
+	if(x>=width) x = width-1;
+	if(y>=height) y = height-1;
+	return src+((y*width+x)<<2);
+}
+
+static inline u32 __texconv_intensity(const u8 *p)
+{
+	return (p[0]*77+p[1]*150+p[2]*29+128)>>8;
+}
+
+static inline u32 __texconv_to4(u32 v)
+{
+	return (v*15+135)>>8;
+}
+
+static inline u32 __texconv_to5(u32 v)
+{
+	return (v*249+1024)>>11;
+}
+
+static inline u32 __texconv_to6(u32 v)
+{
+	return (v*253+512)>>10;
+}
+
+static inline u32 __texconv_rgb565(const u8 *p)
+{
+	return (__texconv_to5(p[0])<<11)|(__texconv_to6(p[1])<<5)|__texconv_to5(p[2]);
+}
+
+static inline u32 __texconv_rgb5a3(const u8 *p)
+{
+	u32 a = (p[3]*7+128)>>8;
+
+	if(a==7) return 0x8000|(__texconv_to5(p[0])<<10)|(__texconv_to5(p[1])<<5)|__texconv_to5(p[2]);
+	return (a<<12)|(__texconv_to4(p[0])<<8)|(__texconv_to4(p[1])<<4)|__texconv_to4(p[2]);
+}
+
+static u32 __texconv_tiledims(u32 fmt,u32 *tw,u32 *th)
+{
+	switch(fmt) {
+		case GX_TF_I4:
+		case GX_TF_CI4:
+		case GX_TF_CMPR:
+			*tw = 8; *th = 8;
+			return 32;
+		case GX_TF_I8:
+		case GX_TF_IA4:
+		case GX_TF_CI8:
+			*tw = 8; *th = 4;
+			return 32;
+		case GX_TF_IA8:
+		case GX_TF_RGB565:
+		case GX_TF_RGB5A3:
+		case GX_TF_CI14:
+			*tw = 4; *th = 4;
+			return 32;
+		case GX_TF_RGBA8:
+			*tw = 4; *th = 4;
+			return 64;
+	}
+	return 0;
+}
+
+static u32 __texconv_levelsize(u32 width,u32 height,u32 fmt)
+{
+	u32 tw,th,tsize;
+
+	tsize = __texconv_tiledims(fmt,&tw,&th);
+	return ((width+tw-1)/tw)*((height+th-1)/th)*tsize;
+}
+
+static inline u32 __cmpr_pack565(f32 r,f32 g,f32 b)
+{
+	s32 ir = (s32)(r+0.5f);
+	s32 ig = (s32)(g+0.5f);
+	s32 ib = (s32)(b+0.5f);
+
+	if(ir<0) ir = 0; else if(ir>255) ir = 255;
+	if(ig<0) ig = 0; else if(ig>255) ig = 255;
+	if(ib<0) ib = 0; else if(ib>255) ib = 255;
+	return (__texconv_to5(ir)<<11)|(__texconv_to6(ig)<<5)|__texconv_to5(ib);
+}
+
+static void __cmpr_palette(u32 c0,u32 c1,s32 pal[4][3])
+{
+	u32 i;
+
+	pal[0][0] = ((c0>>8)&0xf8)|(c0>>13);
+	pal[0][1] = ((c0>>3)&0xfc)|((c0>>9)&0x03);
+	pal[0][2] = ((c0<<3)&0xf8)|((c0>>2)&0x07);
+	pal[1][0] = ((c1>>8)&0xf8)|(c1>>13);
+	pal[1][1] = ((c1>>3)&0xfc)|((c1>>9)&0x03);
+	pal[1][2] = ((c1<<3)&0xf8)|((c1>>2)&0x07);
+
+	// the texture unit blends at 3/8 and 5/8 rather than thirds
+	for(i=0;i<3;i++) {
+		if(c0>c1) {
+			pal[2][i] = (pal[0][i]*5+pal[1][i]*3)>>3;
+			pal[3][i] = (pal[0][i]*3+pal[1][i]*5)>>3;
+		} else {
+			pal[2][i] = (pal[0][i]+pal[1][i])>>1;
+			pal[3][i] = pal[2][i];
+		}
+	}
+}
+
+static u32 __cmpr_indices(const cmprblock *blk,u32 c0,u32 c1,u32 *error)
+{
+	u32 i,j,idx,ncolors,word,err;
+	s32 pal[4][3];
+
+	__cmpr_palette(c0,c1,pal);
+	ncolors = (c0>c1) ? 4 : 3;
+
+	err = 0;
+	word = 0;
+	for(i=0;i<16;i++) {
+		idx = 3;
+		if(blk->mask&(1<<i)) {
+			u32 best = ~0;
+			for(j=0;j<ncolors;j++) {
+				s32 dr = blk->px[i][0]-pal[j][0];
+				s32 dg = blk->px[i][1]-pal[j][1];
+				s32 db = blk->px[i][2]-pal[j][2];
+				u32 d = dr*dr+dg*dg+db*db;
+				if(d<best) {
+					best = d;
+					idx = j;
+				}
+			}
+			err += best;
+		}
+		word = (word<<2)|idx;
+	}
+
+	*error = err;
+	return word;
+}
+
+static inline void __cmpr_order(u32 *c0,u32 *c1,u32 transparent)
+{
+	u32 tmp;
+
+	if(transparent ? (*c0>*c1) : (*c0<*c1)) {
+		tmp = *c0;
+		*c0 = *c1;
+		*c1 = tmp;
+	}
+}
+
+static void __cmpr_boundingbox(const cmprblock *blk,u32 *c0,u32 *c1)
+{
+	u32 i,j;
+	s32 mn[3],mx[3],mean[3],inset;
+	s32 covrg,covbg;
+
+	mn[0] = mn[1] = mn[2] = 255;
+	mx[0] = mx[1] = mx[2] = 0;
+	mean[0] = mean[1] = mean[2] = 0;
+	for(i=0;i<16;i++) {
+		if(!(blk->mask&(1<<i))) continue;
+		for(j=0;j<3;j++) {
+			if(blk->px[i][j]<mn[j]) mn[j] = blk->px[i][j];
+			if(blk->px[i][j]>mx[j]) mx[j] = blk->px[i][j];
+			mean[j] += blk->px[i][j];
+		}
+	}
+	for(j=0;j<3;j++) {
+		mean[j] /= (s32)blk->count;
+		inset = (mx[j]-mn[j])>>4;
+		mn[j] += inset;
+		mx[j] -= inset;
+	}
+
+	// pick the box diagonal that follows the correlation of red and blue with green
+	covrg = covbg = 0;
+	for(i=0;i<16;i++) {
+		if(!(blk->mask&(1<<i))) continue;
+		covrg += (blk->px[i][0]-mean[0])*(blk->px[i][1]-mean[1]);
+		covbg += (blk->px[i][2]-mean[2])*(blk->px[i][1]-mean[1]);
+	}
+	if(covrg<0) {
+		inset = mn[0]; mn[0] = mx[0]; mx[0] = inset;
+	}
+	if(covbg<0) {
+		inset = mn[2]; mn[2] = mx[2]; mx[2] = inset;
+	}
+
+	*c0 = __cmpr_pack565(mx[0],mx[1],mx[2]);
+	*c1 = __cmpr_pack565(mn[0],mn[1],mn[2]);
+}
+
+static void __cmpr_principalaxis(const cmprblock *blk,u32 *c0,u32 *c1)
+{
+	u32 i,j;
+	f32 mean[3],cov[6],axis[3],tmp[3];
+	f32 d,mind,maxd,scale;
+	s32 mini,maxi;
+
+	mean[0] = mean[1] = mean[2] = 0.0f;
+	for(i=0;i<16;i++) {
+		if(!(blk->mask&(1<<i))) continue;
+		mean[0] += blk->px[i][0];
+		mean[1] += blk->px[i][1];
+		mean[2] += blk->px[i][2];
+	}
+	scale = 1.0f/blk->count;
+	mean[0] *= scale;
+	mean[1] *= scale;
+	mean[2] *= scale;
+
+	for(j=0;j<6;j++) cov[j] = 0.0f;
+	for(i=0;i<16;i++) {
+		f32 r,g,b;
+
+		if(!(blk->mask&(1<<i))) continue;
+		r = blk->px[i][0]-mean[0];
+		g = blk->px[i][1]-mean[1];
+		b = blk->px[i][2]-mean[2];
+		cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+		cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+	}
+
+	axis[0] = axis[1] = axis[2] = 1.0f;
+	for(i=0;i<8;i++) {
+		tmp[0] = cov[0]*axis[0]+cov[1]*axis[1]+cov[2]*axis[2];
+		tmp[1] = cov[1]*axis[0]+cov[3]*axis[1]+cov[4]*axis[2];
+		tmp[2] = cov[2]*axis[0]+cov[4]*axis[1]+cov[5]*axis[2];
+
+		d = tmp[0]<0 ? -tmp[0] : tmp[0];
+		if((tmp[1]<0 ? -tmp[1] : tmp[1])>d) d = tmp[1]<0 ? -tmp[1] : tmp[1];
+		if((tmp[2]<0 ? -tmp[2] : tmp[2])>d) d = tmp[2]<0 ? -tmp[2] : tmp[2];
+		if(d<1e-6f) {
+			*c0 = *c1 = __cmpr_pack565(mean[0],mean[1],mean[2]);
+			return;
+		}
+		scale = 1.0f/d;
+		axis[0] = tmp[0]*scale;
+		axis[1] = tmp[1]*scale;
+		axis[2] = tmp[2]*scale;
+	}
+
+	mini = maxi = -1;
+	mind = maxd = 0.0f;
+	for(i=0;i<16;i++) {
+		if(!(blk->mask&(1<<i))) continue;
+		d = blk->px[i][0]*axis[0]+blk->px[i][1]*axis[1]+blk->px[i][2]*axis[2];
+		if(mini<0 || d<mind) {
+			mind = d;
+			mini = i;
+		}
+		if(maxi<0 || d>maxd) {
+			maxd = d;
+			maxi = i;
+		}
+	}
+
+	*c0 = __cmpr_pack565(blk->px[maxi][0],blk->px[maxi][1],blk->px[maxi][2]);
+	*c1 = __cmpr_pack565(blk->px[mini][0],blk->px[mini][1],blk->px[mini][2]);
+}
+
+static s32 __cmpr_refine(const cmprblock *blk,u32 word,u32 c0,u32 c1,u32 *n0,u32 *n1)
+{
+	u32 i,idx;
+	f32 a,b,aa,ab,bb,det;
+	f32 ax[3],bx[3];
+	const f32 *weights;
+
+	weights = (c0>c1) ? _cmprWeights4 : _cmprWeights3;
+
+	aa = ab = bb = 0.0f;
+	ax[0] = ax[1] = ax[2] = 0.0f;
+	bx[0] = bx[1] = bx[2] = 0.0f;
+	for(i=0;i<16;i++) {
+		idx = (word>>(30-(i<<1)))&3;
+		if(!(blk->mask&(1<<i))) continue;
+
+		a = weights[idx];
+		b = 1.0f-a;
+		aa += a*a;
+		ab += a*b;
+		bb += b*b;
+		ax[0] += a*blk->px[i][0]; ax[1] += a*blk->px[i][1]; ax[2] += a*blk->px[i][2];
+		bx[0] += b*blk->px[i][0]; bx[1] += b*blk->px[i][1]; bx[2] += b*blk->px[i][2];
+	}
+
+	det = aa*bb-ab*ab;
+	if(det<1e-4f && det>-1e-4f) return 0;
+
+	det = 1.0f/det;
+	*n0 = __cmpr_pack565((ax[0]*bb-bx[0]*ab)*det,(ax[1]*bb-bx[1]*ab)*det,(ax[2]*bb-bx[2]*ab)*det);
+	*n1 = __cmpr_pack565((bx[0]*aa-ax[0]*ab)*det,(bx[1]*aa-ax[1]*ab)*det,(bx[2]*aa-ax[2]*ab)*det);
+	return 1;
+}
+
+static void __cmpr_encodeblock(const u8 *src,u32 width,u32 height,u32 x0,u32 y0,u8 *dst,u32 quality)
+{
+	u32 i,c0,c1,n0,n1,word,nword,err,nerr,transparent;
+	const u8 *p;
+	cmprblock blk;
+
+	blk.mask = 0;
+	blk.count = 0;
+	for(i=0;i<16;i++) {
+		p = __texconv_texel(src,width,height,x0+(i&3),y0+(i>>2));
+		blk.px[i][0] = p[0];
+		blk.px[i][1] = p[1];
+		blk.px[i][2] = p[2];
+		if(p[3]>=0x80) {
+			blk.mask |= (1<<i);
+			blk.count++;
+		}
+	}
+
+	if(blk.count==0) {
+		memset(dst,0,4);
+		memset(dst+4,0xff,4);
+		return;
+	}
+	transparent = (blk.mask!=CMPR_OPAQUE_MASK);
+
+	__cmpr_boundingbox(&blk,&c0,&c1);
+	__cmpr_order(&c0,&c1,transparent);
+	word = __cmpr_indices(&blk,c0,c1,&err);
+
+	if(quality!=TEXCONV_CMPR_FAST && err>0) {
+		__cmpr_principalaxis(&blk,&n0,&n1);
+		__cmpr_order(&n0,&n1,transparent);
+		nword = __cmpr_indices(&blk,n0,n1,&nerr);
+		if(nerr<err) {
+			c0 = n0; c1 = n1;
+			word = nword; err = nerr;
+		}
+
+		for(i=0;i<2 && err>0;i++) {
+			if(!__cmpr_refine(&blk,word,c0,c1,&n0,&n1)) break;
+			__cmpr_order(&n0,&n1,transparent);
+			nword = __cmpr_indices(&blk,n0,n1,&nerr);
+			if(nerr>=err) break;
+			c0 = n0; c1 = n1;
+			word = nword; err = nerr;
+		}
+	}
+
+	__texconv_st16(dst,c0);
+	__texconv_st16(dst+2,c1);
+	__texconv_st16(dst+4,word>>16);
+	__texconv_st16(dst+6,word);
+}
+
+static void __texconv_encodecmpr(const u8 *src,u8 *dst,u32 width,u32 height,u32 quality)
+{
+	u32 tx,ty;
+
+	for(ty=0;ty<height;ty+=8) {
+		for(tx=0;tx<width;tx+=8) {
+			__cmpr_encodeblock(src,width,height,tx,ty,dst,quality);
+			__cmpr_encodeblock(src,width,height,tx+4,ty,dst+8,quality);
+			__cmpr_encodeblock(src,width,height,tx,ty+4,dst+16,quality);
+			__cmpr_encodeblock(src,width,height,tx+4,ty+4,dst+24,quality);
+			dst += 32;
+		}
+	}
+}
+
+s32 TexConv_Encode(const void *src,void *dst,u16 width,u16 height,u8 fmt,u8 quality)
+{
+	u32 x,y,tx,ty,tw,th;
+	const u8 *p,*q;
+	u8 *d = dst;
+
+	if(!src || !dst || !width || !height) return -1;
+	if(!__texconv_tiledims(fmt,&tw,&th)) return -1;
+
+	if(fmt==GX_TF_CMPR) {
+		__texconv_encodecmpr(src,d,width,height,quality);
+		return __texconv_levelsize(width,height,fmt);
+	}
+
+	for(ty=0;ty<height;ty+=th) {
+		for(tx=0;tx<width;tx+=tw) {
+			for(y=0;y<th;y++) {
+				for(x=0;x<tw;x++) {
+					p = __texconv_texel(src,width,height,tx+x,ty+y);
+					switch(fmt) {
+						case GX_TF_I4:
+							q = __texconv_texel(src,width,height,tx+x+1,ty+y);
+							*d++ = (__texconv_to4(__texconv_intensity(p))<<4)|__texconv_to4(__texconv_intensity(q));
+							x++;
+							break;
+						case GX_TF_I8:
+							*d++ = __texconv_intensity(p);
+							break;
+						case GX_TF_IA4:
+							*d++ = (__texconv_to4(p[3])<<4)|__texconv_to4(__texconv_intensity(p));
+							break;
+						case GX_TF_IA8:
+							*d++ = p[3];
+							*d++ = __texconv_intensity(p);
+							break;
+						case GX_TF_RGB565:
+							__texconv_st16(d,__texconv_rgb565(p));
+							d += 2;
+							break;
+						case GX_TF_RGB5A3:
+							__texconv_st16(d,__texconv_rgb5a3(p));
+							d += 2;
+							break;
+						case GX_TF_RGBA8:
+							// AR pairs in the first 32 bytes of the tile, GB pairs in the second
+							d[0] = p[3];
+							d[1] = p[0];
+							d[32] = p[1];
+							d[33] = p[2];
+							d += 2;
+							break;
+						default:
+							return -1;
+					}
+				}
+			}
+			if(fmt==GX_TF_RGBA8) d += 32;
+		}
+	}
+	return (s32)(d-(u8*)dst);
+}
+
+s32 TexConv_EncodeCI(const void *src,void *dst,u16 width,u16 height,u8 fmt)
+{
+	u32 x,y,sx,sy,tx,ty,tw,th;
+	u8 *d = dst;
+
+	if(!src || !dst || !width || !height) return -1;
+	if(fmt!=GX_TF_CI4 && fmt!=GX_TF_CI8 && fmt!=GX_TF_CI14) return -1;
+
+	__texconv_tiledims(fmt,&tw,&th);
+	for(ty=0;ty<height;ty+=th) {
+		for(tx=0;tx<width;tx+=tw) {
+			for(y=0;y<th;y++) {
+				sy = (ty+y<height) ? ty+y : height-1;
+				for(x=0;x<tw;x++) {
+					sx = (tx+x<width) ? tx+x : width-1;
+					if(fmt==GX_TF_CI14) {
+						__texconv_st16(d,((const u16*)src)[sy*width+sx]&0x3fff);
+						d += 2;
+					} else if(fmt==GX_TF_CI8) {
+						*d++ = ((const u8*)src)[sy*width+sx];
+					} else {
+						u32 hi = ((const u8*)src)[sy*width+sx]&0x0f;
+						sx = (tx+x+1<width) ? tx+x+1 : width-1;
+						*d++ = (hi<<4)|(((const u8*)src)[sy*width+sx]&0x0f);
+						x++;
+					}
+				}
+			}
+		}
+	}
+	return (s32)(d-(u8*)dst);
+}
+
+s32 TexConv_EncodeTlut(const void *src,void *dst,u16 entries,u8 fmt)
+{
+	u32 i;
+	const u8 *p = src;
+	u8 *d = dst;
+
+	if(!src || !dst) return -1;
+	if(fmt!=GX_TL_IA8 && fmt!=GX_TL_RGB565 && fmt!=GX_TL_RGB5A3) return -1;
+
+	for(i=0;i<entries;i++,p+=4,d+=2) {
+		if(fmt==GX_TL_IA8) {
+			d[0] = p[3];
+			d[1] = __texconv_intensity(p);
+		} else if(fmt==GX_TL_RGB565)
+			__texconv_st16(d,__texconv_rgb565(p));
+		else
+			__texconv_st16(d,__texconv_rgb5a3(p));
+	}
+	return (s32)(entries<<1);
+}
+
+void TexConv_Downsample(const void *src,void *dst,u16 width,u16 height)
+{
+	u32 x,y,c,nwd,nht;
+	const u8 *p0,*p1,*p2,*p3;
+	u8 *d = dst;
+
+	nwd = width>1 ? width>>1 : 1;
+	nht = height>1 ? height>>1 : 1;
+	for(y=0;y<nht;y++) {
+		for(x=0;x<nwd;x++) {
+			p0 = __texconv_texel(src,width,height,(x<<1),(y<<1));
+			p1 = __texconv_texel(src,width,height,(x<<1)+1,(y<<1));
+			p2 = __texconv_texel(src,width,height,(x<<1),(y<<1)+1);
+			p3 = __texconv_texel(src,width,height,(x<<1)+1,(y<<1)+1);
+			for(c=0;c<4;c++) *d++ = (p0[c]+p1[c]+p2[c]+p3[c]+2)>>2;
+		}
+	}
+}
+
+s32 TexConv_EncodeMipmaps(const void *src,void *dst,u16 width,u16 height,u8 fmt,u8 quality,u8 maxlod,void *scratch)
+{
+	u32 lod;
+	s32 ret,size;
+	const void *level = src;
+
+	if(!scratch && maxlod>0) return -1;
+
+	size = 0;
+	for(lod=0;lod<=maxlod;lod++) {
+		ret = TexConv_Encode(level,(u8*)dst+size,width,height,fmt,quality);
+		if(ret<0) return ret;
+		size += ret;
+
+		if(width==1 && height==1) break;
+		if(lod==maxlod) break;
+
+		// the first reduction lands in scratch, subsequent ones shrink it in place
+		TexConv_Downsample(level,scratch,width,height);
+		level = scratch;
+		width = width>1 ? width>>1 : 1;
+		height = height>1 ? height>>1 : 1;
+	}
+	return size;
+}
@@ -53,6 +53,15 @@ struct _tpldesc {
 	TPLPalHeader *palhead;
 } ATTRIBUTE_PACKED;
 
+// residency of paged in texture data
+typedef struct _tplresident TPLResident;
+
+struct _tplresident {
+	u32 offset;
+	u32 size;
+	u32 last_use;
+};
+
 static u32 TPL_GetTextureSize(u32 width,u32 height,u32 fmt)
 {
 	u32 size = 0;
@@ -83,6 +92,103 @@ static u32 TPL_GetTextureSize(u32 width,u32 height,u32 fmt)
 	return size;
 }
 
+static inline u16 TPL_GetLevelDim(u16 dim,u32 lod)
+{
+	dim >>= lod;
+	return dim ? dim : 1;
+}
+
+static u32 TPL_GetLevelCount(TPLImgHeader *imghead)
+{
+	u32 nlods = 1;
+	u32 width = imghead->width;
+	u32 height = imghead->height;
+
+	while(nlods<=imghead->maxlod && (width>1 || height>1)) {
+		width = width>1 ? width>>1 : 1;
+		height = height>1 ? height>>1 : 1;
+		nlods++;
+	}
+	return nlods;
+}
+
+static u32 TPL_GetChainSize(TPLImgHeader *imghead,u32 firstlod,u32 nlods,u32 *skip)
+{
+	u32 lod,size = 0;
+	u32 width = imghead->width;
+	u32 height = imghead->height;
+
+	if(skip) *skip = 0;
+	for(lod=0;lod<firstlod+nlods;lod++) {
+		if(lod<firstlod) {
+			if(skip) *skip += TPL_GetTextureSize(width,height,imghead->fmt);
+		} else
+			size += TPL_GetTextureSize(width,height,imghead->fmt);
+
+		width = width>1 ? width>>1 : 1;
+		height = height>1 ? height>>1 : 1;
+	}
+	return size;
+}
+
+static void TPL_EvictTextures(TPLFile *tdf,s32 keep)
+{
+	s32 i,victim;
+	TPLResident *res = (TPLResident*)tdf->residency;
+	TPLDescHeader *deschead = (TPLDescHeader*)tdf->texdesc;
+	TPLImgHeader *imghead;
+
+	while(tdf->budget && tdf->resident>tdf->budget) {
+		victim = -1;
+		for(i=0;i<tdf->ntextures;i++) {
+			if(i==keep || !res[i].size) continue;
+			if(victim<0 || (s32)(res[i].last_use-res[victim].last_use)<0) victim = i;
+		}
+		if(victim<0) break;
+
+		imghead = deschead[victim].imghead;
+		free(imghead->data);
+		imghead->data = (void*)res[victim].offset;
+		imghead->unpacked = FALSE;
+
+		tdf->resident -= res[victim].size;
+		res[victim].size = 0;
+	}
+}
+
+static s32 TPL_PageInTexture(TPLFile *tdf,s32 id,TPLImgHeader *imghead,u32 size)
+{
+	s32 pos;
+	TPLResident *res = (TPLResident*)tdf->residency;
+
+	if(tdf->type!=TPL_FILE_TYPE_DISC) return 0;
+
+	if(!imghead->unpacked) {
+		pos = (s32)imghead->data;
+		imghead->data = memalign(PPC_CACHE_ALIGNMENT,size);
+		if(!imghead->data) {
+			imghead->data = (void*)pos;
+			return -1;
+		}
+		imghead->unpacked = TRUE;
+
+		fseek(tdf->tpl_file,pos,SEEK_SET);
+		fread(imghead->data,1,size,tdf->tpl_file);
+
+		if(res) {
+			res[id].offset = pos;
+			res[id].size = size;
+			tdf->resident += size;
+		}
+	} else if(!imghead->data) return -1;
+
+	if(res && res[id].size) {
+		res[id].last_use = ++tdf->ticks;
+		TPL_EvictTextures(tdf,id);
+	}
+	return 0;
+}
+
 s32 TPL_OpenTPLFromFile(TPLFile* tdf, const char* file_name)
 {
 	if(!file_name) return 0;
@@ -102,6 +208,10 @@ s32 TPL_OpenTPLFromHandle(TPLFile* tdf, FILE *handle)
 
 	tdf->type = TPL_FILE_TYPE_DISC;
 	tdf->tpl_file = f;
+	tdf->budget = 0;
+	tdf->resident = 0;
+	tdf->ticks = 0;
+	tdf->residency = NULL;
 
 	fread(&version,sizeof(u32),1,f);
 	fread(&tdf->ntextures,sizeof(u32),1,f);
@@ -137,6 +247,7 @@ s32 TPL_OpenTPLFromHandle(TPLFile* tdf, FILE *handle)
 			}
 		}
 		tdf->texdesc = deschead;
+		tdf->residency = calloc(tdf->ntextures,sizeof(TPLResident));
 
 		return 1;
 	}
@@ -162,6 +273,10 @@ s32 TPL_OpenTPLFromMemory(TPLFile* tdf, void *memory,u32 len)
 
 	tdf->type = TPL_FILE_TYPE_MEM;
 	tdf->tpl_file = NULL;
+	tdf->budget = 0;
+	tdf->resident = 0;
+	tdf->ticks = 0;
+	tdf->residency = NULL;
 
 	//version = *(u32*)(p + TPL_HDR_VERSION_FIELD);
 	tdf->ntextures = *(u32*)(p + TPL_HDR_NTEXTURE_FIELD);
@@ -222,9 +337,7 @@ s32 TPL_GetTextureInfo(TPLFile *tdf,s32 id,u32 *fmt,u16 *width,u16 *height)
 
 s32 TPL_GetTexture(TPLFile *tdf,s32 id,GXTexObj *texObj)
 {
-	s32 pos;
 	u32 size;
-	FILE *f = NULL;
 	TPLDescHeader *deschead = NULL;
 	TPLImgHeader *imghead = NULL;
 	s32 bMipMap = 0;
@@ -240,21 +353,9 @@ s32 TPL_GetTexture(TPLFile *tdf,s32 id,GXTexObj *texObj)
 	imghead = deschead[id].imghead;
 	if(!imghead) return -1;
 
-	size = TPL_GetTextureSize(imghead->width,imghead->height,imghead->fmt);
-	if(tdf->type==TPL_FILE_TYPE_DISC) {
-		f = tdf->tpl_file;
-
-		if(!imghead->unpacked) {
-			pos = (s32)imghead->data;
-			imghead->data = memalign(PPC_CACHE_ALIGNMENT,size);
-			imghead->unpacked = TRUE;
-			if(!imghead->data) return -1;
+	size = TPL_GetChainSize(imghead,0,TPL_GetLevelCount(imghead),NULL);
+	if(TPL_PageInTexture(tdf,id,imghead,size)<0) return -1;
 
-			fseek(f,pos,SEEK_SET);
-			fread(imghead->data,1,size,f);
-		} else if(!imghead->data) return -1;
-	}
-	
 	if(imghead->maxlod>0) bMipMap = 1;
 	if(imghead->lodbias>0.0f) biasclamp = GX_ENABLE;
 
@@ -290,20 +391,12 @@ s32 TPL_GetTextureCI(TPLFile *tdf,s32 id,GXTexObj *texObj,GXTlutObj *tlutObj,u8
 	palhead = deschead[id].palhead;
 	if(!palhead) return -1;
 
-	size = TPL_GetTextureSize(imghead->width,imghead->height,imghead->fmt);
+	size = TPL_GetChainSize(imghead,0,TPL_GetLevelCount(imghead),NULL);
+	if(TPL_PageInTexture(tdf,id,imghead,size)<0) return -1;
+
 	if(tdf->type==TPL_FILE_TYPE_DISC) {
 		f = tdf->tpl_file;
 
-		if(!imghead->unpacked) {
-			pos = (s32)imghead->data;
-			imghead->data = memalign(PPC_CACHE_ALIGNMENT,size);
-			imghead->unpacked = TRUE;
-			if(!imghead->data) return -1;
-
-			fseek(f,pos,SEEK_SET);
-			fread(imghead->data,1,size,f);
-		} else if(!imghead->data) return -1;
-
 		if(!palhead->unpacked) {
 			pos = (s32)palhead->data;
 			palhead->data = memalign(PPC_CACHE_ALIGNMENT,(palhead->nitems*sizeof(u16)));
@@ -327,6 +420,154 @@ s32 TPL_GetTextureCI(TPLFile *tdf,s32 id,GXTexObj *texObj,GXTlutObj *tlutObj,u8
 	return 0;
 }
 
+void TPL_SetResidencyBudget(TPLFile *tdf,u32 budget)
+{
+	if(!tdf) return;
+
+	tdf->budget = budget;
+	if(tdf->residency) TPL_EvictTextures(tdf,-1);
+}
+
+u32 TPL_GetResidentSize(TPLFile *tdf)
+{
+	if(!tdf) return 0;
+	return tdf->resident;
+}
+
+s32 TPL_GetTextureLoadSize(TPLFile *tdf,s32 id,u8 firstlod,u8 nlods)
+{
+	u32 levels;
+	TPLDescHeader *deschead = NULL;
+	TPLImgHeader *imghead = NULL;
+
+	if(!tdf) return -1;
+	if(id<0 || id>=tdf->ntextures) return -1;
+
+	deschead = (TPLDescHeader*)tdf->texdesc;
+	if(!deschead) return -1;
+
+	imghead = deschead[id].imghead;
+	if(!imghead) return -1;
+
+	levels = TPL_GetLevelCount(imghead);
+	if(firstlod>=levels) return -1;
+	if(!nlods || nlods>levels-firstlod) nlods = levels-firstlod;
+
+	return TPL_GetChainSize(imghead,firstlod,nlods,NULL);
+}
+
+static s32 TPL_ReadTextureData(TPLFile *tdf,TPLImgHeader *imghead,u32 firstlod,u32 nlods,void *buffer,u32 len)
+{
+	s32 pos;
+	u32 size,skip;
+
+	size = TPL_GetChainSize(imghead,firstlod,nlods,&skip);
+	if(len<size) return -1;
+
+	if(imghead->unpacked) {
+		if(!imghead->data) return -1;
+		memcpy(buffer,(u8*)imghead->data+skip,size);
+	} else {
+		pos = (s32)imghead->data+skip;
+		if(fseek(tdf->tpl_file,pos,SEEK_SET)) return -1;
+		if(fread(buffer,1,size,tdf->tpl_file)!=size) return -1;
+	}
+
+	DCFlushRange(buffer,size);
+	return size;
+}
+
+static void TPL_InitTextureLOD(GXTexObj *texObj,TPLImgHeader *imghead,u32 firstlod,u32 nlods)
+{
+	f32 minlod,maxlod;
+	u8 biasclamp = GX_DISABLE;
+
+	minlod = (imghead->minlod>firstlod) ? (f32)(imghead->minlod-firstlod) : 0.0f;
+	maxlod = (f32)(nlods-1);
+	if(imghead->maxlod-firstlod<nlods-1) maxlod = (f32)(imghead->maxlod-firstlod);
+	if(imghead->lodbias>0.0f) biasclamp = GX_ENABLE;
+
+	GX_InitTexObjLOD(texObj,imghead->minfilter,imghead->magfilter,minlod,maxlod,imghead->lodbias,biasclamp,imghead->edgelod,GX_ANISO_1);
+}
+
+s32 TPL_LoadTexture(TPLFile *tdf,s32 id,u8 firstlod,u8 nlods,void *buffer,u32 len,GXTexObj *texObj)
+{
+	s32 size;
+	u32 levels;
+	TPLDescHeader *deschead = NULL;
+	TPLImgHeader *imghead = NULL;
+
+	if(!tdf) return -1;
+	if(!buffer || ((u32)buffer&(PPC_CACHE_ALIGNMENT-1))) return -1;
+	if(id<0 || id>=tdf->ntextures) return -1;
+
+	deschead = (TPLDescHeader*)tdf->texdesc;
+	if(!deschead) return -1;
+
+	imghead = deschead[id].imghead;
+	if(!imghead) return -1;
+
+	levels = TPL_GetLevelCount(imghead);
+	if(firstlod>=levels) return -1;
+	if(!nlods || nlods>levels-firstlod) nlods = levels-firstlod;
+
+	size = TPL_ReadTextureData(tdf,imghead,firstlod,nlods,buffer,len);
+	if(size<0) return -1;
+
+	if(texObj) {
+		GX_InitTexObj(texObj,buffer,TPL_GetLevelDim(imghead->width,firstlod),TPL_GetLevelDim(imghead->height,firstlod),imghead->fmt,imghead->wraps,imghead->wrapt,(nlods>1));
+		TPL_InitTextureLOD(texObj,imghead,firstlod,nlods);
+	}
+	return size;
+}
+
+s32 TPL_LoadTextureCI(TPLFile *tdf,s32 id,u8 firstlod,u8 nlods,void *buffer,u32 len,void *tlutbuf,GXTexObj *texObj,GXTlutObj *tlutObj,u8 tluts)
+{
+	s32 size;
+	u32 levels,tlutsize;
+	TPLDescHeader *deschead = NULL;
+	TPLImgHeader *imghead = NULL;
+	TPLPalHeader *palhead = NULL;
+
+	if(!tdf) return -1;
+	if(!buffer || ((u32)buffer&(PPC_CACHE_ALIGNMENT-1))) return -1;
+	if(!tlutbuf || ((u32)tlutbuf&(PPC_CACHE_ALIGNMENT-1))) return -1;
+	if(id<0 || id>=tdf->ntextures) return -1;
+
+	deschead = (TPLDescHeader*)tdf->texdesc;
+	if(!deschead) return -1;
+
+	imghead = deschead[id].imghead;
+	if(!imghead) return -1;
+
+	palhead = deschead[id].palhead;
+	if(!palhead) return -1;
+
+	levels = TPL_GetLevelCount(imghead);
+	if(firstlod>=levels) return -1;
+	if(!nlods || nlods>levels-firstlod) nlods = levels-firstlod;
+
+	size = TPL_ReadTextureData(tdf,imghead,firstlod,nlods,buffer,len);
+	if(size<0) return -1;
+
+	tlutsize = palhead->nitems*sizeof(u16);
+	if(palhead->unpacked) {
+		if(!palhead->data) return -1;
+		memcpy(tlutbuf,palhead->data,tlutsize);
+	} else {
+		if(fseek(tdf->tpl_file,(s32)palhead->data,SEEK_SET)) return -1;
+		if(fread(tlutbuf,1,tlutsize,tdf->tpl_file)!=tlutsize) return -1;
+	}
+	DCFlushRange(tlutbuf,tlutsize);
+
+	if(tlutObj) GX_InitTlutObj(tlutObj,tlutbuf,palhead->fmt,palhead->nitems);
+	if(texObj) {
+		GX_InitTexObjCI(texObj,buffer,TPL_GetLevelDim(imghead->width,firstlod),TPL_GetLevelDim(imghead->height,firstlod),imghead->fmt,imghead->wraps,imghead->wrapt,(nlods>1),tluts);
+		TPL_InitTextureLOD(texObj,imghead,firstlod,nlods);
+	}
+	return size;
+}
+
 void TPL_CloseTPLFile(TPLFile *tdf)
 {
 	int i;
@@ -357,8 +598,12 @@ void TPL_CloseTPLFile(TPLFile *tdf)
 			}
 			free(deschead);
 		}
+		if(tdf->residency) free(tdf->residency);
 	}
 	
+	tdf->budget = 0;
+	tdf->resident = 0;
+	tdf->residency = NULL;
 	tdf->ntextures = 0;
 	tdf->texdesc = NULL;
 	tdf->tpl_file = NULL;
@@ -47,7 +47,7 @@ distribution.
 #include "disc_io.h"
 #include "timesupp.h"
 
-#define	HEAP_SIZE					(18*1024)
+#define	HEAP_SIZE					(34*1024)
 #define	TAG_START					0x0BADC0DE
 
 #define	CBW_SIZE					31
@@ -98,6 +98,10 @@ distribution.
 #define MAX_TRANSFER_SIZE_V0		4096
 #define MAX_TRANSFER_SIZE_V5		(16*1024)
 
+/* data chunks kept in flight; bounced transfers are limited by the bounce slots */
+#define USBSTORAGE_QUEUE_DEPTH		4
+#define USBSTORAGE_BOUNCE_SLOTS		2
+
 #define DEVLIST_MAXSIZE    			8
 
 static heap_cntrl __heap;
@@ -106,6 +110,18 @@ static u64 usb_last_used = 0;
 static lwpq_t __usbstorage_waitq = 0;
 static u32 usbtimeout = USBSTORAGE_TIMEOUT;
 
+typedef struct _usbstorage_xfer {
+	u8 *data;
+	u8 *user;
+	u32 len;
+	volatile s32 retval;
+} usbstorage_xfer;
+
+static usbstorage_xfer __cbw_xfer;
+static usbstorage_xfer __csw_xfer;
+static usbstorage_xfer __data_xfer[USBSTORAGE_QUEUE_DEPTH];
+static volatile u32 __xfer_pending = 0;
+
 /*
 The following is for implementing a DISC_INTERFACE
 as used by libfat
@@ -159,28 +175,6 @@ static void __usb_settimeout(usbstorage_handle *dev, u32 secs)
 	SYS_SetAlarm(dev->alarm,&ts,__usb_timeouthandler,dev);
 }
 
-static s32 __USB_BlkMsgTimeout(usbstorage_handle *dev, u8 bEndpoint, u16 wLength, void *rpData, u32 timeout)
-{
-	s32 retval;
-
-	dev->retval = USBSTORAGE_PROCESSING;
-	retval = USB_WriteBlkMsgAsync(dev->usb_fd, bEndpoint, wLength, rpData, __usb_blkmsg_cb, (void *)dev);
-	if(retval < 0) return retval;
-
-	__usb_settimeout(dev, timeout);
-
-	do {
-		retval = dev->retval;
-		if(retval!=USBSTORAGE_PROCESSING) break;
-		else LWP_ThreadSleep(__usbstorage_waitq);
-	} while(retval==USBSTORAGE_PROCESSING);
-
-	if (retval<0)
-		USB_ClearHalt(dev->usb_fd, bEndpoint);
-
-	return retval;
-}
-
 static s32 __USB_CtrlMsgTimeout(usbstorage_handle *dev, u8 bmRequestType, u8 bmRequest, u16 wValue, u16 wIndex, u16 wLength, void *rpData)
 {
 	s32 retval;
@@ -202,6 +196,7 @@ static s32 __USB_CtrlMsgTimeout(usbstorage_handle *dev, u8 bmRequestType, u8 bmR
 
 static u8 *arena_ptr=NULL;
 static u8 *cbw_buffer=NULL;
+static u8 *csw_buffer=NULL;
 
 s32 USBStorage_Initialize(void)
 {
@@ -219,17 +214,93 @@ s32 USBStorage_Initialize(void)
 		}
 	}
 	__lwp_heap_init(&__heap, arena_ptr, HEAP_SIZE, 32);
-	cbw_buffer=(u8*)__lwp_heap_allocate(&__heap, 32);
+	cbw_buffer=(u8*)__lwp_heap_allocate(&__heap, 64);
+	csw_buffer=cbw_buffer + 32;
 	LWP_InitQueue(&__usbstorage_waitq);
 	__inited = true;
 	_CPU_ISR_Restore(level);
 	return IPC_OK;
 }
 
-static s32 __send_cbw(usbstorage_handle *dev, u8 lun, u32 len, u8 flags, const u8 *cb, u8 cbLen)
+/* Queued transfers.
+ * A command is issued as one batch of async bulk requests: the CBW, up to
+ * USBSTORAGE_QUEUE_DEPTH data chunks and, once the last chunk is queued, the
+ * CSW read. IOS completes requests on an endpoint in order, so the device
+ * never sees the data phase before the CBW. Buffers that IOS cannot DMA to
+ * directly are staged through the bounce slots in dev->buffer, which lets the
+ * copy of one chunk overlap the transfer of the next.
+ */
+static s32 __usb_xfer_cb(s32 retval, void *usrdata)
 {
-	s32 retval = USBSTORAGE_OK;
+	usbstorage_xfer *x = (usbstorage_xfer *)usrdata;
+	x->retval = retval;
+	__xfer_pending--;
+	LWP_ThreadBroadcast(__usbstorage_waitq);
+	return 0;
+}
+
+static s32 __usb_xfer_submit(usbstorage_handle *dev, u8 bEndpoint, usbstorage_xfer *x)
+{
+	s32 retval;
+	u32 level;
+
+	x->retval = USBSTORAGE_PROCESSING;
+
+	_CPU_ISR_Disable(level);
+	__xfer_pending++;
+	_CPU_ISR_Restore(level);
 
+	retval = USB_WriteBlkMsgAsync(dev->usb_fd, bEndpoint, x->len, x->data, __usb_xfer_cb, (void *)x);
+	if(retval < 0) {
+		_CPU_ISR_Disable(level);
+		__xfer_pending--;
+		_CPU_ISR_Restore(level);
+		x->retval = retval;
+	}
+	return retval;
+}
+
+static s32 __usb_xfer_wait(usbstorage_handle *dev, usbstorage_xfer *x, u32 timeout)
+{
+	u32 level;
+
+	dev->retval = USBSTORAGE_PROCESSING;
+	__usb_settimeout(dev, timeout);
+
+	_CPU_ISR_Disable(level);
+	while(x->retval==USBSTORAGE_PROCESSING && dev->retval==USBSTORAGE_PROCESSING)
+		LWP_ThreadSleep(__usbstorage_waitq);
+	_CPU_ISR_Restore(level);
+
+	SYS_CancelAlarm(dev->alarm);
+
+	if(x->retval==USBSTORAGE_PROCESSING)
+		return USBSTORAGE_ETIMEDOUT;
+	return x->retval;
+}
+
+/* requests left over from an aborted command must finish before their slots are reused */
+static s32 __usb_xfer_drain(usbstorage_handle *dev, u32 timeout)
+{
+	u32 level;
+
+	if(__xfer_pending==0) return USBSTORAGE_OK;
+
+	dev->retval = USBSTORAGE_PROCESSING;
+	__usb_settimeout(dev, timeout);
+
+	_CPU_ISR_Disable(level);
+	while(__xfer_pending!=0 && dev->retval==USBSTORAGE_PROCESSING)
+		LWP_ThreadSleep(__usbstorage_waitq);
+	_CPU_ISR_Restore(level);
+
+	SYS_CancelAlarm(dev->alarm);
+
+	return (__xfer_pending==0) ? USBSTORAGE_OK : USBSTORAGE_ETIMEDOUT;
+}
+
+static s32 __send_cbw(usbstorage_handle *dev, u8 lun, u32 len, u8 flags, const u8 *cb, u8 cbLen)
+{
 	if(cbLen == 0 || cbLen > 16)
 		return IPC_EINVAL;
 
@@ -250,12 +321,20 @@ static s32 __send_cbw(usbstorage_handle *dev, u8 lun, u32 len, u8 flags, const u
 		dev->suspended = 0;
 	}
 
-	retval = __USB_BlkMsgTimeout(dev, dev->ep_out, CBW_SIZE, (void *)cbw_buffer, usbtimeout);
+	__cbw_xfer.data = cbw_buffer;
+	__cbw_xfer.user = NULL;
+	__cbw_xfer.len = CBW_SIZE;
+	return __usb_xfer_submit(dev, dev->ep_out, &__cbw_xfer);
+}
 
-	if(retval == CBW_SIZE) return USBSTORAGE_OK;
-	else if(retval > 0) return USBSTORAGE_ESHORTWRITE;
+static s32 __send_csw(usbstorage_handle *dev)
+{
+	memset(csw_buffer, 0, CSW_SIZE);
 
-	return retval;
+	__csw_xfer.data = csw_buffer;
+	__csw_xfer.user = NULL;
+	__csw_xfer.len = CSW_SIZE;
+	return __usb_xfer_submit(dev, dev->ep_in, &__csw_xfer);
 }
 
 static s32 __read_csw(usbstorage_handle *dev, u8 *status, u32 *dataResidue, u32 timeout)
@@ -263,16 +342,14 @@ static s32 __read_csw(usbstorage_handle *dev, u8 *status, u32 *dataResidue, u32
 	s32 retval = USBSTORAGE_OK;
 	u32 signature, tag, _dataResidue, _status;
 
-	memset(cbw_buffer, 0, CSW_SIZE);
-
-	retval = __USB_BlkMsgTimeout(dev, dev->ep_in, CSW_SIZE, cbw_buffer, timeout);
+	retval = __usb_xfer_wait(dev, &__csw_xfer, timeout);
 	if(retval > 0 && retval != CSW_SIZE) return USBSTORAGE_ESHORTREAD;
 	else if(retval < 0) return retval;
 
-	signature = __lwbrx(cbw_buffer, 0);
-	tag = __lwbrx(cbw_buffer, 4);
-	_dataResidue = __lwbrx(cbw_buffer, 8);
-	_status = cbw_buffer[12];
+	signature = __lwbrx(csw_buffer, 0);
+	tag = __lwbrx(csw_buffer, 4);
+	_dataResidue = __lwbrx(csw_buffer, 8);
+	_status = csw_buffer[12];
 
 	if(signature != CSW_SIGNATURE) return USBSTORAGE_ESIGNATURE;
 
@@ -295,48 +372,83 @@ static s32 __cycle(usbstorage_handle *dev, u8 lun, u8 *buffer, u32 len, u8 *cb,
 	u16 max_size;
 	u8 ep = write ? dev->ep_out : dev->ep_in;
 	s8 retries = USBSTORAGE_CYCLE_RETRIES + 1;
+	u32 n_chunks, depth;
+	bool bounce;
 	
 	if(usb2_mode)
 		max_size=MAX_TRANSFER_SIZE_V5;
 	else
 		max_size=MAX_TRANSFER_SIZE_V0;
 
+	/* chunks must stay multiples of the packet size, so a misaligned buffer
+	 * cannot be split into a bounced head and an aligned body */
+	bounce = ((u32)buffer&0x1F || !((u32)buffer&0x10000000));
+	depth = bounce ? USBSTORAGE_BOUNCE_SLOTS : USBSTORAGE_QUEUE_DEPTH;
+	n_chunks = (len + max_size - 1)/max_size;
+
 	LWP_MutexLock(dev->lock);
 	do
 	{
-		u8 *_buffer = buffer;
-		u32 _len = len;
+		u32 submitted = 0, completed = 0;
 		retries--;
 
 		if(retval == USBSTORAGE_ETIMEDOUT)
 			break;
 
-		retval = __send_cbw(dev, lun, len, (write ? CBW_OUT:CBW_IN), cb, cbLen);
+		retval = __usb_xfer_drain(dev, usbtimeout);
+		if(retval < 0)
+			break;
 
-		while(_len > 0 && retval >= 0)
+		retval = __send_cbw(dev, lun, len, (write ? CBW_OUT:CBW_IN), cb, cbLen);
+		if(retval >= 0 && n_chunks == 0)
+			retval = __send_csw(dev);
+		if(retval >= 0)
+			retval = __usb_xfer_wait(dev, &__cbw_xfer, usbtimeout);
+		if(retval >= 0 && retval != CBW_SIZE)
+			retval = USBSTORAGE_ESHORTWRITE;
+
+		while(completed < n_chunks && retval >= 0)
 		{
-			u32 thisLen = _len > max_size ? max_size : _len;
-
-			if ((u32)_buffer&0x1F || !((u32)_buffer&0x10000000)) {
-				if (write) memcpy(dev->buffer, _buffer, thisLen);
-				retval = __USB_BlkMsgTimeout(dev, ep, thisLen, dev->buffer, usbtimeout);
-				if (!write && retval > 0)
-					memcpy(_buffer, dev->buffer, retval);
-			} else
-				retval = __USB_BlkMsgTimeout(dev, ep, thisLen, _buffer, usbtimeout);
-
-			if (retval == thisLen) {
-				_len -= retval;
-				_buffer += retval;
+			usbstorage_xfer *x;
+
+			while(submitted < n_chunks && submitted - completed < depth && retval >= 0)
+			{
+				u32 offset = submitted*max_size;
+
+				x = &__data_xfer[submitted%depth];
+				x->len = (len - offset) > max_size ? max_size : (len - offset);
+				if(bounce) {
+					x->data = dev->buffer + (submitted%depth)*max_size;
+					x->user = buffer + offset;
+					if(write) memcpy(x->data, x->user, x->len);
+					dev->stats.bounced += x->len;
+				} else {
+					x->data = buffer + offset;
+					x->user = NULL;
+				}
+
+				retval = __usb_xfer_submit(dev, ep, x);
+				if(retval >= 0 && ++submitted == n_chunks)
+					retval = __send_csw(dev);
 			}
-			else if (retval != USBSTORAGE_ETIMEDOUT)
+			if(retval < 0)
+				break;
+
+			x = &__data_xfer[completed%depth];
+			retval = __usb_xfer_wait(dev, x, usbtimeout);
+			if(retval == x->len) {
+				if(!write && x->user)
+					memcpy(x->user, x->data, retval);
+				completed++;
+			}
+			else if(retval != USBSTORAGE_ETIMEDOUT)
 				retval = USBSTORAGE_EDATARESIDUE;
 		}
 
-		if (retval >= 0)
+		if(retval >= 0)
 			retval = __read_csw(dev, &status, &dataResidue, usbtimeout);
 
-		if (retval < 0) {
+		if(retval < 0) {
 			if (__usbstorage_reset(dev) == USBSTORAGE_ETIMEDOUT)
 				retval = USBSTORAGE_ETIMEDOUT;
 		}
@@ -536,7 +648,7 @@ found:
 	//USB_ClearHalt(dev->usb_fd, dev->ep_out);
 
 	if(!dev->buffer)
-		dev->buffer = __lwp_heap_allocate(&__heap, MAX_TRANSFER_SIZE_V5);
+		dev->buffer = __lwp_heap_allocate(&__heap, USBSTORAGE_BOUNCE_SLOTS*MAX_TRANSFER_SIZE_V5);
 
 	if(!dev->buffer) {
 		retval = IPC_ENOMEM;
@@ -737,7 +849,15 @@ s32 USBStorage_StartStop(usbstorage_handle *dev, u8 lun, u8 lo_ej, u8 start, u8
 
 	LWP_MutexLock(dev->lock);
 
-	retval = __send_cbw(dev, lun, 0, CBW_IN, cmd, sizeof(cmd));
+	retval = __usb_xfer_drain(dev, usbtimeout);
+	if (retval >= 0)
+		retval = __send_cbw(dev, lun, 0, CBW_IN, cmd, sizeof(cmd));
+	if (retval >= 0)
+		retval = __send_csw(dev);
+	if (retval >= 0)
+		retval = __usb_xfer_wait(dev, &__cbw_xfer, usbtimeout);
+	if (retval >= 0 && retval != CBW_SIZE)
+		retval = USBSTORAGE_ESHORTWRITE;
 
 	// if imm==0, wait up to 10secs for spinup to finish
 	if (retval >= 0)
@@ -751,14 +871,47 @@ s32 USBStorage_StartStop(usbstorage_handle *dev, u8 lun, u8 lo_ej, u8 start, u8
 	return retval;
 }
 
+static void __usbstorage_account(usbstorage_handle *dev, u64 start, u32 bytes, s32 retval)
+{
+	u64 ticks = gettime() - start;
+
+	dev->stats.requests++;
+	if(retval < 0)
+		dev->stats.errors++;
+	else
+		dev->stats.bytes += bytes;
+
+	dev->stats.last_ticks = ticks;
+	dev->stats.total_ticks += ticks;
+	if(ticks > dev->stats.max_ticks)
+		dev->stats.max_ticks = ticks;
+}
+
+void USBStorage_GetStats(usbstorage_handle *dev, usbstorage_stats *stats)
+{
+	LWP_MutexLock(dev->lock);
+	*stats = dev->stats;
+	LWP_MutexUnlock(dev->lock);
+}
+
+void USBStorage_ResetStats(usbstorage_handle *dev)
+{
+	LWP_MutexLock(dev->lock);
+	memset(&dev->stats, 0, sizeof(dev->stats));
+	LWP_MutexUnlock(dev->lock);
+}
+
 s32 USBStorage_Read(usbstorage_handle *dev, u8 lun, u64 sector, u32 n_sectors, u8 *buffer)
 {
 	u8 status = 0;
 	s32 retval;
+	u64 start;
 
 	if(lun >= dev->max_lun || dev->sector_size[lun] == 0)
 		return IPC_EINVAL;
 
+	start = gettime();
+
 	// more than 60s since last use - make sure drive is awake
 	if(ticks_to_secs(gettime() - usb_last_used) > 60)
 	{
@@ -792,6 +945,8 @@ s32 USBStorage_Read(usbstorage_handle *dev, u8 lun, u64 sector, u32 n_sectors, u
 	if(retval > 0 && status != 0)
 		retval = USBSTORAGE_ESTATUS;
 
+	__usbstorage_account(dev, start, n_sectors * dev->sector_size[lun], retval);
+
 	usb_last_used = gettime();
 	usbtimeout = USBSTORAGE_TIMEOUT;
 
@@ -802,10 +957,13 @@ s32 USBStorage_Write(usbstorage_handle *dev, u8 lun, u64 sector, u32 n_sectors,
 {
 	u8 status = 0;
 	s32 retval;
+	u64 start;
 
 	if(lun >= dev->max_lun || dev->sector_size[lun] == 0)
 		return IPC_EINVAL;
 
+	start = gettime();
+
 	// more than 60s since last use - make sure drive is awake
 	if(ticks_to_secs(gettime() - usb_last_used) > 60)
 	{
@@ -839,6 +997,8 @@ s32 USBStorage_Write(usbstorage_handle *dev, u8 lun, u64 sector, u32 n_sectors,
 	if(retval > 0 && status != 0)
 		retval = USBSTORAGE_ESTATUS;
 
+	__usbstorage_account(dev, start, n_sectors * dev->sector_size[lun], retval);
+
 	usb_last_used = gettime();
 	usbtimeout = USBSTORAGE_TIMEOUT;
 
@@ -140,6 +140,8 @@
 #define SMB_MAX_NET_READ_SIZE		(16*1024) // see smb_recv
 #define SMB_MAX_NET_WRITE_SIZE		4096 // see smb_sendv
 #define SMB_MAX_TRANSMIT_SIZE		65472
+#define SMB_READ_WINDOW				4 // outstanding READ_ANDX requests per SMB_ReadFile
+#define SMB_READANDX_RESP_SIZE		(SMB_HEADER_SIZE+1+24+2)
 
 #define CAP_LARGE_FILES				0x00000008  // 64-bit file sizes and offsets supported
 #define CAP_UNICODE					0x00000004  // Unicode supported
@@ -1828,17 +1830,54 @@ failed:
 	return ret;
 }
 
+/**
+ * smb_discard
+ *
+ * Read and throw away <len> bytes from the socket
+ */
+static s32 smb_discard(s32 s,u8 *scratch,s32 scratchlen,s32 len)
+{
+	s32 ret,read;
+
+	while(len>0)
+	{
+		read=len;
+		if(read>scratchlen) read=scratchlen;
+
+		ret=smb_recv(s,scratch,read);
+		if(ret!=read) return SMB_ERROR;
+		len-=ret;
+	}
+	return SMB_SUCCESS;
+}
+
 /**
  * SMB_Read
+ *
+ * Keeps up to SMB_READ_WINDOW READ_ANDX requests in flight, each tagged
+ * with its own MID. Replies are matched by MID and their payload is
+ * received straight into the caller's buffer. The rest of a short reply
+ * is asked for again; returns the bytes read, fewer than size only at the
+ * end of the file.
  */
 s32 SMB_ReadFile(char *buffer, size_t size, off_t offset, SMBFILE sfid)
 {
 	u8 *ptr;
-	u32 pos, ret, ofs;
-	u16 length = 0;
+	u8 nbt[4];
+	u8 resp[SMB_READANDX_RESP_SIZE];
+	u32 pos, ofs, readlen;
+	s32 ret;
+	u16 mid, length;
+	u32 i, window, pending = 0;
 	SMBHANDLE *handle;
-	size_t totalread=0,nextread;
+	size_t totalsent=0,nextread,filled=size;
 	struct _smbfile *fid = (struct _smbfile*)sfid;
+	struct {
+		u16 mid;
+		u32 len;
+		size_t pos;
+		bool busy;
+	} slots[SMB_READ_WINDOW];
 
 	if(!fid) return -1;
 
@@ -1848,67 +1887,138 @@ s32 SMB_ReadFile(char *buffer, size_t size, off_t offset, SMBFILE sfid)
 	handle = __smb_handle_open(fid->conn);
 	if(!handle) return -1;
 
-	while(totalread < size)
+	window = handle->session.MaxMpx;
+	if(window<1) window = 1;
+	if(window>SMB_READ_WINDOW) window = SMB_READ_WINDOW;
+
+	for(i=0;i<window;i++) {
+		slots[i].mid = handle->session.MID + 1 + i;
+		slots[i].len = 0;
+		slots[i].busy = false;
+	}
+
+	// The request stays in handle->message, only offset, length and MID change per request
+	MakeSMBHeader(SMB_READ_ANDX,CIFS_FLAGS1,handle->unicode?CIFS_FLAGS2_UNICODE:CIFS_FLAGS2,handle);
+
+	pos = SMB_HEADER_SIZE;
+	ptr = handle->message.smb;
+	setUChar(ptr, pos, 12);
+	pos++;				      /*** Word count ***/
+	setUChar(ptr, pos, 0xff);
+	pos++;
+	setUChar(ptr, pos, 0);
+	pos++;          /*** Reserved must be 0 ***/
+	pos += 2;	    /*** Next AndX Offset ***/
+	setUShort(ptr, pos, fid->sfid);
+	pos += 2;					    /*** FID ***/
+	pos += 4;						 /*** Offset ***/
+	pos += 2;		/*** MaxCount ***/
+	pos += 2;		/*** MinCount ***/
+	setUInt(ptr, pos, 0);
+	pos += 4;       /*** Reserved must be 0 ***/
+	pos += 2;	    /*** Remaining ***/
+	pos += 4;       /*** OffsetHIGH ***/
+	pos += 2;	    /*** Byte count ***/
+
+	handle->message.msg = NBT_SESSISON_MSG;
+	handle->message.length = htons(pos);
+
+	pos += 4;
+
+	while(1)
 	{
-		if((size-totalread) > SMB_MAX_TRANSMIT_SIZE)
-			nextread=SMB_MAX_TRANSMIT_SIZE;
-		else
-			nextread=size-totalread;
+		// Fill the window, a slot left with part of its range after a short reply asks for the rest first
+		for(i=0;i<window;i++)
+		{
+			if(slots[i].busy) continue;
 
-		MakeSMBHeader(SMB_READ_ANDX,CIFS_FLAGS1,handle->unicode?CIFS_FLAGS2_UNICODE:CIFS_FLAGS2,handle);
+			if(slots[i].len==0) {
+				if(totalsent>=filled) continue;
 
-		pos = SMB_HEADER_SIZE;
-		ptr = handle->message.smb;
-		setUChar(ptr, pos, 12);
-		pos++;				      /*** Word count ***/
-		setUChar(ptr, pos, 0xff);
-		pos++;
-		setUChar(ptr, pos, 0);
-		pos++;          /*** Reserved must be 0 ***/
-		pos += 2;	    /*** Next AndX Offset ***/
-		setUShort(ptr, pos, fid->sfid);
-		pos += 2;					    /*** FID ***/
-		setUInt(ptr, pos, (offset+totalread) & 0xffffffff);
-		pos += 4;						 /*** Offset ***/
-
-		setUShort(ptr, pos, nextread & 0xffff);
-		pos += 2;
-		setUShort(ptr, pos, nextread & 0xffff);
-		pos += 2;
-		setUInt(ptr, pos, 0);
-		pos += 4;       /*** Reserved must be 0 ***/
-		setUShort(ptr, pos, nextread & 0xffff);
-		pos += 2;	    /*** Remaining ***/
-		setUInt(ptr, pos, (offset+totalread) >> 32);  // offset high
-		pos += 4;       /*** OffsetHIGH ***/
-		pos += 2;	    /*** Byte count ***/
+				if((filled-totalsent) > SMB_MAX_TRANSMIT_SIZE)
+					nextread=SMB_MAX_TRANSMIT_SIZE;
+				else
+					nextread=filled-totalsent;
 
-		handle->message.msg = NBT_SESSISON_MSG;
-		handle->message.length = htons(pos);
+				slots[i].pos = totalsent;
+				slots[i].len = nextread;
+				totalsent += nextread;
+			}
 
-		pos += 4;
+			setUShort(ptr, SMB_OFFSET_MID, slots[i].mid);
+			setUInt(ptr, SMB_HEADER_SIZE+7, (offset+slots[i].pos) & 0xffffffff);
+			setUShort(ptr, SMB_HEADER_SIZE+11, slots[i].len & 0xffff);
+			setUShort(ptr, SMB_HEADER_SIZE+13, slots[i].len & 0xffff);
+			setUShort(ptr, SMB_HEADER_SIZE+19, slots[i].len & 0xffff);
+			setUInt(ptr, SMB_HEADER_SIZE+21, (offset+slots[i].pos) >> 32);
 
-		ret = smb_send(handle->sck_server,(char*)&handle->message, pos);
-		if(ret<0) goto failed;
+			ret = smb_send(handle->sck_server,(char*)&handle->message, pos);
+			if(ret<0) goto failed;
 
-		/*** SMBCheck  ***/
-		if(SMBCheck(SMB_READ_ANDX,handle)!=SMB_SUCCESS) goto failed;
+			slots[i].busy = true;
+			pending++;
+		}
 
-		ptr = handle->message.smb;
-		// Retrieve data length for this packet
-		length = getUShort(ptr,(SMB_HEADER_SIZE+11));
+		if(pending == 0) break;
 
-		if(length==0)
-			break;
+		// Wait for a NBT session message, skipping anything else
+		do {
+			ret = smb_recv(handle->sck_server, nbt, 4);
+			if(ret!=4) goto failed;
+
+			readlen = (u32)((nbt[1]<<16)|(nbt[2]<<8)|nbt[3]);
+			if(nbt[0]!=NBT_SESSISON_MSG && readlen>0) {
+				if(smb_discard(handle->sck_server, resp, sizeof(resp), readlen)!=SMB_SUCCESS) goto failed;
+			}
+		} while(nbt[0]!=NBT_SESSISON_MSG);
+
+		if(readlen<SMB_READANDX_RESP_SIZE) goto failed;
 
-		// Retrieve offset to data
-		ofs = getUShort(ptr,(SMB_HEADER_SIZE+13));
-		memcpy(&buffer[totalread],&ptr[ofs],length);
-		totalread+=length;
+		ret = smb_recv(handle->sck_server, resp, SMB_READANDX_RESP_SIZE);
+		if(ret!=SMB_READANDX_RESP_SIZE) goto failed;
+
+		/*** Do basic SMB Header checks ***/
+		if(getUInt(resp,SMB_OFFSET_PROTO)!=SMB_PROTO) goto failed;
+		if(getUChar(resp,SMB_OFFSET_CMD)!=SMB_READ_ANDX) goto failed;
+		if(getUInt(resp,SMB_OFFSET_NTSTATUS)) goto failed;
+
+		mid = getUShort(resp,SMB_OFFSET_MID);
+		for(i=0;i<window;i++) {
+			if(slots[i].busy && slots[i].mid==mid) break;
+		}
+		if(i==window) goto failed;
+
+		// Retrieve data length and offset for this packet
+		length = getUShort(resp,(SMB_HEADER_SIZE+11));
+		ofs = getUShort(resp,(SMB_HEADER_SIZE+13));
+		if(length>slots[i].len) goto failed;
+		if(length>0 && (ofs<SMB_READANDX_RESP_SIZE || (ofs+length)>readlen)) goto failed;
+		if(length==0) ofs = SMB_READANDX_RESP_SIZE;
+
+		if(smb_discard(handle->sck_server, resp, sizeof(resp), ofs-SMB_READANDX_RESP_SIZE)!=SMB_SUCCESS) goto failed;
+		if(length>0) {
+			ret = smb_recv(handle->sck_server, &buffer[slots[i].pos], length);
+			if(ret!=length) goto failed;
+		}
+		if(smb_discard(handle->sck_server, resp, sizeof(resp), readlen-ofs-length)!=SMB_SUCCESS) goto failed;
+
+		// Servers may return less than asked for anywhere, only an empty reply marks the end of the file
+		if(length==0) {
+			if(slots[i].pos<filled) filled = slots[i].pos;
+			slots[i].len = 0;
+		} else {
+			slots[i].pos += length;
+			slots[i].len -= length;
+			if(slots[i].pos>=filled) slots[i].len = 0;
+		}
+
+		slots[i].busy = false;
+		pending--;
 	}
-	return size;
+	return filled;
 
 failed:
+	clear_network(handle->sck_server,handle->message.smb);
 	handle->conn_valid = false;
 	return SMB_ERROR;
 }
@@ -22,6 +22,7 @@
 #define MAX_SMB_MOUNTED 10
 
 static lwp_t cache_thread = LWP_THREAD_NULL;
+static lwpq_t cache_queue = LWP_TQUEUE_NULL;
 static SMBDIRENTRY last_dentry;
 static int last_env=-1;
 static char last_path[SMB_MAXPATH];
@@ -36,6 +37,7 @@ typedef struct
 	unsigned short access;
 	int env;
 	u32 attributes;
+	off_t ra_next;
 } SMBFILESTRUCT;
 
 typedef struct
@@ -53,13 +55,16 @@ static unsigned short smbFlags = SMB_SRCH_DIRECTORY | SMB_SRCH_READONLY;
 ///////////////////////////////////////////
 #define SMB_READ_BUFFERSIZE				65472
 #define SMB_WRITE_BUFFERSIZE			(60*1024)
+#define SMB_READ_PREFETCH				2
 
-typedef struct
+typedef struct _smb_cache_page
 {
 	off_t offset;
-	u64 last_used;
+	off_t len;
 	SMBFILESTRUCT *file;
 	void *ptr;
+	struct _smb_cache_page *prev;
+	struct _smb_cache_page *next;
 } smb_cache_page;
 
 typedef struct
@@ -94,13 +99,20 @@ typedef struct
 
 	smb_write_cache SMBWriteCache;
 	smb_cache_page *SMBReadAheadCache;
+	smb_cache_page *SMBReadAheadMRU;
+	smb_cache_page *SMBReadAheadLRU;
 	int SMB_RA_pages;
 
+	SMBFILESTRUCT *SMBPrefetchFile;
+	off_t SMBPrefetchOffset;
+
 	mutex_t _SMB_mutex;
 } smb_env;
 
 static smb_env SMBEnv[MAX_SMB_MOUNTED];
 
+static void PrefetchSMBCache(smb_env *env);
+
 static inline void _SMB_lock(int i)
 {
 	if(SMBEnv[i]._SMB_mutex!=LWP_MUTEX_NULL) LWP_MutexLock(SMBEnv[i]._SMB_mutex);
@@ -187,8 +199,11 @@ static void DestroySMBReadAheadCache(const char *name)
 		}
 		free(env->SMBReadAheadCache);
 		env->SMBReadAheadCache = NULL;
+		env->SMBReadAheadMRU = NULL;
+		env->SMBReadAheadLRU = NULL;
 		env->SMB_RA_pages = 0;
 	}
+	env->SMBPrefetchFile = NULL;
 	FlushWriteSMBCache(env->name);
 
 	if(env->SMBWriteCache.ptr)
@@ -203,12 +218,23 @@ static void DestroySMBReadAheadCache(const char *name)
 static void *process_cache_thread(void *ptr)
 {
 	int i;
+	struct timespec tv;
+
+	tv.tv_sec = 0;
+	tv.tv_nsec = 10000000;
+
 	while (1)
 	{
 		for(i=0;i<MAX_SMB_MOUNTED ;i++)
 		{
 			if(SMBEnv[i].SMBCONNECTED)
 			{
+				if (SMBEnv[i].SMBPrefetchFile != NULL)
+				{
+					_SMB_lock(i);
+					PrefetchSMBCache(&SMBEnv[i]);
+					_SMB_unlock(i);
+				}
 				if (SMBEnv[i].SMBWriteCache.used > 0)
 				{
 					if (ticks_to_millisecs(gettime())-ticks_to_millisecs(SMBEnv[i].SMBWriteCache.used) > 500)
@@ -220,7 +246,7 @@ static void *process_cache_thread(void *ptr)
 				}
 			}
 		}
-		usleep(10000);
+		LWP_ThreadTimedSleep(cache_queue, &tv);
 	}
 	return NULL;
 }
@@ -251,8 +277,10 @@ static void SMBEnableReadAhead(const char *name, u32 pages)
 	for (i = 0; i < env->SMB_RA_pages; i++)
 	{
 		env->SMBReadAheadCache[i].offset = 0;
-		env->SMBReadAheadCache[i].last_used = 0;
+		env->SMBReadAheadCache[i].len = 0;
 		env->SMBReadAheadCache[i].file = NULL;
+		env->SMBReadAheadCache[i].prev = (i > 0) ? &env->SMBReadAheadCache[i - 1] : NULL;
+		env->SMBReadAheadCache[i].next = (i < env->SMB_RA_pages - 1) ? &env->SMBReadAheadCache[i + 1] : NULL;
 		env->SMBReadAheadCache[i].ptr = memalign(32, SMB_READ_BUFFERSIZE);
 		if (env->SMBReadAheadCache[i].ptr == NULL)
 		{
@@ -266,6 +294,41 @@ static void SMBEnableReadAhead(const char *name, u32 pages)
 		}
 		memset(env->SMBReadAheadCache[i].ptr, 0, SMB_READ_BUFFERSIZE);
 	}
+	env->SMBReadAheadMRU = &env->SMBReadAheadCache[0];
+	env->SMBReadAheadLRU = &env->SMBReadAheadCache[env->SMB_RA_pages - 1];
+}
+
+static void UnlinkSMBCachePage(smb_env *env, smb_cache_page *page)
+{
+	if (page->prev) page->prev->next = page->next;
+	else env->SMBReadAheadMRU = page->next;
+	if (page->next) page->next->prev = page->prev;
+	else env->SMBReadAheadLRU = page->prev;
+}
+
+// move page to the most recently used end of the list
+static void TouchSMBCachePage(smb_env *env, smb_cache_page *page)
+{
+	if (env->SMBReadAheadMRU == page) return;
+
+	UnlinkSMBCachePage(env, page);
+	page->prev = NULL;
+	page->next = env->SMBReadAheadMRU;
+	env->SMBReadAheadMRU->prev = page;
+	env->SMBReadAheadMRU = page;
+}
+
+// invalidate page and make it the next one to be recycled
+static void DropSMBCachePage(smb_env *env, smb_cache_page *page)
+{
+	page->file = NULL;
+	if (env->SMBReadAheadLRU == page) return;
+
+	UnlinkSMBCachePage(env, page);
+	page->next = NULL;
+	page->prev = env->SMBReadAheadLRU;
+	env->SMBReadAheadLRU->next = page;
+	env->SMBReadAheadLRU = page;
 }
 
 // clear cache from file
@@ -280,115 +343,152 @@ static void ClearSMBFileCache(SMBFILESTRUCT *file)
 		if (SMBEnv[j].SMBReadAheadCache[i].file == file)
 		{
 			SMBEnv[j].SMBReadAheadCache[i].offset = 0;
-			SMBEnv[j].SMBReadAheadCache[i].last_used = 0;
-			SMBEnv[j].SMBReadAheadCache[i].file = NULL;
-			memset(SMBEnv[j].SMBReadAheadCache[i].ptr, 0, SMB_READ_BUFFERSIZE);
+			SMBEnv[j].SMBReadAheadCache[i].len = 0;
+			DropSMBCachePage(&SMBEnv[j], &SMBEnv[j].SMBReadAheadCache[i]);
 		}
 	}
+	if (SMBEnv[j].SMBPrefetchFile == file)
+		SMBEnv[j].SMBPrefetchFile = NULL;
 }
 
-static int ReadSMBFromCache(void *buf, size_t len, SMBFILESTRUCT *file)
+static smb_cache_page* FindSMBCachePage(smb_env *env, SMBFILESTRUCT *file, off_t offset)
 {
-	int i,j, leastUsed;
-	off_t new_offset, rest;
-	j=file->env;
-
-	if ( len == 0 ) return 0;
+	int i;
 
-	if (SMBEnv[j].SMBReadAheadCache == NULL)
+	for (i = 0; i < env->SMB_RA_pages; i++)
 	{
-		if (SMB_ReadFile(buf, len, file->offset, file->handle) <= 0)
-		{
-			return -1;
-		}
-		return 0;
+		if (env->SMBReadAheadCache[i].file == file &&
+			offset >= env->SMBReadAheadCache[i].offset &&
+			offset < (env->SMBReadAheadCache[i].offset + env->SMBReadAheadCache[i].len))
+			return &env->SMBReadAheadCache[i];
 	}
+	return NULL;
+}
 
-	new_offset = file->offset;
-	rest = len;
+// fill least recently used page with new data
+static smb_cache_page* FillSMBCachePage(smb_env *env, SMBFILESTRUCT *file, off_t offset)
+{
+	int i;
+	smb_cache_page *page = env->SMBReadAheadLRU;
 
-continue_read:
+	//do not intersect with existing pages
+	for (i = 0; i < env->SMB_RA_pages; i++)
+	{
+		if ( &env->SMBReadAheadCache[i] == page ) continue;
+		if ( env->SMBReadAheadCache[i].file != file ) continue;
 
-	for (i = 0; i < SMBEnv[j].SMB_RA_pages; i++)
+		if ( (offset < env->SMBReadAheadCache[i].offset + env->SMBReadAheadCache[i].len) &&
+			 (offset + SMB_READ_BUFFERSIZE > env->SMBReadAheadCache[i].offset) )
+			DropSMBCachePage(env, &env->SMBReadAheadCache[i]);
+	}
+
+	off_t cache_to_read = file->len - offset;
+	if ( cache_to_read > SMB_READ_BUFFERSIZE )
 	{
-		if (SMBEnv[j].SMBReadAheadCache[i].file == file)
-		{
-			if ((new_offset >= SMBEnv[j].SMBReadAheadCache[i].offset) &&
-				(new_offset < (SMBEnv[j].SMBReadAheadCache[i].offset + SMB_READ_BUFFERSIZE)))
-			{
-				//we hit the page
-				//copy as much as we can
-				SMBEnv[j].SMBReadAheadCache[i].last_used = gettime();
-
-				off_t buffer_used = (SMBEnv[j].SMBReadAheadCache[i].offset + SMB_READ_BUFFERSIZE) - new_offset;
-				if (buffer_used > rest) buffer_used = rest;
-				memcpy(buf, SMBEnv[j].SMBReadAheadCache[i].ptr + (new_offset - SMBEnv[j].SMBReadAheadCache[i].offset), buffer_used);
-				buf += buffer_used;
-				rest -= buffer_used;
-				new_offset += buffer_used;
-
-				if (rest == 0)
-				{
-					return 0;
-				}
-				goto continue_read;
-			}
-		}
+		cache_to_read = SMB_READ_BUFFERSIZE;
 	}
 
-	leastUsed = 0;
-	for ( i = 1; i < SMBEnv[j].SMB_RA_pages; i++)
+	page->file = NULL;
+	int read=0, readed;
+	while(read<cache_to_read)
 	{
-		if ((SMBEnv[j].SMBReadAheadCache[i].last_used < SMBEnv[j].SMBReadAheadCache[leastUsed].last_used))
-			leastUsed = i;
+		readed = SMB_ReadFile(page->ptr+read, cache_to_read-read, offset+read, file->handle);
+		if ( readed <=0 )
+		{
+			DropSMBCachePage(env, page);
+			return NULL;
+		}
+		read += readed;
 	}
 
-	//fill least used page with new data
+	page->offset = offset;
+	page->len = cache_to_read;
+	page->file = file;
+	TouchSMBCachePage(env, page);
+	return page;
+}
 
-	off_t cache_offset = new_offset;
+// called from the cache thread with the environment locked
+static void PrefetchSMBCache(smb_env *env)
+{
+	int i, depth;
+	off_t offset;
+	smb_cache_page *page;
+	SMBFILESTRUCT *file = env->SMBPrefetchFile;
 
-	//do not interset with existing pages
-	for (i = 0; i < SMBEnv[j].SMB_RA_pages; i++)
-	{
-		if ( i == leastUsed ) continue;
-		if ( SMBEnv[j].SMBReadAheadCache[i].file != file ) continue;
+	env->SMBPrefetchFile = NULL;
+	if (file == NULL || env->SMBReadAheadCache == NULL)
+		return;
 
-		if ( (cache_offset < SMBEnv[j].SMBReadAheadCache[i].offset ) && (cache_offset + SMB_READ_BUFFERSIZE > SMBEnv[j].SMBReadAheadCache[i].offset) )
-		{
-			//tail of new page intersects with some cache block, clear page
-			SMBEnv[j].SMBReadAheadCache[i].file = NULL;
-		}
+	// never recycle more than half of the pages for one stream
+	depth = env->SMB_RA_pages / 2;
+	if (depth > SMB_READ_PREFETCH) depth = SMB_READ_PREFETCH;
 
-		if ( (cache_offset >= SMBEnv[j].SMBReadAheadCache[i].offset ) && (cache_offset < SMBEnv[j].SMBReadAheadCache[i].offset + SMB_READ_BUFFERSIZE ) )
+	offset = env->SMBPrefetchOffset;
+	for (i = 0; i < depth && offset < file->len; i++)
+	{
+		page = FindSMBCachePage(env, file, offset);
+		if (page == NULL)
 		{
-			//head of new page intersects with some cache block, clear page
-			SMBEnv[j].SMBReadAheadCache[i].file = NULL;
+			page = FillSMBCachePage(env, file, offset);
+			if (page == NULL)
+				return;
 		}
+		offset = page->offset + page->len;
 	}
+}
 
-	off_t cache_to_read = file->len - cache_offset;
-	if ( cache_to_read > SMB_READ_BUFFERSIZE )
+static int ReadSMBFromCache(void *buf, size_t len, SMBFILESTRUCT *file)
+{
+	off_t new_offset, rest;
+	smb_cache_page *page;
+	smb_env *env = &SMBEnv[file->env];
+
+	if ( len == 0 ) return 0;
+
+	if (env->SMBReadAheadCache == NULL)
 	{
-		cache_to_read = SMB_READ_BUFFERSIZE;
+		if (SMB_ReadFile(buf, len, file->offset, file->handle) <= 0)
+		{
+			return -1;
+		}
+		return 0;
 	}
 
-	int read=0, readed;
-	while(read<cache_to_read)
+	new_offset = file->offset;
+	rest = len;
+
+	while (rest > 0)
 	{
-		readed = SMB_ReadFile(SMBEnv[j].SMBReadAheadCache[leastUsed].ptr+read, cache_to_read-read, cache_offset+read, file->handle);
-		if ( readed <=0 )
+		page = FindSMBCachePage(env, file, new_offset);
+		if (page == NULL)
 		{
-			SMBEnv[j].SMBReadAheadCache[leastUsed].file = NULL;
-			return -1;
+			page = FillSMBCachePage(env, file, new_offset);
+			if (page == NULL)
+				return -1;
 		}
-		read += readed;
+		else
+			TouchSMBCachePage(env, page);
+
+		//copy as much as we can
+		off_t buffer_used = (page->offset + page->len) - new_offset;
+		if (buffer_used > rest) buffer_used = rest;
+		memcpy(buf, page->ptr + (new_offset - page->offset), buffer_used);
+		buf += buffer_used;
+		rest -= buffer_used;
+		new_offset += buffer_used;
 	}
-	SMBEnv[j].SMBReadAheadCache[leastUsed].last_used = gettime();
 
-	SMBEnv[j].SMBReadAheadCache[leastUsed].offset = cache_offset;
-	SMBEnv[j].SMBReadAheadCache[leastUsed].file = file;
+	// sequential access - let the cache thread fetch what follows while the caller consumes this
+	if (file->offset == file->ra_next && (page->offset + page->len) < file->len)
+	{
+		env->SMBPrefetchFile = file;
+		env->SMBPrefetchOffset = page->offset + page->len;
+		LWP_ThreadSignal(cache_queue);
+	}
+	file->ra_next = new_offset;
 
-	goto continue_read;
+	return 0;
 }
 
 static int WriteSMBUsingCache(const char *buf, size_t len, SMBFILESTRUCT *file)
@@ -623,6 +723,7 @@ static int __smb_open(struct _reent *r, void *fileStruct, const char *path, int
 		file->offset = file->len;
 	else
 		file->offset = 0;
+	file->ra_next = file->offset;
 
 	file->access=access;
 
@@ -1510,9 +1611,13 @@ bool smbInitDevice(const char* name, const char *user, const char *password, con
 			SMBEnv[i].first_item_dir=false;
 			SMBEnv[i].pos=i;
 			SMBEnv[i].SMBReadAheadCache=NULL;
+			SMBEnv[i].SMBPrefetchFile=NULL;
 			LWP_MutexInit(&SMBEnv[i]._SMB_mutex, false);
 		}
 
+		if(cache_queue == LWP_TQUEUE_NULL)
+			LWP_InitQueue(&cache_queue);
+
 		if(cache_thread == LWP_THREAD_NULL)
 			if(LWP_CreateThread(&cache_thread, process_cache_thread, NULL, NULL, 0, LWP_PRIO_NORMAL) != 0)
 				return false;
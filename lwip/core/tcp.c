@@ -52,6 +52,13 @@
 #include "lwip/tcp.h"
 #if LWIP_TCP
 
+#if !LWIP_WND_SCALE && TCP_WND > 0xffff
+#error "TCP_WND larger than 0xffff needs LWIP_WND_SCALE"
+#endif
+#if LWIP_WND_SCALE && ((TCP_WND >> TCP_RCV_SCALE) > 0xffff || TCP_RCV_SCALE > 14)
+#error "TCP_WND >> TCP_RCV_SCALE must fit into 16 bits (and TCP_RCV_SCALE <= 14)"
+#endif
+
 /* Incremented every coarse grained timer shot (typically every 500 ms). */
 u32_t tcp_ticks;
 const u8_t tcp_backoff[13] =
@@ -366,7 +373,7 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
     tcp_ack_now(pcb);
   }
 
-  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"U16_F" (%"U16_F").\n",
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: recveived %"U16_F" bytes, wnd %"U32_F" (%"U32_F").\n",
          len, pcb->rcv_wnd, TCP_WND - pcb->rcv_wnd));
 }
 
@@ -416,7 +423,7 @@ err_t
 tcp_connect(struct tcp_pcb *pcb, struct ip_addr *ipaddr, u16_t port,
       err_t (* connected)(void *arg, struct tcp_pcb *tpcb, err_t err))
 {
-  u32_t optdata;
+  u32_t optdata[TCP_SYNOPTS_LEN/4];
   err_t ret;
   u32_t iss;
 
@@ -448,13 +455,8 @@ tcp_connect(struct tcp_pcb *pcb, struct ip_addr *ipaddr, u16_t port,
 
   snmp_inc_tcpactiveopens();
   
-  /* Build an MSS option */
-  optdata = htonl(((u32_t)2 << 24) | 
-      ((u32_t)4 << 16) | 
-      (((u32_t)pcb->mss / 256) << 8) |
-      (pcb->mss & 255));
-
-  ret = tcp_enqueue(pcb, NULL, 0, TCP_SYN, 0, (u8_t *)&optdata, 4);
+  /* Build the MSS, window scale and SACK permitted options */
+  ret = tcp_enqueue(pcb, NULL, 0, TCP_SYN, 0, (u8_t *)optdata, tcp_build_synopts(pcb, optdata));
   if (ret == ERR_OK) { 
     tcp_output(pcb);
   }
@@ -838,6 +840,18 @@ tcp_alloc(u8_t prio)
     pcb->sv = 3000 / TCP_SLOW_INTERVAL;
     pcb->rtime = 0;
     pcb->cwnd = 1;
+#if LWIP_WND_SCALE || LWIP_TCP_SACK
+    /* Offer every option we support; tcp_parseopt() drops the ones the
+       peer does not send in its SYN. */
+    pcb->opts = 0;
+#if LWIP_WND_SCALE
+    pcb->opts |= TOF_WND_SCALE;
+    pcb->rcv_scale = TCP_RCV_SCALE;
+#endif
+#if LWIP_TCP_SACK
+    pcb->opts |= TOF_SACK;
+#endif
+#endif
     iss = tcp_next_iss();
     pcb->snd_wl2 = iss;
     pcb->snd_nxt = iss;
@@ -77,6 +77,9 @@ struct tcp_pcb *tcp_input_pcb;
 static err_t tcp_process(struct tcp_pcb *pcb);
 static u8_t tcp_receive(struct tcp_pcb *pcb);
 static void tcp_parseopt(struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+static void tcp_parsesack(struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
 
 static err_t tcp_listen_input(struct tcp_pcb_listen *pcb);
 static err_t tcp_timewait_input(struct tcp_pcb *pcb);
@@ -348,7 +351,7 @@ static err_t
 tcp_listen_input(struct tcp_pcb_listen *pcb)
 {
   struct tcp_pcb *npcb;
-  u32_t optdata;
+  u32_t optdata[TCP_SYNOPTS_LEN/4];
 
   /* In the LISTEN state, we check for incoming SYN segments,
      creates a new PCB, and responds with a SYN|ACK. */
@@ -395,13 +398,9 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
 
     snmp_inc_tcppassiveopens();
 
-    /* Build an MSS option. */
-    optdata = htonl(((u32_t)2 << 24) |
-        ((u32_t)4 << 16) |
-        (((u32_t)npcb->mss / 256) << 8) |
-        (npcb->mss & 255));
-    /* Send a SYN|ACK together with the MSS option. */
-    tcp_enqueue(npcb, NULL, 0, TCP_SYN | TCP_ACK, 0, (u8_t *)&optdata, 4);
+    /* Send a SYN|ACK together with the MSS option and the window
+       scale/SACK permitted options the peer offered. */
+    tcp_enqueue(npcb, NULL, 0, TCP_SYN | TCP_ACK, 0, (u8_t *)optdata, tcp_build_synopts(npcb, optdata));
     return tcp_output(npcb);
   }
   return ERR_OK;
@@ -634,29 +633,39 @@ tcp_receive(struct tcp_pcb *pcb)
   s32_t off;
   s16_t m;
   u32_t right_wnd_edge;
+  u32_t wnd;
   u16_t new_tot_len;
   u8_t accepted_inseq = 0;
 
   if (flags & TCP_ACK) {
     right_wnd_edge = pcb->snd_wnd + pcb->snd_wl1;
+    wnd = TCP_SND_WND_SCALE(pcb, tcphdr->wnd);
 
     /* Update window. */
     if (TCP_SEQ_LT(pcb->snd_wl1, seqno) ||
        (pcb->snd_wl1 == seqno && TCP_SEQ_LT(pcb->snd_wl2, ackno)) ||
-       (pcb->snd_wl2 == ackno && tcphdr->wnd > pcb->snd_wnd)) {
-      pcb->snd_wnd = tcphdr->wnd;
+       (pcb->snd_wl2 == ackno && wnd > pcb->snd_wnd)) {
+      pcb->snd_wnd = wnd;
       pcb->snd_wl1 = seqno;
       pcb->snd_wl2 = ackno;
       LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: window update %"U32_F"\n", pcb->snd_wnd));
 #if TCP_WND_DEBUG
     } else {
-      if (pcb->snd_wnd != tcphdr->wnd) {
+      if (pcb->snd_wnd != wnd) {
         LWIP_DEBUGF(TCP_WND_DEBUG, ("tcp_receive: no window update lastack %"U32_F" snd_max %"U32_F" ackno %"U32_F" wl1 %"U32_F" seqno %"U32_F" wl2 %"U32_F"\n",
                                pcb->lastack, pcb->snd_max, ackno, pcb->snd_wl1, seqno, pcb->snd_wl2));
       }
 #endif /* TCP_WND_DEBUG */
     }
 
+#if LWIP_TCP_SACK
+    /* Mark what the peer holds beyond the cumulative ACK before
+       the duplicate ACK handling below looks for holes. */
+    if ((pcb->opts & TOF_SACK) && pcb->unacked != NULL && TCPH_HDRLEN(tcphdr) > 5) {
+      tcp_parsesack(pcb);
+    }
+#endif /* LWIP_TCP_SACK */
+
     if (pcb->lastack == ackno) {
       pcb->acked = 0;
 
@@ -687,6 +696,12 @@ tcp_receive(struct tcp_pcb *pcb)
             if ((u16_t)(pcb->cwnd + pcb->mss) > pcb->cwnd) {
               pcb->cwnd += pcb->mss;
             }
+#if LWIP_TCP_SACK
+            /* Fill the next hole the peer told us about. */
+            if (pcb->opts & TOF_SACK) {
+              tcp_rexmit_sack(pcb);
+            }
+#endif /* LWIP_TCP_SACK */
           }
         }
       } else {
@@ -705,6 +720,13 @@ tcp_receive(struct tcp_pcb *pcb)
       if (pcb->flags & TF_INFR) {
         pcb->flags &= ~TF_INFR;
         pcb->cwnd = pcb->ssthresh;
+#if LWIP_TCP_SACK
+        /* Segments retransmitted during this recovery may need to go
+           out again in the next one. */
+        for (next = pcb->unacked; next != NULL; next = next->next) {
+          next->flags &= ~TF_SEG_REXMIT;
+        }
+#endif /* LWIP_TCP_SACK */
       }
 
       /* Reset the number of retransmissions. */
@@ -1025,6 +1047,11 @@ tcp_receive(struct tcp_pcb *pcb)
         /* We get here if the incoming segment is out-of-sequence. */
         tcp_ack_now(pcb);
 #if TCP_QUEUE_OOSEQ
+#if LWIP_TCP_SACK
+        /* The ACK goes out after input processing, so it will already
+           report this segment in its first SACK block. */
+        pcb->sack_last = seqno;
+#endif /* LWIP_TCP_SACK */
         /* We queue the segment on the ->ooseq queue. */
         if (pcb->ooseq == NULL) {
           pcb->ooseq = tcp_seg_copy(&inseg);
@@ -1159,51 +1186,126 @@ tcp_receive(struct tcp_pcb *pcb)
 /*
  * tcp_parseopt:
  *
- * Parses the options contained in the incoming segment. (Code taken
- * from uIP with only small changes.)
+ * Parses the options contained in the incoming SYN segment. (Code taken
+ * from uIP with only small changes.) Window scaling and SACK stay in
+ * effect only if both ends sent the option in their SYN.
  *
  */
 
 static void
 tcp_parseopt(struct tcp_pcb *pcb)
 {
-  u8_t c;
+  u8_t c, optlen;
   u8_t *opts, opt;
   u16_t mss;
+#if LWIP_WND_SCALE || LWIP_TCP_SACK
+  u8_t seen = 0;
+#endif
 
   opts = (u8_t *)tcphdr + TCP_HLEN;
 
-  /* Parse the TCP MSS option, if present. */
+  /* Parse the TCP MSS, window scale and SACK permitted options, if present. */
   if(TCPH_HDRLEN(tcphdr) > 0x5) {
-    for(c = 0; c < (TCPH_HDRLEN(tcphdr) - 5) << 2 ;) {
+    optlen = (TCPH_HDRLEN(tcphdr) - 5) << 2;
+    for(c = 0; c < optlen ;) {
       opt = opts[c];
       if (opt == 0x00) {
         /* End of options. */
-  break;
+        break;
       } else if (opt == 0x01) {
         ++c;
         /* NOP option. */
-      } else if (opt == 0x02 &&
-        opts[c + 1] == 0x04) {
-        /* An MSS option with the right option length. */
-        mss = (opts[c + 2] << 8) | opts[c + 3];
-        pcb->mss = mss > TCP_MSS? TCP_MSS: mss;
-
-        /* And we are done processing options. */
+      } else if (c + 1 >= optlen || opts[c + 1] < 2) {
+        /* If the length field is missing or too small, the options are
+           malformed and we don't process them further. */
         break;
       } else {
-  if (opts[c + 1] == 0) {
-          /* If the length field is zero, the options are malformed
-             and we don't process them further. */
-          break;
+        if (opt == 0x02 && opts[c + 1] == 0x04) {
+          /* An MSS option with the right option length. */
+          mss = (opts[c + 2] << 8) | opts[c + 3];
+          pcb->mss = mss > TCP_MSS? TCP_MSS: mss;
+        }
+#if LWIP_WND_SCALE
+        else if (opt == 0x03 && opts[c + 1] == 0x03) {
+          /* Window scale option, RFC 7323 limits the shift to 14. */
+          pcb->snd_scale = opts[c + 2] > 14? 14: opts[c + 2];
+          seen |= TOF_WND_SCALE;
         }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+        else if (opt == 0x04 && opts[c + 1] == 0x02) {
+          /* SACK permitted option. */
+          seen |= TOF_SACK;
+        }
+#endif /* LWIP_TCP_SACK */
         /* All other options have a length field, so that we easily
            can skip past them. */
         c += opts[c + 1];
       }
     }
   }
+
+#if LWIP_WND_SCALE || LWIP_TCP_SACK
+  pcb->opts &= seen;
+#endif
+#if LWIP_WND_SCALE
+  if (!(pcb->opts & TOF_WND_SCALE)) {
+    pcb->snd_scale = 0;
+    pcb->rcv_scale = 0;
+  }
+#endif /* LWIP_WND_SCALE */
+}
+
+#if LWIP_TCP_SACK
+/*
+ * tcp_parsesack:
+ *
+ * Marks every segment on the ->unacked queue that is completely
+ * covered by one of the SACK blocks of the incoming ACK.
+ *
+ */
+
+static void
+tcp_parsesack(struct tcp_pcb *pcb)
+{
+  u8_t c, i, optlen;
+  u8_t *opts;
+  u32_t left, right, segno;
+  struct tcp_seg *seg;
+
+  opts = (u8_t *)tcphdr + TCP_HLEN;
+  optlen = (TCPH_HDRLEN(tcphdr) - 5) << 2;
+
+  for(c = 0; c < optlen ;) {
+    if (opts[c] == 0x00) {
+      break;
+    } else if (opts[c] == 0x01) {
+      ++c;
+    } else if (c + 1 >= optlen || opts[c + 1] < 2 || c + opts[c + 1] > optlen) {
+      break;
+    } else {
+      if (opts[c] == 0x05) {
+        /* SACK option: a list of 8 byte left/right edge pairs, not
+           necessarily aligned. */
+        for(i = c + 2; i + 8 <= c + opts[c + 1]; i += 8) {
+          left = ((u32_t)opts[i] << 24) | ((u32_t)opts[i + 1] << 16) |
+                 ((u32_t)opts[i + 2] << 8) | opts[i + 3];
+          right = ((u32_t)opts[i + 4] << 24) | ((u32_t)opts[i + 5] << 16) |
+                  ((u32_t)opts[i + 6] << 8) | opts[i + 7];
+          for(seg = pcb->unacked; seg != NULL; seg = seg->next) {
+            segno = ntohl(seg->tcphdr->seqno);
+            if (TCP_SEQ_GEQ(segno, left) &&
+                TCP_SEQ_LEQ(segno + TCP_TCPLEN(seg), right)) {
+              seg->flags |= TF_SEG_SACKED;
+            }
+          }
+        }
+      }
+      c += opts[c + 1];
+    }
+  }
 }
+#endif /* LWIP_TCP_SACK */
 #endif /* LWIP_TCP */
 
 
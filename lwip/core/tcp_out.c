@@ -57,6 +57,9 @@
 
 /* Forward declarations.*/
 static void tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+static u8_t tcp_build_sackopts(struct tcp_pcb *pcb, u32_t *opts);
+#endif
 
 err_t
 tcp_send_ctrl(struct tcp_pcb *pcb, u8_t flags)
@@ -65,6 +68,92 @@ tcp_send_ctrl(struct tcp_pcb *pcb, u8_t flags)
   return tcp_enqueue(pcb, NULL, 0, flags, 1, NULL, 0);
 }
 
+/**
+ * Build the options of a SYN or SYN|ACK segment: MSS, plus window scale
+ * and SACK permitted if they are (still) enabled for this pcb. For a
+ * SYN|ACK tcp_parseopt() has already dropped the options the peer did
+ * not offer.
+ *
+ * @arg opts buffer of TCP_SYNOPTS_LEN bytes
+ * @return length of the options in bytes (a multiple of 4)
+ */
+u8_t
+tcp_build_synopts(struct tcp_pcb *pcb, u32_t *opts)
+{
+  u8_t n = 0;
+
+  opts[n++] = htonl(((u32_t)2 << 24) |
+      ((u32_t)4 << 16) |
+      (((u32_t)pcb->mss / 256) << 8) |
+      (pcb->mss & 255));
+#if LWIP_WND_SCALE
+  if (pcb->opts & TOF_WND_SCALE) {
+    /* NOP, window scale (kind 3, length 3, shift) */
+    opts[n++] = htonl(0x01030300UL | TCP_RCV_SCALE);
+  }
+#endif /* LWIP_WND_SCALE */
+#if LWIP_TCP_SACK
+  if (pcb->opts & TOF_SACK) {
+    /* NOP, NOP, SACK permitted (kind 4, length 2) */
+    opts[n++] = htonl(0x01010402UL);
+  }
+#endif /* LWIP_TCP_SACK */
+  return n << 2;
+}
+
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+/**
+ * Build a SACK option describing the data held on the ->ooseq queue.
+ * Contiguous segments are merged into one block; the block holding the
+ * most recently received segment goes first (RFC 2018, section 4).
+ *
+ * @arg opts buffer of 4 + 8*TCP_SACK_BLOCKS bytes
+ * @return length of the option in bytes, 0 if there is nothing to report
+ */
+static u8_t
+tcp_build_sackopts(struct tcp_pcb *pcb, u32_t *opts)
+{
+  struct tcp_seg *seg;
+  u32_t left, right;
+  u32_t blk[2*TCP_SACK_BLOCKS];
+  u8_t n, slot, first;
+
+  if (!(pcb->opts & TOF_SACK) || pcb->ooseq == NULL) {
+    return 0;
+  }
+
+  /* slot 0 is kept for the block containing the latest arrival */
+  first = 1;
+  n = 1;
+  seg = pcb->ooseq;
+  while (seg != NULL) {
+    left = seg->tcphdr->seqno;
+    right = left + TCP_TCPLEN(seg);
+    for (seg = seg->next; seg != NULL && seg->tcphdr->seqno == right; seg = seg->next) {
+      right += TCP_TCPLEN(seg);
+    }
+    if (first && TCP_SEQ_GEQ(pcb->sack_last, left) && TCP_SEQ_LT(pcb->sack_last, right)) {
+      slot = 0;
+      first = 0;
+    } else if (n < TCP_SACK_BLOCKS) {
+      slot = n++;
+    } else {
+      continue;
+    }
+    blk[2*slot] = left;
+    blk[2*slot + 1] = right;
+  }
+
+  /* first is still set if no block holds sack_last: skip slot 0 */
+  n -= first;
+  opts[0] = htonl(0x01010500UL | (2 + 8*n));
+  for (slot = 0; slot < 2*n; slot++) {
+    opts[1 + slot] = htonl(blk[2*first + slot]);
+  }
+  return 4 + 8*n;
+}
+#endif /* LWIP_TCP_SACK && TCP_QUEUE_OOSEQ */
+
 /**
  * Write data for sending (but does not send it immediately).
  *
@@ -178,6 +267,9 @@ tcp_enqueue(struct tcp_pcb *pcb, void *arg, u16_t len,
     }
     seg->next = NULL;
     seg->p = NULL;
+#if LWIP_TCP_SACK
+    seg->flags = 0;
+#endif
 
     /* first segment of to-be-queued data? */
     if (queue == NULL) {
@@ -378,6 +470,10 @@ tcp_output(struct tcp_pcb *pcb)
   struct tcp_hdr *tcphdr;
   struct tcp_seg *seg, *useg;
   u32_t wnd;
+  u8_t optlen = 0;
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+  u32_t opts[1 + 2*TCP_SACK_BLOCKS];
+#endif
 #if TCP_CWND_DEBUG
   s16_t i = 0;
 #endif /* TCP_CWND_DEBUG */
@@ -409,7 +505,11 @@ tcp_output(struct tcp_pcb *pcb)
   if (pcb->flags & TF_ACK_NOW &&
      (seg == NULL ||
       ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len > wnd)) {
-    p = pbuf_alloc(PBUF_IP, TCP_HLEN, PBUF_RAM);
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+    /* tell the peer which out of sequence data we already hold */
+    optlen = tcp_build_sackopts(pcb, opts);
+#endif
+    p = pbuf_alloc(PBUF_IP, TCP_HLEN + optlen, PBUF_RAM);
     if (p == NULL) {
       LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_output: (ACK) could not allocate pbuf\n"));
       return ERR_BUF;
@@ -424,9 +524,14 @@ tcp_output(struct tcp_pcb *pcb)
     tcphdr->seqno = htonl(pcb->snd_nxt);
     tcphdr->ackno = htonl(pcb->rcv_nxt);
     TCPH_FLAGS_SET(tcphdr, TCP_ACK);
-    tcphdr->wnd = htons(pcb->rcv_wnd);
+    tcphdr->wnd = htons(TCP_RCV_WND_SCALE(pcb, pcb->rcv_wnd));
     tcphdr->urgp = 0;
-    TCPH_HDRLEN_SET(tcphdr, 5);
+    TCPH_HDRLEN_SET(tcphdr, 5 + optlen / 4);
+#if LWIP_TCP_SACK && TCP_QUEUE_OOSEQ
+    if (optlen > 0) {
+      memcpy((u8_t *)tcphdr + TCP_HLEN, opts, optlen);
+    }
+#endif
 
     tcphdr->chksum = 0;
 #if CHECKSUM_GEN_TCP
@@ -494,9 +599,16 @@ tcp_output(struct tcp_pcb *pcb)
          * of the unacked queue, but rather at the head. We need to check for
          * this case. -STJ Jul 27, 2004 */
         if (TCP_SEQ_LT(ntohl(seg->tcphdr->seqno), ntohl(useg->tcphdr->seqno))){
-          /* add segment to head of unacked list */
-          seg->next = pcb->unacked;
-          pcb->unacked = seg;
+          /* Retransmissions (which may come from the middle of the
+           * queue when filling SACK holes) are put back in sequence
+           * order. */
+          struct tcp_seg **cur_seg = &(pcb->unacked);
+          while (*cur_seg &&
+                 TCP_SEQ_LT(ntohl((*cur_seg)->tcphdr->seqno), ntohl(seg->tcphdr->seqno))) {
+            cur_seg = &((*cur_seg)->next);
+          }
+          seg->next = *cur_seg;
+          *cur_seg = seg;
         } else {
           /* add segment to tail of unacked list */
           useg->next = seg;
@@ -531,9 +643,12 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
   /* silly window avoidance */
   if (pcb->rcv_wnd < pcb->mss) {
     seg->tcphdr->wnd = 0;
+  } else if (TCPH_FLAGS(seg->tcphdr) & TCP_SYN) {
+    /* the window in a SYN is never scaled */
+    seg->tcphdr->wnd = htons(LWIP_MIN(pcb->rcv_wnd, 0xffff));
   } else {
     /* advertise our receive window size in this TCP segment */
-    seg->tcphdr->wnd = htons(pcb->rcv_wnd);
+    seg->tcphdr->wnd = htons(TCP_RCV_WND_SCALE(pcb, pcb->rcv_wnd));
   }
 
   /* If we don't have a local IP address, we get one by
@@ -597,7 +712,7 @@ tcp_rst(u32_t seqno, u32_t ackno,
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
   TCPH_FLAGS_SET(tcphdr, TCP_RST | TCP_ACK);
-  tcphdr->wnd = htons(TCP_WND);
+  tcphdr->wnd = htons(LWIP_MIN(TCP_WND, 0xffff));
   tcphdr->urgp = 0;
   TCPH_HDRLEN_SET(tcphdr, 5);
 
@@ -624,6 +739,14 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
     return;
   }
 
+#if LWIP_TCP_SACK
+  /* The receiver may have dropped data it SACKed (RFC 2018, section 8),
+     so after a timeout everything goes out again. */
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    seg->flags = 0;
+  }
+#endif /* LWIP_TCP_SACK */
+
   /* Move all unacked segments to the head of the unsent queue */
   for (seg = pcb->unacked; seg->next != NULL; seg = seg->next);
   /* concatenate unsent queue after unacked queue */
@@ -658,6 +781,9 @@ tcp_rexmit(struct tcp_pcb *pcb)
   pcb->unacked->next = pcb->unsent;
   pcb->unsent = pcb->unacked;
   pcb->unacked = seg;
+#if LWIP_TCP_SACK
+  pcb->unsent->flags |= TF_SEG_REXMIT;
+#endif
 
   pcb->snd_nxt = ntohl(pcb->unsent->tcphdr->seqno);
 
@@ -672,6 +798,52 @@ tcp_rexmit(struct tcp_pcb *pcb)
 
 }
 
+#if LWIP_TCP_SACK
+/* Called for further duplicate ACKs during fast recovery: retransmit
+   the first segment that lies below data the peer has SACKed, was not
+   SACKed itself and was not yet retransmitted in this recovery.
+   SACKed segments are never resent here. */
+void
+tcp_rexmit_sack(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg, *prev, *hole, *hole_prev;
+
+  hole = hole_prev = prev = NULL;
+  for (seg = pcb->unacked; seg != NULL; prev = seg, seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      if (hole != NULL) {
+        break;
+      }
+    } else if (hole == NULL && !(seg->flags & TF_SEG_REXMIT)) {
+      hole = seg;
+      hole_prev = prev;
+    }
+  }
+  /* no hole, or nothing SACKed above it: the segment may still be in flight */
+  if (hole == NULL || seg == NULL) {
+    return;
+  }
+
+  /* Move the hole to the head of the unsent queue */
+  if (hole_prev != NULL) {
+    hole_prev->next = hole->next;
+  } else {
+    pcb->unacked = hole->next;
+  }
+  hole->next = pcb->unsent;
+  pcb->unsent = hole;
+  hole->flags |= TF_SEG_REXMIT;
+
+  pcb->snd_nxt = ntohl(hole->tcphdr->seqno);
+
+  /* Don't take any rtt measurements after retransmitting. */
+  pcb->rttest = 0;
+
+  snmp_inc_tcpretranssegs();
+  tcp_output(pcb);
+}
+#endif /* LWIP_TCP_SACK */
+
 
 void
 tcp_keepalive(struct tcp_pcb *pcb)
@@ -697,7 +869,7 @@ tcp_keepalive(struct tcp_pcb *pcb)
    tcphdr->dest = htons(pcb->remote_port);
    tcphdr->seqno = htonl(pcb->snd_nxt - 1);
    tcphdr->ackno = htonl(pcb->rcv_nxt);
-   tcphdr->wnd = htons(pcb->rcv_wnd);
+   tcphdr->wnd = htons(TCP_RCV_WND_SCALE(pcb, pcb->rcv_wnd));
    tcphdr->urgp = 0;
    TCPH_HDRLEN_SET(tcphdr, 5);
    
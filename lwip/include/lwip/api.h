@@ -76,6 +76,17 @@ struct netbuf {
   struct ip_addr *fromaddr;
   u16_t fromport;
   err_t err;
+  u32 credit;    /* bytes to give back to the TCP window when a loan returns */
+};
+
+/* A zero-copy TCP send that is waiting for its acknowledgement. The
+   application memory it covers stays referenced by the queued segments
+   until pcb->lastack has passed seqno. */
+struct netconn_zcreq {
+	struct netconn_zcreq *next;
+	u32 seqno;
+	void (*sent)(s32 result,void *arg);
+	void *arg;
 };
 
 struct netconn {
@@ -94,6 +105,7 @@ struct netconn {
 	u16 recvavail;
 	s32 socket;
 	void (*callback)(struct netconn *,enum netconn_evt,u32);
+	struct netconn_zcreq *zc_head,*zc_tail;
 };
 
 #endif /* __LWIP_API_H__ */
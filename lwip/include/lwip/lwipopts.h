@@ -114,8 +114,18 @@ a lot of data that needs to be copied, this should be set high. */
    TCP_SND_BUF/TCP_MSS for things to work. */
 #define TCP_SND_QUEUELEN        (36*TCP_SND_BUF/TCP_MSS)
 
-/* TCP receive window. */
-#define TCP_WND                 (2*TCP_MSS)
+/* TCP receive window. Every full sized segment in flight towards us
+   ends up in one PBUF_POOL buffer (gcif receives into the pool), so
+   the window is sized to half of the pool, leaving the rest for the
+   driver and other connections. */
+#define TCP_WND                 ((PBUF_POOL_SIZE/2)*TCP_MSS)
+
+/* The window above does not fit into 16 bits, so scale it. */
+#define LWIP_WND_SCALE          1
+#define TCP_RCV_SCALE           2
+
+/* Report out of sequence data with SACK blocks. */
+#define LWIP_TCP_SACK           1
 
 /* Maximum number of retransmissions of data segments. */
 #define TCP_MAXRTX              12
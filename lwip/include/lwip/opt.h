@@ -325,6 +325,25 @@ a lot of data that needs to be copied, this should be set high. */
 #define TCP_QUEUE_OOSEQ                 1
 #endif
 
+/* Enable RFC 7323 window scaling. Required for a TCP_WND larger than
+   0xffff. TCP_RCV_SCALE is the shift we advertise for our own receive
+   window; TCP_WND >> TCP_RCV_SCALE must fit in 16 bits. */
+#ifndef LWIP_WND_SCALE
+#define LWIP_WND_SCALE                  0
+#endif
+
+#ifndef TCP_RCV_SCALE
+#define TCP_RCV_SCALE                   0
+#endif
+
+/* Enable RFC 2018 selective acknowledgements. Out of sequence data
+   held on the ooseq queue is reported to the peer in SACK blocks and
+   SACK blocks received from the peer keep already delivered segments
+   from being retransmitted during fast recovery. */
+#ifndef LWIP_TCP_SACK
+#define LWIP_TCP_SACK                   0
+#endif
+
 /* TCP Maximum segment size. */
 #ifndef TCP_MSS
 #define TCP_MSS                         128 /* A *very* conservative default. */
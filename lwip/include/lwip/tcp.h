@@ -106,6 +106,9 @@ void             tcp_input   (struct pbuf *p, struct netif *inp);
 err_t            tcp_output  (struct tcp_pcb *pcb);
 void             tcp_rexmit  (struct tcp_pcb *pcb);
 void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK
+void             tcp_rexmit_sack (struct tcp_pcb *pcb);
+#endif /* LWIP_TCP_SACK */
 
 
 
@@ -154,6 +157,21 @@ void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
 
 #define TCP_MSL 60000  /* The maximum segment lifetime in microseconds */
 
+/* Window scaling (RFC 7323). The window field of SYN segments is never
+   scaled; every other segment carries its window shifted by the scale
+   the sender announced in its SYN. */
+#if LWIP_WND_SCALE
+#define TCP_SND_WND_SCALE(pcb, wnd) ((u32_t)(wnd) << (pcb)->snd_scale)
+#define TCP_RCV_WND_SCALE(pcb, wnd) ((u16_t)LWIP_MIN((wnd) >> (pcb)->rcv_scale, 0xffff))
+#else
+#define TCP_SND_WND_SCALE(pcb, wnd) ((u32_t)(wnd))
+#define TCP_RCV_WND_SCALE(pcb, wnd) ((u16_t)LWIP_MIN((wnd), 0xffff))
+#endif /* LWIP_WND_SCALE */
+
+/* Maximum number of SACK blocks we report in one ACK (RFC 2018: 4
+   blocks fill the option space when no timestamps are used). */
+#define TCP_SACK_BLOCKS 4
+
 /*
  * User-settable options (used with setsockopt).
  */
@@ -235,9 +253,20 @@ struct tcp_pcb {
 #define TF_GOT_FIN   (u8_t)0x20U   /* Connection was closed by the remote end. */
 #define TF_NODELAY   (u8_t)0x40U   /* Disable Nagle algorithm */
 
+#if LWIP_WND_SCALE || LWIP_TCP_SACK
+  u8_t opts;       /* SYN options in effect for this connection */
+#define TOF_WND_SCALE (u8_t)0x01U  /* Window scale option negotiated. */
+#define TOF_SACK      (u8_t)0x02U  /* SACK permitted option negotiated. */
+#endif
+
+#if LWIP_WND_SCALE
+  u8_t snd_scale;  /* shift applied to the windows the peer advertises */
+  u8_t rcv_scale;  /* shift applied to the windows we advertise */
+#endif /* LWIP_WND_SCALE */
+
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
-  u16_t rcv_wnd;   /* receiver window */
+  u32_t rcv_wnd;   /* receiver window */
   
   /* Timers */
   u32_t tmr;
@@ -283,6 +312,10 @@ struct tcp_pcb {
   struct tcp_seg *unacked;  /* Sent but unacknowledged segments. */
 #if TCP_QUEUE_OOSEQ  
   struct tcp_seg *ooseq;    /* Received out of sequence segments. */
+#if LWIP_TCP_SACK
+  u32_t sack_last;          /* seqno of the latest out of sequence arrival,
+                               reported in the first SACK block */
+#endif /* LWIP_TCP_SACK */
 #endif /* TCP_QUEUE_OOSEQ */
 
 #if LWIP_CALLBACK_API
@@ -394,6 +427,11 @@ struct tcp_seg {
   void *dataptr;           /* pointer to the TCP data in the pbuf */
   u16_t len;               /* the TCP length of this segment */
   struct tcp_hdr *tcphdr;  /* the TCP header */
+#if LWIP_TCP_SACK
+  u8_t flags;
+#define TF_SEG_SACKED (u8_t)0x01U  /* Covered by a SACK block from the peer. */
+#define TF_SEG_REXMIT (u8_t)0x02U  /* Retransmitted in this fast recovery. */
+#endif /* LWIP_TCP_SACK */
 };
 
 /* Internal functions and global variables: */
@@ -423,6 +461,10 @@ err_t tcp_enqueue(struct tcp_pcb *pcb, void *dataptr, u16_t len,
 
 void tcp_rexmit_seg(struct tcp_pcb *pcb, struct tcp_seg *seg);
 
+/* Space for MSS, window scale and SACK permitted options. */
+#define TCP_SYNOPTS_LEN 12
+u8_t tcp_build_synopts(struct tcp_pcb *pcb, u32_t *opts);
+
 void tcp_rst(u32_t seqno, u32_t ackno,
        struct ip_addr *local_ip, struct ip_addr *remote_ip,
        u16_t local_port, u16_t remote_port);
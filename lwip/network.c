@@ -45,11 +45,20 @@
 #define MQBOX_SIZE				256
 #define NUM_SOCKETS				MEMP_NUM_NETCONN
 
+/* returned zero-copy receive loans are credited to the TCP window in batches */
+#define ZC_RECVED_THRESHOLD		(2*TCP_MSS)
+
+/* event sets are tracked per socket in an u8 mask */
+#define NUM_EVSETS				4
+
 struct netsocket {
 	struct netconn *conn;
 	struct netbuf *lastdata;
 	u16 lastoffset,rcvevt,sendevt,flags;
 	s32 err;
+	u32 zcrecved;
+	u16 selwaiters;
+	u8 evsets;
 };
 
 struct netselect_cb {
@@ -57,10 +66,25 @@ struct netselect_cb {
 	fd_set *readset;
 	fd_set *writeset;
 	fd_set *exceptset;
+	struct pollsd *sds;
+	s32 nsds;
 	u32 signaled;
 	sem_t sem;
 };
 
+/* A registered interest list. Sockets are put on the ready ring by evt_callback
+   when they turn ready, so net_evset_wait() only ever looks at ready sockets. */
+struct netevset {
+	u32 used;
+	u32 waiting;
+	sem_t sem;
+	u32 events[NUM_SOCKETS];
+	void *usrdata[NUM_SOCKETS];
+	u8 queued[NUM_SOCKETS];
+	u8 ring[NUM_SOCKETS];
+	u32 head,cnt;
+};
+
 typedef void (*apimsg_decode)(struct apimsg_msg *);
 
 static u32 g_netinitiated = 0;
@@ -78,6 +102,7 @@ static struct netif g_hNetIF;
 static struct netif g_hLoopIF;
 static struct netsocket sockets[NUM_SOCKETS];
 static struct netselect_cb *selectcb_list = NULL;
+static struct netevset evsets[NUM_EVSETS];
 
 static const s32 err_to_errno_table[] = {
   0,             /* ERR_OK          0      No error, everything OK. */
@@ -124,9 +149,9 @@ static err_t netconn_peer(struct netconn *,struct ip_addr *,u16 *);
 static err_t netconn_addr(struct netconn *,struct ip_addr **,u16 *);
 static err_t netconn_bind(struct netconn *,struct ip_addr *,u16);
 static err_t netconn_listen(struct netconn *);
-static struct netbuf* netconn_recv(struct netconn *);
+static struct netbuf* netconn_recv(struct netconn *,u8);
 static err_t netconn_send(struct netconn *,struct netbuf *);
-static err_t netconn_write(struct netconn *,const void *,u32,u8);
+static err_t netconn_write(struct netconn *,const void *,u32,u8,struct netconn_zcreq *);
 static err_t netconn_connect(struct netconn *,struct ip_addr *,u16);
 static err_t netconn_disconnect(struct netconn *);
 
@@ -141,6 +166,7 @@ static void do_send(struct apimsg_msg *);
 static void do_recv(struct apimsg_msg *);
 static void do_write(struct apimsg_msg *);
 static void do_close(struct apimsg_msg *);
+static void do_recved(void *);
 
 static apimsg_decode decode[APIMSG_MAX] = {
 	do_newconn,
@@ -325,6 +351,8 @@ static struct netconn* netconn_new_with_proto_and_callback(enum netconn_type t,u
 	conn->socket = 0;
 	conn->callback = cb;
 	conn->recvavail = 0;
+	conn->zc_head = NULL;
+	conn->zc_tail = NULL;
 	
 	msg = memp_malloc(MEMP_API_MSG);
 	if(!msg) {
@@ -505,7 +533,7 @@ static err_t netconn_listen(struct netconn *conn)
 	return conn->err;
 }
 
-static struct netbuf* netconn_recv(struct netconn *conn)
+static struct netbuf* netconn_recv(struct netconn *conn,u8 loan)
 {
 	u32 dummy;
 	struct api_msg *msg;
@@ -554,6 +582,9 @@ static struct netbuf* netconn_recv(struct netconn *conn)
 		buf->fromport = 0;
 		buf->fromaddr = NULL;
 
+		/* a loaned buffer reopens the window once it is released */
+		if(loan) return buf;
+
 		if((msg=memp_malloc(MEMP_API_MSG))==NULL) {
 			conn->err = ERR_MEM;
 			return buf;
@@ -599,19 +630,37 @@ static err_t netconn_send(struct netconn *conn,struct netbuf *buf)
 	return conn->err;
 }
 
-static err_t netconn_write(struct netconn *conn,const void *dataptr,u32 size,u8 copy)
+static void netconn_zcfail(struct netconn_zcreq *zc,err_t err)
 {
-	u32 dummy;
+	if(zc==NULL) return;
+
+	if(zc->sent) zc->sent(-err_to_errno(err),zc->arg);
+	mem_free(zc);
+}
+
+static err_t netconn_write(struct netconn *conn,const void *dataptr,u32 size,u8 copy,struct netconn_zcreq *zc)
+{
+	u32 dummy,total = size;
 	struct api_msg *msg;
 	u16 len,snd_buf;
 	
 
+	if(conn==NULL) {
+		netconn_zcfail(zc,ERR_VAL);
+		return ERR_VAL;
+	}
+
 	LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_write(%d)\n",conn->err));
 
-	if(conn==NULL) return ERR_VAL;
-	if(conn->err!=ERR_OK) return conn->err;
+	if(conn->err!=ERR_OK) {
+		netconn_zcfail(zc,conn->err);
+		return conn->err;
+	}
 	
-	if((msg=memp_malloc(MEMP_API_MSG))==NULL) return (conn->err = ERR_MEM);
+	if((msg=memp_malloc(MEMP_API_MSG))==NULL) {
+		netconn_zcfail(zc,ERR_MEM);
+		return (conn->err = ERR_MEM);
+	}
 	
 	msg->type = APIMSG_WRITE;
 	msg->msg.conn = conn;
@@ -634,6 +683,8 @@ static err_t netconn_write(struct netconn *conn,const void *dataptr,u32 size,u8
 
 		LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_write: writing %d bytes (%d)\n", len, copy));
 		msg->msg.msg.w.len = len;
+		/* a zero-copy request tracks the last chunk only */
+		msg->msg.msg.w.zc = (len==size)?zc:NULL;
 		apimsg_post(msg);
 		MQ_Receive(conn->mbox,(mqmsg_t)&dummy,MQ_MSG_BLOCK);
 		if(conn->err==ERR_OK) {
@@ -650,6 +701,20 @@ static err_t netconn_write(struct netconn *conn,const void *dataptr,u32 size,u8
 		}
 	}
 ret:
+	/* the request was never queued with the last chunk. If nothing went
+	   out it is done; otherwise the chunks already written still point
+	   into the application's buffer, so an empty write queues it behind them */
+	if(zc!=NULL && size>0) {
+		if(size==total)
+			netconn_zcfail(zc,conn->err);
+		else {
+			msg->msg.msg.w.len = 0;
+			msg->msg.msg.w.zc = zc;
+			apimsg_post(msg);
+			MQ_Receive(conn->mbox,(mqmsg_t)&dummy,MQ_MSG_BLOCK);
+		}
+	}
+
 	memp_free(MEMP_API_MSG,msg);
 	conn->state = NETCONN_NONE;
 
@@ -695,6 +760,31 @@ static err_t netconn_disconnect(struct netconn *conn)
 }
 
 /* api msg part */
+static void netconn_zcqueue(struct netconn *conn,struct netconn_zcreq *req,u32 seqno)
+{
+	/* done once the peer acknowledged the byte before seqno */
+	req->next = NULL;
+	req->seqno = seqno;
+	if(conn->zc_tail) conn->zc_tail->next = req;
+	else conn->zc_head = req;
+	conn->zc_tail = req;
+}
+
+static void netconn_zcsent(struct netconn *conn,u32 lastack,s32 result)
+{
+	struct netconn_zcreq *req;
+
+	/* complete the acknowledged requests, or all of them on error */
+	while((req=conn->zc_head)!=NULL) {
+		if(result==0 && !TCP_SEQ_GEQ(lastack,req->seqno)) break;
+
+		conn->zc_head = req->next;
+		if(conn->zc_head==NULL) conn->zc_tail = NULL;
+		if(req->sent) req->sent(result,req->arg);
+		mem_free(req);
+	}
+}
+
 static u8_t recv_raw(void *arg,struct raw_pcb *pcb,struct pbuf *p,struct ip_addr *addr)
 {
 	struct netbuf *buf;
@@ -783,6 +873,7 @@ static void err_tcp(void *arg,err_t err)
 	if(conn) {
 		conn->err = err;
 		conn->pcb.tcp = NULL;
+		netconn_zcsent(conn,0,-err_to_errno(err));
 		if(conn->recvmbox!=SYS_MBOX_NULL) {
 			if(conn->callback) (*conn->callback)(conn,NETCONN_EVTRCVPLUS,0);
 			MQ_Send(conn->recvmbox,(mqmsg_t)NULL,MQ_MSG_BLOCK);
@@ -816,6 +907,9 @@ static err_t sent_tcp(void *arg,struct tcp_pcb *pcb,u16 len)
 	struct netconn *conn = (struct netconn*)arg;
 
 	LWIP_DEBUGF(API_MSG_DEBUG, ("api_msg: sent_tcp: sent %d bytes\n",len));
+	if(conn)
+		netconn_zcsent(conn,pcb->lastack,0);
+
 	if(conn && conn->sem!=SYS_SEM_NULL)
 		LWP_SemPost(conn->sem);
 
@@ -879,6 +973,8 @@ static err_t accept_func(void *arg,struct tcp_pcb *newpcb,err_t err)
 	newconn->callback = conn->callback;
 	newconn->socket = -1;
 	newconn->recvavail = 0;
+	newconn->zc_head = NULL;
+	newconn->zc_tail = NULL;
 
 	MQ_Send(mbox,(mqmsg_t)newconn,MQ_MSG_BLOCK);
 	return ERR_OK;
@@ -961,7 +1057,9 @@ static void do_delconn(struct apimsg_msg *msg)
 					tcp_recv(msg->conn->pcb.tcp,NULL);
 					tcp_poll(msg->conn->pcb.tcp,NULL,0);
 					tcp_err(msg->conn->pcb.tcp,NULL);
-					if(tcp_close(msg->conn->pcb.tcp)!=ERR_OK)
+					/* unacknowledged zero-copy segments point into application
+					   memory that is handed back below, so they can't linger */
+					if(msg->conn->zc_head!=NULL || tcp_close(msg->conn->pcb.tcp)!=ERR_OK)
 						tcp_abort(msg->conn->pcb.tcp);
 				}
 				break;
@@ -969,6 +1067,9 @@ static void do_delconn(struct apimsg_msg *msg)
 				break;
 		}
 	}
+	/* whatever is left over lost its connection */
+	netconn_zcsent(msg->conn,0,-ECONNABORTED);
+
 	if(msg->conn->callback) {
 		(*msg->conn->callback)(msg->conn,NETCONN_EVTRCVPLUS,0);
 		(*msg->conn->callback)(msg->conn,NETCONN_EVTSENDPLUS,0);
@@ -1202,10 +1303,39 @@ static void do_recv(struct apimsg_msg *msg)
 	MQ_Send(msg->conn->mbox,(mqmsg_t)NULL,MQ_MSG_BLOCK);
 }
 
+/* posted through net_callback(): nobody waits for a reply */
+static void do_recved(void *arg)
+{
+	u32 len;
+	struct api_msg *msg = (struct api_msg*)arg;
+	struct tcp_pcb *pcb = msg->msg.conn->pcb.tcp;
+
+	len = msg->msg.msg.w.len;
+	while(pcb && len>0) {
+		u16 chunk = (len>0xffff)?0xffff:len;
+		tcp_recved(pcb,chunk);
+		len -= chunk;
+	}
+	memp_free(MEMP_API_MSG,msg);
+}
+
 static void do_write(struct apimsg_msg *msg)
 {
 	err_t err;
 
+	/* a write cut short by an error: complete its request once the data
+	   written before is acknowledged, or now if the connection is gone */
+	if(msg->msg.w.len==0) {
+		if(msg->msg.w.zc!=NULL) {
+			if(msg->conn->type==NETCONN_TCP && msg->conn->pcb.tcp)
+				netconn_zcqueue(msg->conn,msg->msg.w.zc,msg->conn->pcb.tcp->snd_lbb);
+			else
+				netconn_zcfail(msg->msg.w.zc,ERR_ABRT);
+		}
+		MQ_Send(msg->conn->mbox,(mqmsg_t)NULL,MQ_MSG_BLOCK);
+		return;
+	}
+
 	if(msg->conn->pcb.tcp) {
 		switch(msg->conn->type) {
 			case NETCONN_RAW:
@@ -1216,6 +1346,8 @@ static void do_write(struct apimsg_msg *msg)
 				break;
 			case NETCONN_TCP:
 				err = tcp_write(msg->conn->pcb.tcp,msg->msg.w.dataptr,msg->msg.w.len,msg->msg.w.copy);
+				if(err==ERR_OK && msg->msg.w.zc!=NULL)
+					netconn_zcqueue(msg->conn,msg->msg.w.zc,msg->conn->pcb.tcp->snd_lbb);
 				if(err==ERR_OK && (!msg->conn->pcb.tcp->unacked || (msg->conn->pcb.tcp->flags&TF_NODELAY)
 					|| msg->conn->pcb.tcp->snd_queuelen>1)) {
 					LWIP_DEBUGF(API_MSG_DEBUG, ("api_msg: TCP write: tcp_output.\n"));
@@ -1391,6 +1523,7 @@ static s32 alloc_socket(struct netconn *conn)
 			sockets[i].sendevt = 1;
 			sockets[i].flags = 0;
 			sockets[i].err = 0;
+			sockets[i].zcrecved = 0;
 			LWP_SemPost(netsocket_sem);
 			return i;
 		}
@@ -1403,7 +1536,7 @@ static s32 alloc_socket(struct netconn *conn)
 static struct netsocket* get_socket(s32 s)
 {
 	struct netsocket *sock;
-	if(s<0 || s>NUM_SOCKETS) {
+	if(s<0 || s>=NUM_SOCKETS) {
 	    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_socket(%d): invalid\n", s));
 		return NULL;
 	}
@@ -1416,9 +1549,50 @@ static struct netsocket* get_socket(s32 s)
 	return sock;
 }
 
+static u32 net_sockevents(struct netsocket *sock)
+{
+	u32 revents = 0;
+	struct netconn *conn = sock->conn;
+
+	if(sock->lastdata || sock->rcvevt) revents |= POLLIN;
+	if(sock->sendevt) revents |= POLLOUT;
+	if(conn->err<=ERR_ABRT && conn->err>=ERR_CLSD) revents |= POLLERR;
+	if(conn->type==NETCONN_TCP && conn->pcb.tcp==NULL) revents |= POLLHUP;
+
+	return revents;
+}
+
+static void net_evset_enqueue(struct netevset *set,s32 s)
+{
+	if(set->queued[s]) return;
+
+	set->ring[(set->head+set->cnt)%NUM_SOCKETS] = s;
+	set->queued[s] = 1;
+	set->cnt++;
+}
+
+static void net_evset_notify(s32 s,struct netsocket *sock)
+{
+	s32 i;
+	u32 revents;
+	struct netevset *set;
+
+	revents = net_sockevents(sock);
+	for(i=0;i<NUM_EVSETS;i++) {
+		if(!(sock->evsets&(1<<i))) continue;
+
+		set = &evsets[i];
+		if(revents&(set->events[s]|POLLERR|POLLHUP)) {
+			net_evset_enqueue(set,s);
+			if(set->waiting) LWP_SemPost(set->sem);
+		}
+	}
+}
+
 static void evt_callback(struct netconn *conn,enum netconn_evt evt,u32 len)
 {
-	s32 s;
+	s32 i,s;
+	u32 revents;
 	struct netsocket *sock;
 	struct netselect_cb *scb;
 	
@@ -1449,28 +1623,31 @@ static void evt_callback(struct netconn *conn,enum netconn_evt evt,u32 len)
 			sock->sendevt = 0;
 			break;
 	}
-	LWP_SemPost(sockselect_sem);
 
-	while(1) {
-		LWP_SemWait(sockselect_sem);
+	if(sock->evsets) net_evset_notify(s,sock);
+
+	/* only walk the waiter list when someone is actually waiting on this socket */
+	if(sock->selwaiters) {
+		revents = net_sockevents(sock);
 		for(scb = selectcb_list;scb;scb = scb->next) {
-			if(scb->signaled==0) {
-				if(scb->readset && FD_ISSET(s,scb->readset))
-					if(sock->rcvevt) break;
-				if(scb->writeset && FD_ISSET(s,scb->writeset))
-					if(sock->sendevt) break;
+			if(scb->signaled) continue;
+
+			if(scb->sds) {
+				for(i=0;i<scb->nsds;i++) {
+					if(scb->sds[i].socket==s
+						&& (revents&(scb->sds[i].events|POLLERR|POLLHUP))) break;
+				}
+				if(i==scb->nsds) continue;
+			} else {
+				if(!((scb->readset && FD_ISSET(s,scb->readset) && sock->rcvevt)
+					|| (scb->writeset && FD_ISSET(s,scb->writeset) && sock->sendevt))) continue;
 			}
-		}
-		if(scb) {
+
 			scb->signaled = 1;
-			LWP_SemPost(sockselect_sem);
 			LWP_SemPost(scb->sem);
-		} else {
-			LWP_SemPost(sockselect_sem);
-			break;
 		}
 	}
-	
+	LWP_SemPost(sockselect_sem);
 }
 
 extern const devoptab_t dotab_stdnet;
@@ -1816,7 +1993,7 @@ s32 net_recvfrom(s32 s,void *mem,size_t len,u32 flags,struct sockaddr *from,sock
 			LWIP_DEBUGF(SOCKETS_DEBUG, ("net_recvfrom(%d): returning EWOULDBLOCK\n", s));
 			return -EWOULDBLOCK;
 		}
-		buf = netconn_recv(sock->conn);
+		buf = netconn_recv(sock->conn,0);
 		if(!buf) {
 		    LWIP_DEBUGF(SOCKETS_DEBUG, ("net_recvfrom(%d): buf == NULL!\n", s));
 			return 0;
@@ -1865,6 +2042,111 @@ s32 net_recvfrom(s32 s,void *mem,size_t len,u32 flags,struct sockaddr *from,sock
 	return copylen;
 }
 
+s32 net_recvzc(s32 s,struct netzcbuf **zbuf,u32 flags)
+{
+	struct netsocket *sock;
+	struct netbuf *buf;
+	struct pbuf *p;
+	u32 off;
+	s32 len;
+
+	LWIP_DEBUGF(SOCKETS_DEBUG, ("net_recvzc(%d, 0x%x)\n", s, flags));
+	if(!zbuf) return -EINVAL;
+
+	*zbuf = NULL;
+	sock = get_socket(s);
+	if(!sock) return -EBADF;
+
+	if(sock->lastdata) {
+		/* hand out what net_recv() left over, its window was already reopened */
+		buf = sock->lastdata;
+		off = sock->lastoffset;
+		len = netbuf_len(buf) - off;
+		sock->lastdata = NULL;
+		sock->lastoffset = 0;
+
+		for(p=buf->p;p!=NULL && off>=p->len;p=p->next) off -= p->len;
+		if(p!=NULL && off>0) pbuf_header(p,-(s16)off);
+		buf->ptr = p;
+		buf->credit = 0;
+	} else {
+		if(((flags&MSG_DONTWAIT) || (sock->flags&O_NONBLOCK)) && !sock->rcvevt) {
+			LWIP_DEBUGF(SOCKETS_DEBUG, ("net_recvzc(%d): returning EWOULDBLOCK\n", s));
+			return -EWOULDBLOCK;
+		}
+		buf = netconn_recv(sock->conn,1);
+		if(!buf) return 0;
+
+		len = netbuf_len(buf);
+		buf->ptr = buf->p;
+		buf->credit = (netconn_type(sock->conn)==NETCONN_TCP)?len:0;
+	}
+
+	*zbuf = (struct netzcbuf*)buf;
+	return len;
+}
+
+void* net_zcbuf_next(struct netzcbuf *zbuf,u32 *len)
+{
+	struct pbuf *p;
+	struct netbuf *buf = (struct netbuf*)zbuf;
+
+	if(len) *len = 0;
+	if(!buf) return NULL;
+
+	/* trimmed segments leave empty pbufs at the front of the chain */
+	for(p=buf->ptr;p!=NULL && p->len==0;p=p->next);
+	if(p==NULL) {
+		buf->ptr = NULL;
+		return NULL;
+	}
+
+	buf->ptr = p->next;
+	if(len) *len = p->len;
+	return p->payload;
+}
+
+void net_zcbuf_release(s32 s,struct netzcbuf *zbuf)
+{
+	u32 level,len;
+	struct api_msg *msg;
+	struct netsocket *sock;
+	struct netbuf *buf = (struct netbuf*)zbuf;
+
+	if(!buf) return;
+
+	sock = get_socket(s);
+	if(sock && buf->credit>0) {
+		len = 0;
+		_CPU_ISR_Disable(level);
+		sock->zcrecved += buf->credit;
+		if(sock->zcrecved>=ZC_RECVED_THRESHOLD) {
+			len = sock->zcrecved;
+			sock->zcrecved = 0;
+		}
+		_CPU_ISR_Restore(level);
+
+		/* reopen the window without waiting for the network thread */
+		if(len>0) {
+			msg = memp_malloc(MEMP_API_MSG);
+			if(msg) {
+				msg->type = APIMSG_RECV;
+				msg->msg.conn = sock->conn;
+				msg->msg.msg.w.len = len;
+				if(net_callback(do_recved,msg)==ERR_OK) len = 0;
+				else memp_free(MEMP_API_MSG,msg);
+			}
+			if(len>0) {
+				/* out of messages: retry with the next release */
+				_CPU_ISR_Disable(level);
+				sock->zcrecved += len;
+				_CPU_ISR_Restore(level);
+			}
+		}
+	}
+	netbuf_delete(buf);
+}
+
 s32 net_read(s32 s,void *mem,size_t len)
 {
 	return net_recvfrom(s,mem,len,0,NULL,NULL);
@@ -1934,7 +2216,7 @@ s32 net_send(s32 s,const void *data,size_t len,u32 flags)
 			netbuf_delete(buf);
 			break;
 		case NETCONN_TCP:
-			err = netconn_write(sock->conn,data,len,NETCONN_COPY);
+			err = netconn_write(sock->conn,data,len,NETCONN_COPY,NULL);
 			break;
 		default:
 			err = ERR_ARG;
@@ -1954,6 +2236,46 @@ s32 net_write(s32 s,const void *data,size_t size)
 	return net_send(s,data,size,0);
 }
 
+s32 net_sendzc(s32 s,const void *data,size_t len,u32 flags,netzc_sentcb cb,void *usrdata)
+{
+	struct netsocket *sock;
+	struct netconn_zcreq *req;
+	err_t err;
+	s32 ret;
+
+	LWIP_DEBUGF(SOCKETS_DEBUG, ("net_sendzc(%d, data=%p, size=%d, flags=0x%x)\n", s, data, len, flags));
+
+	sock = get_socket(s);
+	if(!sock) return -EBADF;
+
+	if(netconn_type(sock->conn)!=NETCONN_TCP) {
+		/* datagrams already go out by reference and are done on return */
+		ret = net_send(s,data,len,flags);
+		if(cb) cb((ret<0)?ret:0,usrdata);
+		return ret;
+	}
+
+	if(len==0) {
+		if(cb) cb(0,usrdata);
+		return 0;
+	}
+
+	req = mem_malloc(sizeof(struct netconn_zcreq));
+	if(!req) return -ENOMEM;
+
+	req->next = NULL;
+	req->sent = cb;
+	req->arg = usrdata;
+
+	/* netconn_write() takes ownership of req and completes it on every path */
+	err = netconn_write(sock->conn,data,len,NETCONN_NOCOPY,req);
+	if(err!=ERR_OK) {
+		LWIP_DEBUGF(SOCKETS_DEBUG, ("net_sendzc(%d) err=%d\n", s, err));
+		return -err_to_errno(err);
+	}
+	return len;
+}
+
 s32 net_connect(s32 s,struct sockaddr *name,socklen_t namelen)
 {
 	struct netsocket *sock;
@@ -1989,6 +2311,7 @@ s32 net_connect(s32 s,struct sockaddr *name,socklen_t namelen)
 
 s32 net_close(s32 s)
 {
+	s32 i;
 	struct netsocket *sock;
 
 	LWIP_DEBUGF(SOCKETS_DEBUG, ("net_close(%d)\n", s));
@@ -2001,6 +2324,13 @@ s32 net_close(s32 s)
 		return -EBADF;
 	}
 	
+	LWP_SemWait(sockselect_sem);
+	for(i=0;i<NUM_EVSETS;i++) {
+		if(sock->evsets&(1<<i)) evsets[i].events[s] = 0;
+	}
+	sock->evsets = 0;
+	LWP_SemPost(sockselect_sem);
+
 	netconn_delete(sock->conn);
 	if(sock->lastdata) netbuf_delete(sock->lastdata);
 	
@@ -2012,6 +2342,50 @@ s32 net_close(s32 s)
 	return 0;
 }
 
+static void net_selwaiters(struct netselect_cb *scb,s32 maxfdp1,s32 inc)
+{
+	s32 i,s;
+
+	if(scb->sds) {
+		for(i=0;i<scb->nsds;i++) {
+			s = scb->sds[i].socket;
+			if(s>=0 && s<NUM_SOCKETS) sockets[s].selwaiters += inc;
+		}
+		return;
+	}
+
+	if(maxfdp1>NUM_SOCKETS) maxfdp1 = NUM_SOCKETS;
+	for(i=0;i<maxfdp1;i++) {
+		if((scb->readset && FD_ISSET(i,scb->readset))
+			|| (scb->writeset && FD_ISSET(i,scb->writeset)))
+			sockets[i].selwaiters += inc;
+	}
+}
+
+static void net_selqueue(struct netselect_cb *scb,s32 maxfdp1)
+{
+	scb->next = selectcb_list;
+	selectcb_list = scb;
+	net_selwaiters(scb,maxfdp1,1);
+}
+
+static void net_seldequeue(struct netselect_cb *scb,s32 maxfdp1)
+{
+	struct netselect_cb *pscb;
+
+	if(selectcb_list==scb)
+		selectcb_list = scb->next;
+	else {
+		for(pscb = selectcb_list;pscb;pscb = pscb->next) {
+			if(pscb->next==scb) {
+				pscb->next = scb->next;
+				break;
+			}
+		}
+	}
+	net_selwaiters(scb,maxfdp1,-1);
+}
+
 static s32 net_selscan(s32 maxfdp1,fd_set *readset,fd_set *writeset,fd_set *exceptset)
 {
 	s32 i,nready = 0;
@@ -2051,12 +2425,13 @@ s32 net_select(s32 maxfdp1,fd_set *readset,fd_set *writeset,fd_set *exceptset,st
 	fd_set lreadset,lwriteset,lexceptset;
 	struct timespec tb,*p_tb;
 	struct netselect_cb sel_cb;
-	struct netselect_cb *psel_cb;
 	
 	sel_cb.next = NULL;
 	sel_cb.readset = readset;
 	sel_cb.writeset = writeset;
 	sel_cb.exceptset = exceptset;
+	sel_cb.sds = NULL;
+	sel_cb.nsds = 0;
 	sel_cb.signaled = 0;
 	
 	LWP_SemWait(sockselect_sem);
@@ -2090,8 +2465,7 @@ s32 net_select(s32 maxfdp1,fd_set *readset,fd_set *writeset,fd_set *exceptset,st
 		}
 
 		LWP_SemInit(&sel_cb.sem,0,1);
-		sel_cb.next = selectcb_list;
-		selectcb_list = &sel_cb;
+		net_selqueue(&sel_cb,maxfdp1);
 
 		LWP_SemPost(sockselect_sem);
 		if(timeout==NULL)
@@ -2105,16 +2479,7 @@ s32 net_select(s32 maxfdp1,fd_set *readset,fd_set *writeset,fd_set *exceptset,st
 		i = LWP_SemTimedWait(sel_cb.sem,p_tb);
 
 		LWP_SemWait(sockselect_sem);
-		if(selectcb_list==&sel_cb)
-			selectcb_list = sel_cb.next;
-		else {
-			for(psel_cb = selectcb_list;psel_cb;psel_cb = psel_cb->next) {
-				if(psel_cb->next==&sel_cb) {
-					psel_cb->next = sel_cb.next;
-					break;
-				}
-			}
-		}
+		net_seldequeue(&sel_cb,maxfdp1);
 		LWP_SemPost(sockselect_sem);
 		LWP_SemDestroy(sel_cb.sem);
 
@@ -2157,6 +2522,248 @@ s32 net_select(s32 maxfdp1,fd_set *readset,fd_set *writeset,fd_set *exceptset,st
 	return nready;
 }
 
+static s32 net_pollscan(struct pollsd *sds,s32 nsds)
+{
+	s32 i,nready = 0;
+	struct netsocket *sock;
+
+	for(i=0;i<nsds;i++) {
+		sock = get_socket(sds[i].socket);
+		if(!sock)
+			sds[i].revents = POLLNVAL;
+		else
+			sds[i].revents = net_sockevents(sock)&(sds[i].events|POLLERR|POLLHUP);
+		if(sds[i].revents) nready++;
+	}
+	return nready;
+}
+
+s32 net_poll(struct pollsd *sds,s32 nsds,s32 timeout)
+{
+	s32 nready;
+	struct timespec tb,*p_tb;
+	struct netselect_cb poll_cb;
+
+	if(!sds || nsds<=0) return -EINVAL;
+
+	LWP_SemWait(sockselect_sem);
+
+	nready = net_pollscan(sds,nsds);
+	if(!nready && timeout!=0) {
+		poll_cb.next = NULL;
+		poll_cb.readset = NULL;
+		poll_cb.writeset = NULL;
+		poll_cb.exceptset = NULL;
+		poll_cb.sds = sds;
+		poll_cb.nsds = nsds;
+		poll_cb.signaled = 0;
+
+		LWP_SemInit(&poll_cb.sem,0,1);
+		net_selqueue(&poll_cb,0);
+		LWP_SemPost(sockselect_sem);
+
+		if(timeout<0)
+			p_tb = NULL;
+		else {
+			tb.tv_sec = timeout/1000;
+			tb.tv_nsec = (timeout%1000)*TB_NSPERMS;
+			p_tb = &tb;
+		}
+		LWP_SemTimedWait(poll_cb.sem,p_tb);
+
+		LWP_SemWait(sockselect_sem);
+		net_seldequeue(&poll_cb,0);
+		LWP_SemDestroy(poll_cb.sem);
+
+		nready = net_pollscan(sds,nsds);
+	}
+	LWP_SemPost(sockselect_sem);
+
+	return nready;
+}
+
+s32 net_evset_create(void)
+{
+	s32 i;
+	struct netevset *set;
+
+	LWP_SemWait(sockselect_sem);
+	for(i=0;i<NUM_EVSETS;i++) {
+		set = &evsets[i];
+		if(!set->used) {
+			if(LWP_SemInit(&set->sem,0,1)!=0) break;
+
+			memset(set->events,0,sizeof(set->events));
+			memset(set->queued,0,sizeof(set->queued));
+			set->waiting = 0;
+			set->head = 0;
+			set->cnt = 0;
+			set->used = 1;
+			LWP_SemPost(sockselect_sem);
+			return i;
+		}
+	}
+	LWP_SemPost(sockselect_sem);
+	return -EMFILE;
+}
+
+s32 net_evset_destroy(s32 evs)
+{
+	s32 i;
+	struct netevset *set;
+
+	if(evs<0 || evs>=NUM_EVSETS) return -EBADF;
+
+	LWP_SemWait(sockselect_sem);
+	set = &evsets[evs];
+	if(!set->used || set->waiting) {
+		LWP_SemPost(sockselect_sem);
+		return (set->used ? -EBUSY : -EBADF);
+	}
+
+	for(i=0;i<NUM_SOCKETS;i++) sockets[i].evsets &= ~(1<<evs);
+	LWP_SemDestroy(set->sem);
+	set->used = 0;
+	LWP_SemPost(sockselect_sem);
+
+	return 0;
+}
+
+s32 net_evset_ctl(s32 evs,u32 op,s32 s,u32 events,void *usrdata)
+{
+	s32 ret = 0;
+	struct netevset *set;
+	struct netsocket *sock;
+
+	if(evs<0 || evs>=NUM_EVSETS) return -EBADF;
+
+	LWP_SemWait(sockselect_sem);
+
+	set = &evsets[evs];
+	sock = get_socket(s);
+	if(!set->used || !sock) {
+		LWP_SemPost(sockselect_sem);
+		return -EBADF;
+	}
+
+	switch(op) {
+		case NET_EVSET_ADD:
+			if(sock->evsets&(1<<evs)) {
+				ret = -EEXIST;
+				break;
+			}
+			sock->evsets |= (1<<evs);
+			set->events[s] = events;
+			set->usrdata[s] = usrdata;
+			break;
+		case NET_EVSET_MOD:
+			if(!(sock->evsets&(1<<evs))) {
+				ret = -ENOENT;
+				break;
+			}
+			set->events[s] = events;
+			set->usrdata[s] = usrdata;
+			break;
+		case NET_EVSET_DEL:
+			if(!(sock->evsets&(1<<evs))) {
+				ret = -ENOENT;
+				break;
+			}
+			/* a stale ring entry is dropped by net_evset_wait() */
+			sock->evsets &= ~(1<<evs);
+			set->events[s] = 0;
+			break;
+		default:
+			ret = -EINVAL;
+			break;
+	}
+
+	/* the socket may already be ready, no edge will come for it then */
+	if(ret==0 && op!=NET_EVSET_DEL
+		&& (net_sockevents(sock)&(events|POLLERR|POLLHUP))) {
+		net_evset_enqueue(set,s);
+		if(set->waiting) LWP_SemPost(set->sem);
+	}
+	LWP_SemPost(sockselect_sem);
+
+	return ret;
+}
+
+static s32 net_evset_collect(struct netevset *set,struct netevent *evts,s32 maxevents)
+{
+	s32 s,n = 0;
+	u32 cnt,revents;
+	struct netsocket *sock;
+
+	/* entries put back below go behind the ones present now */
+	cnt = set->cnt;
+	while(cnt>0 && n<maxevents) {
+		s = set->ring[set->head];
+		set->head = (set->head+1)%NUM_SOCKETS;
+		set->queued[s] = 0;
+		set->cnt--;
+		cnt--;
+
+		sock = get_socket(s);
+		if(!sock || !set->events[s]) continue;
+
+		revents = net_sockevents(sock)&(set->events[s]|POLLERR|POLLHUP);
+		if(!revents) continue;
+
+		evts[n].socket = s;
+		evts[n].events = revents;
+		evts[n].usrdata = set->usrdata[s];
+		n++;
+
+		/* level triggered: look at it again on the next wait */
+		net_evset_enqueue(set,s);
+	}
+	return n;
+}
+
+s32 net_evset_wait(s32 evs,struct netevent *evts,s32 maxevents,s32 timeout)
+{
+	s32 n,ret;
+	struct timespec tb,*p_tb;
+	struct netevset *set;
+
+	if(evs<0 || evs>=NUM_EVSETS) return -EBADF;
+	if(!evts || maxevents<=0) return -EINVAL;
+
+	if(timeout<0)
+		p_tb = NULL;
+	else {
+		tb.tv_sec = timeout/1000;
+		tb.tv_nsec = (timeout%1000)*TB_NSPERMS;
+		p_tb = &tb;
+	}
+
+	LWP_SemWait(sockselect_sem);
+
+	set = &evsets[evs];
+	if(!set->used) {
+		LWP_SemPost(sockselect_sem);
+		return -EBADF;
+	}
+
+	n = net_evset_collect(set,evts,maxevents);
+	while(!n && timeout!=0) {
+		set->waiting++;
+		LWP_SemPost(sockselect_sem);
+
+		ret = LWP_SemTimedWait(set->sem,p_tb);
+
+		LWP_SemWait(sockselect_sem);
+		set->waiting--;
+
+		n = net_evset_collect(set,evts,maxevents);
+		if(ret==ETIMEDOUT) break;
+	}
+	LWP_SemPost(sockselect_sem);
+
+	return n;
+}
+
 s32 net_getpeername(s32 s,struct sockaddr *name,socklen_t *namelen)
 {
 	struct netsocket *sock;